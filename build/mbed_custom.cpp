@@ -75,17 +75,25 @@ extern "C" void _start(void)
     extern uint8_t __AHB1_block_start;
     extern uint8_t __AHB1_dyn_start;
     extern uint8_t __AHB1_end;
+    extern uint8_t __CCM_block_start;
+    extern uint8_t __CCM_dyn_start;
+    extern uint8_t __CCM_end;
 
-    // zero the data sections in AHB0 and AHB1
+    // zero the data sections in AHB0, AHB1 and CCM
     memset(&__AHB0_block_start, 0, &__AHB0_dyn_start - &__AHB0_block_start);
     memset(&__AHB1_block_start, 0, &__AHB1_dyn_start - &__AHB1_block_start);
+    memset(&__CCM_block_start, 0, &__CCM_dyn_start - &__CCM_block_start);
 
     MemoryPool _AHB0_stack(&__AHB0_dyn_start, &__AHB0_end - &__AHB0_dyn_start);
     MemoryPool _AHB1_stack(&__AHB1_dyn_start, &__AHB1_end - &__AHB1_dyn_start);
+    // the pool size is 16 bits so it can't quite cover all 64K of the CCM if nothing static was placed there
+    unsigned int ccm_size = &__CCM_end - &__CCM_dyn_start;
+    MemoryPool _CCM_stack(&__CCM_dyn_start, ccm_size > 0xFFF8 ? 0xFFF8 : ccm_size);
 
 
     _AHB0 = &_AHB0_stack;
     _AHB1 = &_AHB1_stack;
+    _CCM = &_CCM_stack;
     // MemoryPool init done
 
     __libc_init_array();
@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+"""\
+Stream g-code to Smoothie over serial using the binary framed commands where it can
+
+Absolute G0/G1 moves in mm are sent as move frames, Mnnn and Mnnn Snnn as output frames and the
+queries as query frames, anything else is sent as text. See src/modules/communication/utils/BinaryFrame.h
+for the format.
+
+Lines are kept in flight up to the receive window M115 reports (character counting), every line or frame
+gets one reply line.
+
+With --numbered the lines are sent as text with a line number and checksum instead, when one is corrupted
+Smoothie asks for it once with rs Nnnn and drops the ones after it that were in flight, they are sent again from there.
+
+A frame that is corrupted gets rs frame, the lines sent after it have been run so it cannot be sent again in its place,
+the job is stopped there as the machine is not where the rest of it expects.
+
+Can also be imported for encode_line()
+"""
+
+from __future__ import print_function
+import sys
+import re
+import struct
+import argparse
+
+STX = 0x02
+SCALE = 10000
+AXES = 'XYZABCD'
+QUERIES = (105, 114, 119)
+
+def crc16(data, crc=0xFFFF):
+    for b in bytearray(data):
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+def frame(ftype, payload):
+    body = struct.pack('<cB', ftype, len(payload)) + payload
+    return bytearray([STX]) + body + struct.pack('<H', crc16(body))
+
+def fixed(v):
+    return int(round(float(v) * SCALE))
+
+def words(line):
+    return re.findall(r'([A-Z])\s*([-+]?[0-9]*\.?[0-9]*)', line.upper())
+
+class Encoder(object):
+    """tracks the modal state that decides if a line can be sent as a frame"""
+    def __init__(self):
+        self.absolute = True
+        self.mm = True
+
+    def encode_line(self, line):
+        """returns the frame for a line, or None if it has to be sent as text"""
+        line = re.sub(r'\s*[;(].*', '', line).strip()
+        w = words(line)
+        if not w:
+            return None
+        letter, value = w[0]
+        if letter == 'G':
+            g = value
+            if g == '90': self.absolute = True
+            elif g == '91': self.absolute = False
+            elif g == '21': self.mm = True
+            elif g == '20': self.mm = False
+            if g not in ('0', '1', '00', '01') or not self.absolute or not self.mm:
+                return None
+            flags = 1 if int(g) == 1 else 0
+            mask = 0
+            feed = None
+            pos = {}
+            for l, v in w[1:]:
+                if v == '':
+                    return None
+                if l == 'F':
+                    feed = fixed(v)
+                elif l in AXES:
+                    mask |= 1 << AXES.index(l)
+                    pos[AXES.index(l)] = fixed(v)
+                else:
+                    return None
+            payload = struct.pack('<BB', flags | (2 if feed is not None else 0), mask)
+            if feed is not None:
+                payload += struct.pack('<i', feed)
+            for i in range(len(AXES)):
+                if i in pos:
+                    payload += struct.pack('<i', pos[i])
+            return frame(b'G', payload)
+
+        if letter == 'M' and re.match(r'^[0-9]+(\.[0-9]+)?$', value):
+            m, _, sub = value.partition('.')
+            m = int(m)
+            if m in QUERIES and len(w) == 1:
+                return frame(b'Q', struct.pack('<HB', m, int(sub or 0)))
+            if sub:
+                return None
+            if len(w) == 1:
+                return frame(b'O', struct.pack('<H', m))
+            if len(w) == 2 and w[1][0] == 'S' and w[1][1] != '':
+                return frame(b'O', struct.pack('<Hi', m, fixed(w[1][1])))
+        return None
+
+def encode_line(line, encoder=None):
+    return (encoder or Encoder()).encode_line(line)
+
+def numbered(line, n):
+    """the line with line number n and its checksum"""
+    l = ('N%d %s' % (n, line)).encode()
+    cs = 0
+    for c in bytearray(l):
+        cs ^= c
+    return l + ('*%d\n' % cs).encode()
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code file to Smoothie over serial with binary frames.')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('port', nargs='?',
+            help='serial port, if not given the frames are written to the file given by --out')
+    parser.add_argument('-b', '--baud', type=int, default=115200,
+            help='baud rate')
+    parser.add_argument('-o', '--out',
+            help='write the encoded stream to this file rather than a serial port')
+    parser.add_argument('-q', '--quiet', action='store_true', default=False,
+            help='suppress output text')
+    parser.add_argument('-n', '--numbered', action='store_true', default=False,
+            help='send text lines with line numbers and checksums rather than frames')
+    args = parser.parse_args()
+
+    enc = Encoder()
+    items = []
+    text_bytes = 0
+    for line in args.gcode_file:
+        line = re.sub(r'[ ]*;.*', '', line).strip()
+        if len(line) == 0:
+            continue
+        text_bytes += len(line) + 1
+        f = None if args.numbered else enc.encode_line(line)
+        # short lines can be smaller as text
+        if f is not None and len(f) < len(line) + 1:
+            items.append((line, bytes(f)))
+        else:
+            items.append((line, (line + '\n').encode()))
+
+    sent_bytes = sum(len(b) for _, b in items)
+    print("%d lines, %d bytes as text, %d bytes with frames" % (len(items), text_bytes, sent_bytes))
+
+    if args.out:
+        with open(args.out, 'wb') as o:
+            for _, b in items:
+                o.write(b)
+        return
+
+    import serial
+    s = serial.Serial(args.port, args.baud, timeout=5)
+
+    # ask for the receive window
+    s.write(b'M115\n')
+    window = 0
+    while True:
+        rep = s.readline().decode(errors='replace')
+        m = re.search(r'X-RX_BUFFER:(\d+)', rep)
+        if m: window = int(m.group(1))
+        if rep.startswith('ok'): break
+    if window == 0:
+        print("no receive window, sending a line at a time")
+
+    in_flight = []
+    def read_reply():
+        while True:
+            rep = s.readline().decode(errors='replace').strip()
+            if rep.startswith(('ok', '!!', 'rs', 'error', 'Error')):
+                line = in_flight.pop(0)
+                if not args.quiet or not rep.startswith('ok'):
+                    print(line[0] + " - " + rep)
+                return rep
+
+    if args.numbered:
+        s.write(numbered('M110', 0))
+        in_flight.append(('M110', b''))
+        read_reply()
+
+    i = 0
+    while i < len(items) or in_flight:
+        if i < len(items):
+            line, b = items[i]
+            if args.numbered:
+                b = numbered(line, i + 1)
+            if not in_flight or sum(len(x[1]) for x in in_flight) + len(b) <= max(window, 1):
+                s.write(b)
+                in_flight.append((line, b))
+                i += 1
+                continue
+        rep = read_reply()
+        m = re.match(r'rs N(\d+)', rep)
+        if m:
+            # the lines in flight after it are dropped, send them all again from there
+            i = int(m.group(1)) - 1
+        elif rep.startswith('rs frame'):
+            # the ones after it are queued already, so sending it again would run it out of order
+            while in_flight:
+                read_reply()
+            print("A frame was corrupted and is lost, stopped at line %d of %d" % (i, len(items)))
+            sys.exit(1)
+    print("Done")
+
+if __name__ == '__main__':
+    main()
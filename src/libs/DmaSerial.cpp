@@ -0,0 +1,207 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DmaSerial.h"
+
+#include "stm32f407xx.h" // mbed.h lib
+
+// the interrupts have the same priority as the serial interrupts in Kernel, lower than the step ticker
+#define DMA_SERIAL_IRQ_PRIORITY 5
+
+struct DmaSerial::dma_map_t {
+    USART_TypeDef *uart;
+    IRQn_Type uart_irq;
+    DMA_TypeDef *dma;
+    uint32_t dma_clock;
+    uint32_t channel;
+    DMA_Stream_TypeDef *rx_stream;
+    uint8_t rx_stream_n;
+    IRQn_Type rx_irq;
+    DMA_Stream_TypeDef *tx_stream;
+    uint8_t tx_stream_n;
+    IRQn_Type tx_irq;
+    void (*uart_vector)(void);
+    void (*tx_vector)(void);
+};
+
+static DmaSerial *instances[2];
+
+static void usart1_irq(void) { if(instances[0] != nullptr) instances[0]->rx_irq(); }
+static void usart1_tx_irq(void) { if(instances[0] != nullptr) instances[0]->tx_irq(); }
+static void usart2_irq(void) { if(instances[1] != nullptr) instances[1]->rx_irq(); }
+static void usart2_tx_irq(void) { if(instances[1] != nullptr) instances[1]->tx_irq(); }
+
+// the DMA request mapping from the reference manual, the receive streams use the same handler as the idle line interrupt
+static const DmaSerial::dma_map_t dma_maps[]= {
+    {USART1, USART1_IRQn, DMA2, RCC_AHB1ENR_DMA2EN, 4, DMA2_Stream2, 2, DMA2_Stream2_IRQn, DMA2_Stream7, 7, DMA2_Stream7_IRQn, usart1_irq, usart1_tx_irq},
+    {USART2, USART2_IRQn, DMA1, RCC_AHB1ENR_DMA1EN, 4, DMA1_Stream5, 5, DMA1_Stream5_IRQn, DMA1_Stream6, 6, DMA1_Stream6_IRQn, usart2_irq, usart2_tx_irq},
+};
+
+static void clear_flags(DMA_TypeDef *dma, uint8_t stream)
+{
+    static const uint8_t shift[4]= {0, 6, 16, 22};
+    uint32_t f= 0x3DUL << shift[stream & 3];
+    if(stream < 4) dma->LIFCR= f;
+    else dma->HIFCR= f;
+}
+
+static void stop_stream(DMA_Stream_TypeDef *s)
+{
+    s->CR &= ~DMA_SxCR_EN;
+    while(s->CR & DMA_SxCR_EN) ;
+}
+
+DmaSerial::DmaSerial(PinName tx, PinName rx, int baud_rate) : mbed::Serial(tx, rx)
+{
+    baud(baud_rate);
+
+    map= nullptr;
+    uint8_t index= 0;
+    for (auto& m : dma_maps) {
+        if((uint32_t)m.uart == (uint32_t)_serial.uart) {
+            map= &m;
+            break;
+        }
+        ++index;
+    }
+
+    if(map == nullptr) {
+        // no DMA streams for this UART, fall back to an interrupt per byte
+        attach(this, &DmaSerial::rx_irq, RxIrq);
+        return;
+    }
+
+    instances[index]= this;
+    RCC->AHB1ENR |= map->dma_clock;
+    (void)RCC->AHB1ENR;
+
+    // receive, runs forever in circular mode, interrupts at half and full as well as on idle line
+    DMA_Stream_TypeDef *s= map->rx_stream;
+    stop_stream(s);
+    clear_flags(map->dma, map->rx_stream_n);
+    s->PAR= (uint32_t)&map->uart->DR;
+    s->M0AR= (uint32_t)rx_ring.data();
+    s->NDTR= rx_ring.size();
+    s->FCR= 0; // direct mode
+    s->CR= (map->channel << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+    s->CR |= DMA_SxCR_EN;
+
+    // transmit, started for each contiguous run of the queue
+    s= map->tx_stream;
+    stop_stream(s);
+    clear_flags(map->dma, map->tx_stream_n);
+    s->PAR= (uint32_t)&map->uart->DR;
+    s->FCR= 0;
+    s->CR= (map->channel << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_MINC | DMA_SxCR_DIR_0 | DMA_SxCR_TCIE;
+
+    map->uart->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+    map->uart->CR1 |= USART_CR1_IDLEIE;
+
+    NVIC_SetVector(map->uart_irq, (uint32_t)map->uart_vector);
+    NVIC_SetVector(map->rx_irq, (uint32_t)map->uart_vector);
+    NVIC_SetVector(map->tx_irq, (uint32_t)map->tx_vector);
+    NVIC_SetPriority(map->uart_irq, DMA_SERIAL_IRQ_PRIORITY);
+    NVIC_SetPriority(map->rx_irq, DMA_SERIAL_IRQ_PRIORITY);
+    NVIC_SetPriority(map->tx_irq, DMA_SERIAL_IRQ_PRIORITY);
+    NVIC_EnableIRQ(map->uart_irq);
+    NVIC_EnableIRQ(map->rx_irq);
+    NVIC_EnableIRQ(map->tx_irq);
+}
+
+DmaSerial::~DmaSerial()
+{
+    if(map == nullptr) return;
+
+    // let anything queued go out first, the startup console is deleted once the config is loaded
+    while(is_sending() && __get_PRIMASK() == 0) ;
+
+    NVIC_DisableIRQ(map->uart_irq);
+    NVIC_DisableIRQ(map->rx_irq);
+    NVIC_DisableIRQ(map->tx_irq);
+    map->uart->CR1 &= ~USART_CR1_IDLEIE;
+    map->uart->CR3 &= ~(USART_CR3_DMAR | USART_CR3_DMAT);
+    stop_stream(map->rx_stream);
+    stop_stream(map->tx_stream);
+
+    instances[map - dma_maps]= nullptr;
+}
+
+// idle line, receive half and full interrupts, hands on what has been received since last time
+void DmaSerial::rx_irq()
+{
+    if(map == nullptr) {
+        while(readable()) {
+            char c= getc();
+            if(rx_fnc) rx_fnc(&c, 1);
+        }
+        return;
+    }
+
+    if(map->uart->SR & USART_SR_IDLE) {
+        (void)map->uart->DR; // reading SR then DR clears the idle flag, the DMA has already taken the data
+    }
+    clear_flags(map->dma, map->rx_stream_n);
+
+    rx_ring.consume(rx_ring.size() - map->rx_stream->NDTR, [this](const char *p, size_t n) {
+        if(rx_fnc) rx_fnc(p, n);
+    });
+}
+
+// transmit complete, send the next run of the queue if there is one
+void DmaSerial::tx_irq()
+{
+    clear_flags(map->dma, map->tx_stream_n);
+    tx_queue.advance(tx_len);
+    tx_busy= false;
+    start_tx();
+}
+
+// must not be interrupted by tx_irq
+void DmaSerial::start_tx()
+{
+    if(tx_busy) return;
+
+    const char *p;
+    uint16_t n= tx_queue.get_chunk(p);
+    if(n == 0) return;
+
+    tx_len= n;
+    tx_busy= true;
+    DMA_Stream_TypeDef *s= map->tx_stream;
+    clear_flags(map->dma, map->tx_stream_n);
+    s->M0AR= (uint32_t)p;
+    s->NDTR= n;
+    s->CR |= DMA_SxCR_EN;
+}
+
+// queue as much as there is room for and return straight away, returns how much was queued
+size_t DmaSerial::send(const char *s, size_t n)
+{
+    if(map == nullptr) {
+        for (size_t i = 0; i < n; ++i) putc(s[i]);
+        return n;
+    }
+
+    size_t k= tx_queue.put(s, n > 0xFFFF ? 0xFFFF : n);
+
+    NVIC_DisableIRQ(map->tx_irq);
+    start_tx();
+    NVIC_EnableIRQ(map->tx_irq);
+    return k;
+}
+
+// queue all of it, only waits if the queue is full
+size_t DmaSerial::send_all(const char *s, size_t n)
+{
+    size_t sent= 0;
+    while(sent < n) {
+        sent += send(s + sent, n - sent);
+        // the queue cannot empty from an interrupt or with interrupts off, so the rest is lost
+        if(sent < n && (__get_IPSR() != 0 || __get_PRIMASK() != 0)) break;
+    }
+    return sent;
+}
@@ -0,0 +1,52 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Serial.h" // mbed.h lib
+#include "DmaSerialBuffers.h"
+
+#include <functional>
+
+/*
+ * A UART that receives and sends with DMA, mbed::Serial sets up the pins and baud rate.
+ *
+ * The receive stream runs in circular mode, the received bytes are handed on when the line goes idle or the
+ * buffer is half full, so there is an interrupt per burst of bytes rather than per byte.
+ * Sending copies into a queue and returns, the queue is sent in the background.
+ *
+ * Only USART1 and USART2 have their DMA streams mapped, the buffers must not be in CCM as DMA cannot reach it.
+ */
+class DmaSerial : public mbed::Serial {
+    public:
+        DmaSerial(PinName tx, PinName rx, int baud_rate);
+        ~DmaSerial();
+
+        // called from the ISR with the bytes received
+        using rx_fnc_t= std::function<void(const char *, size_t)>;
+        void attach_rx(rx_fnc_t fnc) { rx_fnc= fnc; }
+
+        size_t send(const char *s, size_t n);
+        size_t send_all(const char *s, size_t n);
+        bool is_sending() const { return tx_busy || !tx_queue.is_empty(); }
+
+        void rx_irq();
+        void tx_irq();
+
+        struct dma_map_t; // the UART's DMA streams and interrupts
+
+    private:
+        void start_tx();
+
+        const dma_map_t *map;
+
+        DmaRxRing<128> rx_ring;
+        DmaTxQueue<512> tx_queue;
+        rx_fnc_t rx_fnc{nullptr};
+        uint16_t tx_len{0}; // length of the transfer in progress
+        volatile bool tx_busy{false};
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The receive and transmit buffers used by DmaSerial, they do not touch the hardware so they can be run on a host.
+ */
+
+// written by a DMA stream in circular mode, the ISR works out how far it has got from the DMA count and reads up to there
+template<uint16_t length> class DmaRxRing {
+    public:
+        char *data() { return buf; }
+        static uint16_t size() { return length; }
+
+        // calls fnc(const char *, size_t) with the bytes written since the last call, wrapping makes that two calls
+        // write_pos is length - NDTR, returns the number of bytes
+        template<typename F> uint16_t consume(uint16_t write_pos, F fnc)
+        {
+            if(write_pos >= length) write_pos= 0;
+
+            uint16_t n= 0;
+            if(write_pos < read_pos) {
+                fnc(&buf[read_pos], length - read_pos);
+                n= length - read_pos;
+                read_pos= 0;
+            }
+            if(write_pos > read_pos) {
+                fnc(&buf[read_pos], write_pos - read_pos);
+                n += write_pos - read_pos;
+                read_pos= write_pos;
+            }
+            return n;
+        }
+
+    private:
+        char buf[length];
+        uint16_t read_pos{0};
+};
+
+// filled by the main loop and sent by a DMA stream, each transfer is the contiguous run of bytes at the tail
+template<uint16_t length> class DmaTxQueue {
+    public:
+        bool is_empty() const { return head == tail; }
+        uint16_t room() const { return (tail + length - head - 1) % length; }
+
+        // called from the main loop, copies as much as there is room for and returns how much that was
+        uint16_t put(const char *s, uint16_t n)
+        {
+            uint16_t r= room();
+            if(n > r) n= r;
+
+            uint16_t h= head;
+            uint16_t first= length - h;
+            if(first > n) first= n;
+            memcpy(&buf[h], s, first);
+            memcpy(buf, s + first, n - first);
+            head= (h + n) % length;
+            return n;
+        }
+
+        // called from the ISR, sets p to the bytes for the next transfer and returns how many, 0 if there are none
+        uint16_t get_chunk(const char *&p) const
+        {
+            uint16_t h= head, t= tail;
+            p= &buf[t];
+            return h >= t ? h - t : length - t;
+        }
+
+        // called from the ISR when a transfer has finished
+        void advance(uint16_t n) { tail= (tail + n) % length; }
+
+    private:
+        char buf[length];
+        volatile uint16_t head{0};
+        volatile uint16_t tail{0};
+};
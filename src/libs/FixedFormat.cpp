@@ -0,0 +1,79 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FixedFormat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t pow10[]= {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+// A float is m * 2^e with a 24 bit m, so m * 10^decimals fits in 44 bits and the shift by e gives the exact
+// scaled value, rounding it half to even is what printf does with the exact value of the float.
+size_t format_fixed(char *buf, float value, int decimals)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative= (bits >> 31) != 0;
+    int exp= (bits >> 23) & 0xFF;
+    uint32_t m= bits & 0x7FFFFF;
+
+    // from 2^30 (about 1e9) up it is not a position, that also takes inf and nan
+    if(decimals < 0 || decimals > 6 || exp >= 127 + 30) {
+        int n= snprintf(buf, fixed_format_max, "%1.*f", decimals, value);
+        return (n < 0) ? 0 : ((size_t)n >= fixed_format_max ? fixed_format_max - 1 : n);
+    }
+
+    int e;
+    if(exp == 0) {
+        e= -149; // denormal
+    } else {
+        m |= 0x800000;
+        e= exp - 150;
+    }
+
+    uint64_t scaled= (uint64_t)m * pow10[decimals];
+    uint64_t q;
+    if(e >= 0) {
+        q= scaled << e;
+    } else if(e <= -63) {
+        q= 0; // scaled is under 2^44 so it is less than a half
+    } else {
+        int shift= -e;
+        q= scaled >> shift;
+        uint64_t rem= scaled & ((1ULL << shift) - 1);
+        uint64_t half= 1ULL << (shift - 1);
+        if(rem > half || (rem == half && (q & 1))) ++q;
+    }
+
+    char *p= buf;
+    if(negative) *p++ = '-'; // printf keeps the sign of -0.0 and of values that round to 0
+
+    // under 2^30 so the whole part fits 32 bits
+    uint32_t ip= q / pow10[decimals];
+    uint32_t fp= q - (uint64_t)ip * pow10[decimals];
+
+    char tmp[10];
+    int n= 0;
+    do {
+        tmp[n++]= '0' + ip % 10;
+        ip /= 10;
+    } while(ip != 0);
+    while(n > 0) *p++ = tmp[--n];
+
+    if(decimals > 0) {
+        *p++ = '.';
+        for (int i = decimals - 1; i >= 0; --i) {
+            p[i]= '0' + fp % 10;
+            fp /= 10;
+        }
+        p += decimals;
+    }
+    *p= '\0';
+    return p - buf;
+}
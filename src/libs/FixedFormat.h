@@ -0,0 +1,23 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// Writes value the same as printf("%1.<decimals>f") would, without the float printf, decimals is 0 to 6.
+// buf must hold fixed_format_max chars, it is null terminated and the length is returned.
+// Values too big to be positions, inf and nan go to snprintf.
+static const size_t fixed_format_max= 32;
+size_t format_fixed(char *buf, float value, int decimals);
+
+inline std::string& append_fixed(std::string& str, float value, int decimals)
+{
+    char buf[fixed_format_max];
+    return str.append(buf, format_fixed(buf, value, decimals));
+}
@@ -22,6 +22,7 @@
 
 #include "libs/StepTicker.h"
 #include "libs/PublicData.h"
+#include "libs/FixedFormat.h"
 #include "modules/communication/SerialConsole.h"
 #include "modules/communication/GcodeDispatch.h"
 #include "modules/robot/Planner.h"
@@ -135,7 +136,7 @@ Kernel::Kernel()
     // HAL stuff
     add_module( this->slow_ticker = new SlowTicker());
 
-    this->step_ticker = new StepTicker();
+    this->step_ticker = new(CCM) StepTicker(); // the step ISR state is hot so keep it in the zero wait state CCM
     this->adc = new Adc();
 
     // TODO : These should go into platform-specific files
@@ -184,28 +185,32 @@ Kernel::Kernel()
 }
 
 // return a GRBL-like query string for serial ?
-std::string Kernel::get_query_string()
+// the grbl state name, running is set if the position is changing
+const char *Kernel::get_state(bool& running)
 {
-    std::string str;
     bool homing;
     bool ok = PublicData::get_value(endstops_checksum, get_homing_status_checksum, 0, &homing);
     if(!ok) homing = false;
-    bool running = false;
 
-    str.append("<");
-    if(halted) {
-        str.append("Alarm");
-    } else if(homing) {
-        running = true;
-        str.append("Home");
-    } else if(feed_hold) {
-        str.append("Hold");
-    } else if(this->conveyor->is_idle()) {
-        str.append("Idle");
-    } else {
+    running = false;
+    if(halted) return "Alarm";
+    if(homing) {
         running = true;
-        str.append("Run");
+        return "Home";
     }
+    if(feed_hold) return "Hold";
+    if(this->conveyor->is_idle()) return "Idle";
+    running = true;
+    return "Run";
+}
+
+std::string Kernel::get_query_string()
+{
+    std::string str;
+    bool running;
+
+    str.append("<");
+    str.append(get_state(running));
 
     if(running) {
         float mpos[3];
@@ -213,86 +218,80 @@ std::string Kernel::get_query_string()
         // current_position/mpos includes the compensation transform so we need to get the inverse to get actual position
         if(robot->compensationTransform) robot->compensationTransform(mpos, true); // get inverse compensation transform
 
-        char buf[128];
         // machine position
-        size_t n = snprintf(buf, sizeof(buf), "%1.4f,%1.4f,%1.4f", robot->from_millimeters(mpos[0]), robot->from_millimeters(mpos[1]), robot->from_millimeters(mpos[2]));
-        if(n > sizeof(buf)) n= sizeof(buf);
-
-        str.append("|MPos:").append(buf, n);
+        str.append("|MPos:");
+        append_fixed(str, robot->from_millimeters(mpos[0]), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(mpos[1]), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(mpos[2]), 4);
 
 #if MAX_ROBOT_ACTUATORS > 3
         // deal with the ABC axis (E will be A)
         for (int i = A_AXIS; i < robot->get_number_registered_motors(); ++i) {
             // current actuator position
-            n = snprintf(buf, sizeof(buf), ",%1.4f", robot->from_millimeters(robot->actuators[i]->get_current_position()));
-            if(n > sizeof(buf)) n= sizeof(buf);
-            str.append(buf, n);
+            append_fixed(str.append(1, ','), robot->from_millimeters(robot->actuators[i]->get_current_position()), 4);
         }
 #endif
 
         // work space position
         Robot::wcs_t pos = robot->mcs2wcs(mpos);
-        n = snprintf(buf, sizeof(buf), "%1.4f,%1.4f,%1.4f", robot->from_millimeters(std::get<X_AXIS>(pos)), robot->from_millimeters(std::get<Y_AXIS>(pos)), robot->from_millimeters(std::get<Z_AXIS>(pos)));
-        if(n > sizeof(buf)) n= sizeof(buf);
-
-        str.append("|WPos:").append(buf, n);
+        str.append("|WPos:");
+        append_fixed(str, robot->from_millimeters(std::get<X_AXIS>(pos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Y_AXIS>(pos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Z_AXIS>(pos)), 4);
 
         // current feedrate and requested fr and override
         float fr= robot->from_millimeters(conveyor->get_current_feedrate()*60.0F);
         float frr= robot->from_millimeters(robot->get_feed_rate());
         float fro= 6000.0F / robot->get_seconds_per_minute();
-        n = snprintf(buf, sizeof(buf), "|F:%1.1f,%1.1f,%1.1f", fr, frr,fro);
-        if(n > sizeof(buf)) n= sizeof(buf);
-        str.append(buf, n);
+        str.append("|F:");
+        append_fixed(str, fr, 1).append(1, ',');
+        append_fixed(str, frr, 1).append(1, ',');
+        append_fixed(str, fro, 1);
 
+        // planned time left for the queued moves
+        append_fixed(str.append("|Time:"), conveyor->get_time_remaining(), 4);
 
         // current Laser power
         #ifndef NO_TOOLS_LASER
             Laser *plaser= nullptr;
             if(PublicData::get_value(laser_checksum, (void *)&plaser) && plaser != nullptr) {
                 float lp= plaser->get_current_power();
-                n = snprintf(buf, sizeof(buf), "|L:%1.4f", lp);
-                if(n > sizeof(buf)) n= sizeof(buf);
-                str.append(buf, n);
+                append_fixed(str.append("|L:"), lp, 4);
                 float sr= robot->get_s_value();
-                n = snprintf(buf, sizeof(buf), "|S:%1.4f", sr);
-                if(n > sizeof(buf)) n= sizeof(buf);
-                str.append(buf, n);
+                append_fixed(str.append("|S:"), sr, 4);
             }
         #endif
 
     } else {
         // return the last milestone if idle
-        char buf[128];
         // machine position
         Robot::wcs_t mpos = robot->get_axis_position();
-        size_t n = snprintf(buf, sizeof(buf), "%1.4f,%1.4f,%1.4f", robot->from_millimeters(std::get<X_AXIS>(mpos)), robot->from_millimeters(std::get<Y_AXIS>(mpos)), robot->from_millimeters(std::get<Z_AXIS>(mpos)));
-        if(n > sizeof(buf)) n= sizeof(buf);
-
-        str.append("|MPos:").append(buf, n);
+        str.append("|MPos:");
+        append_fixed(str, robot->from_millimeters(std::get<X_AXIS>(mpos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Y_AXIS>(mpos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Z_AXIS>(mpos)), 4);
 
 #if MAX_ROBOT_ACTUATORS > 3
         // deal with the ABC axis (E will be A)
         for (int i = A_AXIS; i < robot->get_number_registered_motors(); ++i) {
             // current actuator position
-            n = snprintf(buf, sizeof(buf), ",%1.4f", robot->from_millimeters(robot->actuators[i]->get_current_position()));
-            if(n > sizeof(buf)) n= sizeof(buf);
-            str.append(buf, n);
+            append_fixed(str.append(1, ','), robot->from_millimeters(robot->actuators[i]->get_current_position()), 4);
         }
 #endif
 
         // work space position
         Robot::wcs_t pos = robot->mcs2wcs(mpos);
-        n = snprintf(buf, sizeof(buf), "%1.4f,%1.4f,%1.4f", robot->from_millimeters(std::get<X_AXIS>(pos)), robot->from_millimeters(std::get<Y_AXIS>(pos)), robot->from_millimeters(std::get<Z_AXIS>(pos)));
-        if(n > sizeof(buf)) n= sizeof(buf);
-        str.append("|WPos:").append(buf, n);
+        str.append("|WPos:");
+        append_fixed(str, robot->from_millimeters(std::get<X_AXIS>(pos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Y_AXIS>(pos)), 4).append(1, ',');
+        append_fixed(str, robot->from_millimeters(std::get<Z_AXIS>(pos)), 4);
 
         // requested framerate, and override
         float fr= robot->from_millimeters(robot->get_feed_rate());
         float fro= 6000.0F / robot->get_seconds_per_minute();
-        n = snprintf(buf, sizeof(buf), "|F:%1.1f,%1.1f", fr, fro);
-        if(n > sizeof(buf)) n= sizeof(buf);
-        str.append(buf, n);
+        str.append("|F:");
+        append_fixed(str, fr, 1).append(1, ',');
+        append_fixed(str, fro, 1);
     }
 
     // if not grbl mode get temperatures
@@ -302,11 +301,10 @@ std::string Kernel::get_query_string()
         std::vector<struct pad_temperature> controllers;
         bool ok = PublicData::get_value(temperature_control_checksum, poll_controls_checksum, &controllers);
         if (ok) {
-            char buf[32];
             for (auto &c : controllers) {
-                size_t n= snprintf(buf, sizeof(buf), "|%s:%1.1f,%1.1f", c.designator.c_str(), c.current_temperature, c.target_temperature);
-                if(n > sizeof(buf)) n= sizeof(buf);
-                str.append(buf, n);
+                str.append(1, '|').append(c.designator).append(1, ':');
+                append_fixed(str, c.current_temperature, 1).append(1, ',');
+                append_fixed(str, c.target_temperature, 1);
             }
         }
     }
@@ -56,6 +56,7 @@ class Kernel {
         bool is_feed_hold_enabled() const { return enable_feed_hold; }
 
         std::string get_query_string();
+        const char *get_state(bool& running);
 
         // These modules are available to all other modules
         SerialConsole*    serial;
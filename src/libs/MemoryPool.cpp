@@ -81,6 +81,10 @@ void* MemoryPool::alloc(size_t nbytes)
     if (nbytes & 3)
         nbytes += 4 - (nbytes & 3);
 
+    // the region sizes are 16 bit so anything bigger than the pool must fail here
+    if (nbytes + sizeof(_poolregion) > size)
+        return NULL;
+
     // start at the start
     _poolregion* p = ((_poolregion*) base);
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+/*
+ * A small queue of output changes (switch pins, pwm etc) that are tied to a point in the block queue.
+ *
+ * Each event is tagged with the number of blocks that had been queued when it was issued,
+ * it is run by the step ticker ISR as soon as that many blocks have finished, so it happens between
+ * the block before it and the block after it without the block queue having to drain.
+ * An event issued while a motion channel has moves also waits for the channels to stop, and holds back the blocks after it
+ * while it does, as a block does for M401.
+ *
+ * Single producer (main loop) and single consumer (step ticker ISR), like the BlockQueue.
+ */
+class OutputEventQueue {
+    public:
+        // called from the ISR, must be quick
+        using output_fnc_t= void (*)(void *arg, float value);
+        static const uint8_t queue_size= 16;
+
+        bool is_empty() const { return head_i == tail_i; }
+        bool is_full() const { return next(head_i) == tail_i; }
+
+        // called from the main loop, returns false if there is no room
+        bool put(uint32_t sequence, output_fnc_t fnc, void *arg, float value, bool wait_for_channels= false)
+        {
+            if(is_full()) return false;
+            event_t& e= events[head_i];
+            e.sequence= sequence;
+            e.fnc= fnc;
+            e.arg= arg;
+            e.value= value;
+            e.wait_for_channels= wait_for_channels;
+            head_i= next(head_i);
+            return true;
+        }
+
+        // called from the ISR, runs the events that are due in the order they were queued, returns how many were run
+        int run(uint32_t finished_blocks, bool channels_busy= false)
+        {
+            int n= 0;
+            while(!is_empty()) {
+                event_t& e= events[tail_i];
+                if(!is_due(e, finished_blocks) || (e.wait_for_channels && channels_busy)) break;
+                e.fnc(e.arg, e.value);
+                tail_i= next(tail_i);
+                ++n;
+            }
+            return n;
+        }
+
+        // called from the ISR after run(), true if an event is due but waiting for the motion channels, the next block must
+        // wait for it
+        bool is_waiting(uint32_t finished_blocks) const { return !is_empty() && is_due(events[tail_i], finished_blocks); }
+
+        // called from the ISR when the block queue is flushed, the events are dropped
+        void flush() { tail_i= head_i; }
+
+    private:
+        uint8_t next(uint8_t i) const { return (i + 1) % queue_size; }
+
+        struct event_t {
+            uint32_t sequence;
+            output_fnc_t fnc;
+            void *arg;
+            float value;
+            bool wait_for_channels;
+        };
+
+        // the counts wrap so compare the difference
+        static bool is_due(const event_t& e, uint32_t finished_blocks) { return (int32_t)(finished_blocks - e.sequence) >= 0; }
+
+        std::array<event_t, queue_size> events;
+        volatile uint8_t head_i{0};
+        volatile uint8_t tail_i{0};
+};
@@ -0,0 +1,109 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cmsis.h"
+#include "ActuatorCoordinates.h"
+
+// Groups the step pins of the motors by GPIO port so the step ticker can set all the pins stepped in a tick
+// with a single BSRR write per port, and clear them again with one more write per port.
+// The masks are precomputed when the motors are registered, inverting pins use the reset half of BSRR to step.
+class StepPortGroups {
+    public:
+        StepPortGroups() : num_groups(0) {
+            for (size_t m = 0; m < k_max_actuators; ++m) group_of[m]= NO_GROUP;
+        }
+
+        // add the step pin of a motor, pin is 0-15 on port
+        void add(uint8_t motor, GPIO_TypeDef *port, uint8_t pin, bool inverting)
+        {
+            if(motor >= k_max_actuators || port == nullptr || pin > 15) return;
+
+            // find the group for this port or start a new one
+            uint8_t g= 0;
+            while(g < num_groups && groups[g].bsrr != &port->BSRR) ++g;
+            if(g == num_groups) {
+                groups[g].bsrr= &port->BSRR;
+                groups[g].step_bits= 0;
+                groups[g].unstep_bits= 0;
+                groups[g].all_unstep_bits= 0;
+                ++num_groups;
+            }
+
+            uint32_t set= 1UL << pin, reset= (1UL << 16) << pin;
+            step_mask[motor]= inverting ? reset : set;
+            unstep_mask[motor]= inverting ? set : reset;
+            groups[g].all_unstep_bits |= unstep_mask[motor];
+            group_of[motor]= g;
+        }
+
+        // mark a motor as stepping this tick, the pins are set by flush()
+        inline void step(uint8_t motor)
+        {
+            uint8_t g= group_of[motor];
+            if(g == NO_GROUP) return;
+            groups[g].step_bits |= step_mask[motor];
+            groups[g].unstep_bits |= unstep_mask[motor];
+        }
+
+        // set the step pins marked this tick, one write per port, returns true if any were set
+        inline bool flush()
+        {
+            bool any= false;
+            for (uint8_t g = 0; g < num_groups; ++g) {
+                if(groups[g].step_bits != 0) {
+                    *groups[g].bsrr= groups[g].step_bits;
+                    groups[g].step_bits= 0;
+                    any= true;
+                }
+            }
+            return any;
+        }
+
+        // clear the step pins set since the last unstep, one write per port
+        inline void unstep()
+        {
+            for (uint8_t g = 0; g < num_groups; ++g) {
+                if(groups[g].unstep_bits != 0) {
+                    *groups[g].bsrr= groups[g].unstep_bits;
+                    groups[g].unstep_bits= 0;
+                }
+            }
+        }
+
+        // clear every registered step pin
+        void unstep_all()
+        {
+            for (uint8_t g = 0; g < num_groups; ++g) {
+                *groups[g].bsrr= groups[g].all_unstep_bits;
+                groups[g].step_bits= 0;
+                groups[g].unstep_bits= 0;
+            }
+        }
+
+        uint8_t get_num_groups() const { return num_groups; }
+
+    private:
+        static const uint8_t NO_GROUP= 0xFF;
+
+        struct group_t {
+            volatile uint32_t *bsrr;
+            uint32_t step_bits;       // BSRR value to write to set the pins stepped this tick
+            uint32_t unstep_bits;     // BSRR value to write to clear the pins stepped since the last unstep
+            uint32_t all_unstep_bits; // BSRR value to clear all the step pins on this port
+        };
+
+        group_t groups[k_max_actuators];
+        uint32_t step_mask[k_max_actuators];
+        uint32_t unstep_mask[k_max_actuators];
+        uint8_t group_of[k_max_actuators];
+        uint8_t num_groups;
+};
@@ -15,9 +15,11 @@
 #include "StreamOutputPool.h"
 #include "Block.h"
 #include "Conveyor.h"
+#include "platform_memory.h"
 
 #include "stm32f407xx.h" // mbed.h lib
 #include <math.h>
+#include <algorithm>
 #include <mri.h>
 
 #ifdef STEPTICKER_DEBUG_PIN
@@ -36,7 +38,7 @@ extern "C" void TIM8_TRG_COM_TIM14_IRQHandler(void);
 extern "C" void TIM7_IRQHandler(void);
 extern "C" void PendSV_Handler(void);
 
-StepTicker *StepTicker::instance;
+StepTicker *StepTicker::instance CCM_SECTION;
 
 StepTicker::StepTicker()
 {
@@ -57,11 +59,13 @@ StepTicker::StepTicker()
     this->set_frequency(100000);
     this->set_unstep_time(5);
 
-    this->unstep.reset();
     this->num_motors = 0;
+    this->num_channels = 0;
 
     this->running = false;
     this->current_block = nullptr;
+    this->tick_state.fill(motor_tick_t{});
+    for(auto& pt : triggers) pt.state= TRIGGER_FREE;
 
     #ifdef STEPTICKER_DEBUG_PIN
     // setup debug pin if defined
@@ -110,12 +114,7 @@ void StepTicker::set_unstep_time( float microseconds )
 // Reset step pins on any motor that was stepped
 void StepTicker::unstep_tick()
 {
-    for (int i = 0; i < num_motors; i++) {
-        if(this->unstep[i]) {
-            this->motor[i]->unstep();
-        }
-    }
-    this->unstep.reset();
+    step_ports.unstep();
 }
 
 extern "C" void TIM8_TRG_COM_TIM14_IRQHandler (void)
@@ -144,18 +143,342 @@ void StepTicker::handle_finish (void)
     if(finished_fnc) finished_fnc();
 }
 
+// set the step pins for this tick and start the unstep timer
+inline void StepTicker::flush_steps()
+{
+    if(step_ports.flush()) {
+        // CEN should have cleared by one-shot mode
+        TIM14->CR1 |= TIM_CR1_CEN;
+    }
+}
+
+// work out a motor's rate for this tick from its running state and the tick info of its move
+inline void StepTicker::update_rate(motor_tick_t& t, const Block::tickinfo_t& ti, uint32_t tick, uint32_t total_move_ticks, bool s_curve)
+{
+    t.steps_per_tick += t.acceleration_change;
+
+    if(tick == t.next_accel_event) {
+        if(tick == t.accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
+            t.acceleration_change = 0;
+            if(t.decelerate_after < total_move_ticks) {
+                t.next_accel_event = t.decelerate_after;
+                if(tick != t.decelerate_after) { // We are plateauing
+                    // steps/sec / tick frequency to get steps per tick
+                    t.steps_per_tick = ti.plateau_rate;
+                }
+            }
+        }
+
+        if(tick == t.decelerate_after) { // We start decelerating, S-curves ramp the deceleration up from 0
+            t.acceleration_change = s_curve ? 0 : -ti.decel;
+        }
+    }
+
+    // protect against rounding errors and such
+    if(t.steps_per_tick <= 0) {
+        t.counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
+        t.steps_per_tick = 0;
+    }
+}
+
+// for S-curve blocks ramp the acceleration by the jerk, see step_tick() for the phases
+inline void StepTicker::apply_jerk(motor_tick_t& t, const Block::tickinfo_t& ti, int jerk_phase)
+{
+    switch(jerk_phase) {
+        case 1:  t.acceleration_change += ti.accel; break;
+        case -1: t.acceleration_change -= ti.accel; break;
+        case -2: t.acceleration_change -= ti.decel; break;
+        case 2:  t.acceleration_change += ti.decel; break;
+    }
+}
+
+// advance one motor by one tick using its running state and the tick info of its move, issues a step when it is time
+// returns true if the motor is still moving
+inline bool StepTicker::step_motor(uint8_t m, motor_tick_t& t, const Block::tickinfo_t& ti, uint32_t tick, uint32_t total_move_ticks, bool s_curve)
+{
+    update_rate(t, ti, tick, total_move_ticks, s_curve);
+
+    t.counter += t.steps_per_tick;
+
+    if(t.counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
+        t.counter -= STEPTICKER_FPSCALE; // -= 1.0F;
+        ++t.step_count;
+
+        // step the motor, the pin is set with the other motors on the same port in flush_steps()
+        step_ports.step(m);
+        bool ismoving= motor[m]->stepped(); // returns false if the moving flag was set to false externally (probes, endstops etc)
+
+        if(!ismoving || t.step_count == t.steps_to_move) {
+            // done
+            t.steps_to_move = 0;
+            motor[m]->stop_moving(); // let motor know it is no longer moving
+        }
+    }
+
+    return motor[m]->is_moving();
+}
+
+// at the end of each chord of an arc block work out each motor's share of the path to the end of the next one, from where
+// the motor is now so it does not drift from the arc, the last chord goes to the block's steps
+void StepTicker::next_chord()
+{
+    const Block::arc_t& arc= *current_block->arc;
+    arc_tick_t& a= arc_state;
+    motor_tick_t& p= a.path;
+
+    a.chord++;
+    bool last= a.chord >= arc.chords;
+    a.chord_end= last ? current_block->steps_event_count : a.chord * (current_block->steps_event_count / arc.chords);
+
+    // turn to the end of the chord, keeping cos² + sin² at 1 so the rounding does not build up over the chords
+    float c= a.cos * arc.cos_theta - a.sin * arc.sin_theta;
+    float s= a.sin * arc.cos_theta + a.cos * arc.sin_theta;
+    float k= 1.5F - 0.5F * (c * c + s * s);
+    a.cos= c * k;
+    a.sin= s * k;
+
+    float inv= 1.0F / (a.chord_end - p.step_count);
+    for (uint8_t m = 0; m < 3; m++) {
+        motor_tick_t& t= tick_state[m];
+        if(t.steps_to_move == 0) continue; // not moving or done
+
+        float target= current_block->steps[m];
+        if(!last) {
+            float x= arc.u[m] * (a.cos - 1.0F) + arc.v[m] * a.sin + arc.w[m] * a.chord;
+            if(x < target) target= x > 0 ? x : 0;
+        }
+
+        // from where the motor is including what its counter has built up less the half step it started with, else a
+        // motor that has stopped short of a step waiting for the next chord takes it at the start of that chord and runs
+        // ahead of the arc
+        float at= t.step_count + STEPTICKER_FROMFP(t.counter) - 0.5F;
+
+        // capped at the path's rate, a motor that is behind catches up over the next chords
+        float share= target > at ? (target - at) * inv : 0;
+        a.share[m]= share >= 1.0F ? (1 << 30) : share * (1 << 30);
+    }
+}
+
+// advance an arc block by one tick, the path by its trapezoid and the motors by their shares of its rate
+// returns true if the path or a motor is still moving
+inline bool StepTicker::tick_arc(int jerk_phase)
+{
+    motor_tick_t& p= arc_state.path;
+    bool still_moving= false;
+
+    if(p.steps_to_move != 0) {
+        const Block::tickinfo_t& ti= current_block->arc->path;
+        if(jerk_phase != 0) apply_jerk(p, ti, jerk_phase);
+        update_rate(p, ti, current_tick, current_block->total_move_ticks, current_block->is_s_curve);
+
+        // the path has no pin so it can do more than a step a tick, unsigned as it can be up to 2.0 + 1.0
+        uint64_t counter= (uint64_t)p.counter + (uint64_t)p.steps_per_tick;
+        while(counter >= STEPTICKER_FPSCALE && p.steps_to_move != 0) {
+            counter -= STEPTICKER_FPSCALE;
+            if(++p.step_count == p.steps_to_move) p.steps_to_move= 0;
+            else if(p.step_count == arc_state.chord_end) next_chord();
+        }
+        p.counter= counter;
+        still_moving= true;
+    }
+
+    // 2.30 fixed point
+    int32_t rate= p.steps_per_tick >> 32;
+    for (uint8_t m = 0; m < 3; m++) {
+        motor_tick_t& t= tick_state[m];
+        if(t.steps_to_move == 0) continue; // not active
+
+        if(p.steps_to_move != 0) {
+            // 2.30 by 2.30 is 4.60, never more than a step a tick
+            t.steps_per_tick= std::min<int64_t>(((int64_t)rate * arc_state.share[m]) << 2, STEPTICKER_FPSCALE);
+        } else {
+            // the path has got to the end, what is left goes out a step a tick as it does for a motor at the end of a block
+            t.steps_per_tick= STEPTICKER_FPSCALE;
+        }
+
+        t.counter += t.steps_per_tick;
+        if(t.counter >= STEPTICKER_FPSCALE) {
+            t.counter -= STEPTICKER_FPSCALE;
+            ++t.step_count;
+
+            step_ports.step(m);
+            bool ismoving= motor[m]->stepped();
+
+            if(!ismoving || t.step_count == t.steps_to_move) {
+                t.steps_to_move = 0;
+                motor[m]->stop_moving();
+            }
+        }
+
+        if(motor[m]->is_moving()) still_moving= true;
+    }
+
+    return still_moving;
+}
+
+// tick the motors of each motion channel, the channel moves run alongside the blocks
+void StepTicker::tick_channels()
+{
+    bool halted= THEKERNEL->is_halted();
+
+    for (uint8_t c = 0; c < num_channels; c++) {
+        channel_state_t& cs= channel_state[c];
+        MotionChannel *channel= cs.channel;
+
+        if(halted) {
+            // drop the current move and anything queued
+            if(cs.move != nullptr) {
+                for (uint8_t i = 0; i < channel->get_num_motors(); i++) {
+                    cs.tick_state[i].steps_to_move= 0;
+                    motor[channel->get_motor(i)]->stop_moving();
+                }
+                cs.move= nullptr;
+            }
+            channel->flush();
+            continue;
+        }
+
+        if(cs.move == nullptr) {
+            // the next move can start once the blocks queued before it have finished
+            cs.move= channel->get_next_move(THECONVEYOR->get_blocks_finished());
+            if(cs.move == nullptr) continue;
+            start_channel_move(cs);
+        }
+
+        bool still_moving= false;
+        for (uint8_t i = 0; i < channel->get_num_motors(); i++) {
+            motor_tick_t& t= cs.tick_state[i];
+            if(t.steps_to_move == 0) continue; // not active
+
+            if(step_motor(channel->get_motor(i), t, cs.move->tick_info[i], cs.current_tick, cs.move->total_move_ticks, false)) still_moving= true;
+        }
+
+        cs.current_tick++;
+
+        if(!still_moving) {
+            // move finished, the next one can start on the next tick
+            cs.move= nullptr;
+            channel->move_finished();
+        }
+    }
+}
+
+void StepTicker::take_snapshot()
+{
+    for (uint8_t m = 0; m < num_motors; m++) {
+        snapshot.steps[m]= motor[m]->get_current_step();
+    }
+    snapshot.moving= running;
+    snapshot_requested= false;
+}
+
+// fire any position triggers whose motor has reached its target
+inline void StepTicker::tick_triggers()
+{
+    for(auto& pt : triggers) {
+        if(pt.state == TRIGGER_FREE) continue;
+
+        if(THEKERNEL->is_halted()) {
+            // dropped like the blocks are, the outputs are set to their fail safe values on halt
+            pt.state= TRIGGER_FREE;
+            continue;
+        }
+
+        if(pt.state == TRIGGER_PULSING) {
+            if(--pt.pulse_ticks == 0) {
+                pt.fnc(pt.arg, pt.pulse_value);
+                pt.state= TRIGGER_FREE;
+            }
+            continue;
+        }
+
+        int32_t pos= (int32_t)motor[pt.motor]->get_current_step();
+
+        if(pt.state == TRIGGER_PENDING) {
+            // armed once the blocks queued before it have finished, the counts wrap so compare the difference
+            if((int32_t)(THECONVEYOR->get_blocks_finished() - pt.sequence) < 0) continue;
+            // the side it is on now is the one it has to cross from, if it is already at the target it fires now
+            pt.state= pos < pt.target ? TRIGGER_BELOW : TRIGGER_ABOVE;
+        }
+
+        // the moves it is for have all run without reaching the target (one stopped short or turned back), so it is dropped
+        // without changing the output rather than holding the slot. They end at the next trigger, or when the queue runs dry
+        uint32_t finished= THECONVEYOR->get_blocks_finished();
+        if((pt.closed && (int32_t)(finished - pt.until) >= 0) ||
+           (!running && finished != pt.sequence && finished == THECONVEYOR->get_blocks_queued() && !is_channel_busy())) {
+            pt.state= TRIGGER_FREE;
+            continue;
+        }
+
+        if((pt.state == TRIGGER_BELOW && pos >= pt.target) || (pt.state == TRIGGER_ABOVE && pos <= pt.target)) {
+            pt.fnc(pt.arg, pt.value);
+            pt.state= pt.pulse_ticks > 0 ? TRIGGER_PULSING : TRIGGER_FREE;
+        }
+    }
+}
+
+// called from the main loop after add_position_trigger() failed, true if a trigger is free now or will be without any more
+// moves being queued, the others are for the moves that will be queued after them so waiting for them would never end
+bool StepTicker::position_trigger_can_free() const
+{
+    for(auto& pt : triggers) {
+        if(pt.state == TRIGGER_FREE || pt.state == TRIGGER_PULSING || pt.closed) return true;
+    }
+    return false;
+}
+
+// called from the ISR when the block queue is flushed, the triggers for the moves that were dropped go with them
+void StepTicker::flush_position_triggers()
+{
+    for(auto& pt : triggers) {
+        if(pt.state != TRIGGER_PULSING) pt.state= TRIGGER_FREE;
+    }
+}
+
+// setup the running state of the channel motors for a new move, each motor starts from rest accelerating
+void StepTicker::start_channel_move(channel_state_t& cs)
+{
+    MotionChannel *channel= cs.channel;
+    for (uint8_t i = 0; i < channel->get_num_motors(); i++) {
+        motor_tick_t& t= cs.tick_state[i];
+        t.steps_to_move= cs.move->steps[i];
+        if(t.steps_to_move == 0) continue;
+
+        const Block::tickinfo_t& ti= cs.move->tick_info[i];
+        t.steps_per_tick= 0;
+        t.counter= 0;
+        t.step_count= 0;
+        t.accelerate_until= ti.ramp.accelerate_until;
+        t.decelerate_after= ti.ramp.decelerate_after;
+        t.next_accel_event= t.accelerate_until;
+        t.acceleration_change= ti.accel;
+
+        uint8_t m= channel->get_motor(i);
+        motor[m]->set_direction(cs.move->direction_bits & (1 << i));
+        motor[m]->start_moving();
+    }
+
+    cs.current_tick= 0;
+}
+
 // step clock
 void StepTicker::step_tick (void)
 {
     //SET_STEPTICKER_DEBUG_PIN(running ? 1 : 0);
 
+    // the motion channels go first so their steps are set with the block's steps
+    if(num_channels > 0) tick_channels();
+
     // if nothing has been setup we ignore the ticks
     if(!running){
         // check if anything new available
         if(THECONVEYOR->get_next_block(&current_block)) { // returns false if no new block is available
             running= start_next_block(); // returns true if there is at least one motor with steps to issue
-            if(!running) return;
-        }else{
+        }
+        if(!running) {
+            tick_triggers(); // a motion channel may have moved
+            if(snapshot_requested) take_snapshot();
+            flush_steps();
             return;
         }
     }
@@ -167,69 +490,52 @@ void StepTicker::step_tick (void)
         return;
     }
 
-    bool still_moving= false;
-    // foreach motor, if it is active see if time to issue a step to that motor
-    for (uint8_t m = 0; m < num_motors; m++) {
-        if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
-
-        current_block->tick_info[m].steps_per_tick += current_block->tick_info[m].acceleration_change;
-
-        if(current_tick == current_block->tick_info[m].next_accel_event) {
-            if(current_tick == current_block->accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
-                current_block->tick_info[m].acceleration_change = 0;
-                if(current_block->decelerate_after < current_block->total_move_ticks) {
-                    current_block->tick_info[m].next_accel_event = current_block->decelerate_after;
-                    if(current_tick != current_block->decelerate_after) { // We are plateauing
-                        // steps/sec / tick frequency to get steps per tick
-                        current_block->tick_info[m].steps_per_tick = current_block->tick_info[m].plateau_rate;
-                    }
-                }
-            }
-
-            if(current_tick == current_block->decelerate_after) { // We start decelerating
-                current_block->tick_info[m].acceleration_change = current_block->tick_info[m].deceleration_change;
-            }
+    // for S-curve blocks work out if the acceleration is being ramped this tick, this is the same for all motors
+    // 1/-1 ramps up/down by the accel jerk at the start/end of acceleration, -2/2 by the decel jerk at the start/end of deceleration
+    int jerk_phase= 0;
+    if(current_block->is_s_curve) {
+        if(current_tick < current_block->accelerate_until) {
+            if(current_tick < current_block->accel_jerk_ticks) jerk_phase= 1;
+            else if(current_tick >= current_block->accelerate_until - current_block->accel_jerk_ticks) jerk_phase= -1;
+
+        }else if(current_tick > current_block->decelerate_after) {
+            if(current_tick <= current_block->decelerate_after + current_block->decel_jerk_ticks) jerk_phase= -2;
+            else if(current_tick > current_block->total_move_ticks - current_block->decel_jerk_ticks) jerk_phase= 2;
         }
+    }
 
-        // protect against rounding errors and such
-        if(current_block->tick_info[m].steps_per_tick <= 0) {
-            current_block->tick_info[m].counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
-            current_block->tick_info[m].steps_per_tick = 0;
-        }
+    bool still_moving= false;
+    if(current_block->arc != nullptr) {
+        still_moving= tick_arc(jerk_phase);
 
-        current_block->tick_info[m].counter += current_block->tick_info[m].steps_per_tick;
+    } else {
+        // foreach motor, if it is active see if time to issue a step to that motor
+        for (uint8_t m = 0; m < num_motors; m++) {
+            motor_tick_t& t= tick_state[m];
+            if(t.steps_to_move == 0) continue; // not active
 
-        if(current_block->tick_info[m].counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
-            current_block->tick_info[m].counter -= STEPTICKER_FPSCALE; // -= 1.0F;
-            ++current_block->tick_info[m].step_count;
+            const Block::tickinfo_t& ti= current_block->tick_info[m];
 
-            // step the motor
-            bool ismoving= motor[m]->step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
-            // we stepped so schedule an unstep
-            unstep.set(m);
+            if(jerk_phase != 0) apply_jerk(t, ti, jerk_phase);
 
-            if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
-                // done
-                current_block->tick_info[m].steps_to_move = 0;
-                motor[m]->stop_moving(); // let motor know it is no longer moving
-            }
+            // see if any motors are still moving after this tick
+            if(step_motor(m, t, ti, current_tick, current_block->total_move_ticks, current_block->is_s_curve)) still_moving= true;
         }
-
-        // see if any motors are still moving after this tick
-        if(motor[m]->is_moving()) still_moving= true;
     }
 
     // do this after so we start at tick 0
     current_tick++; // count number of ticks
 
+    // the positions now include this tick's steps so a trigger fires with the step that reaches its target
+    tick_triggers();
+    if(snapshot_requested) take_snapshot();
+
     // We may have set a pin on in this tick, now we reset the timer to set it off
+    // all the step pins on a port are set with one write so they have no skew between them
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
     // also it takes at least 2us to get here so even when set to 1us pulse width it will still be about 3us
-    if( unstep.any()) {
-        // CEN should have cleared by one-shot mode
-        TIM14->CR1 |= TIM_CR1_CEN;
-    }
+    flush_steps();
 
 
     // see if any motors are still moving
@@ -266,7 +572,31 @@ bool StepTicker::start_next_block()
     bool ok= false;
     // need to prepare each active motor
     for (uint8_t m = 0; m < num_motors; m++) {
-        if(current_block->tick_info[m].steps_to_move == 0) continue;
+        motor_tick_t& t= tick_state[m];
+        t.steps_to_move= current_block->steps[m];
+        if(t.steps_to_move == 0) continue;
+
+        // setup the running state from the block, the first accel event and the initial acceleration are the same for all motors
+        const Block::tickinfo_t& ti= current_block->tick_info[m];
+        t.counter= 0;
+        t.step_count= 0;
+        if(current_block->is_independent) {
+            // each motor has its own trapezoid and starts from rest accelerating
+            t.steps_per_tick= 0;
+            t.accelerate_until= ti.ramp.accelerate_until;
+            t.decelerate_after= ti.ramp.decelerate_after;
+            t.next_accel_event= t.accelerate_until;
+            t.acceleration_change= ti.accel;
+
+        } else if(current_block->arc != nullptr) {
+            // the rate comes from the path each tick, starting half a step in so the steps land nearest to the arc
+            t.steps_per_tick= 0;
+            t.acceleration_change= 0;
+            t.counter= STEPTICKER_FPSCALE / 2;
+
+        } else {
+            setup_tick_state(t, ti);
+        }
 
         ok= true; // mark at least one motor is moving
         // set direction bit here
@@ -278,6 +608,19 @@ bool StepTicker::start_next_block()
 
     current_tick= 0;
 
+    if(ok && current_block->arc != nullptr) {
+        // the path starts off like a motor moving steps_event_count steps
+        motor_tick_t& p= arc_state.path;
+        p.steps_to_move= current_block->steps_event_count;
+        p.counter= 0;
+        p.step_count= 0;
+        setup_tick_state(p, current_block->arc->path);
+        arc_state.chord= 0;
+        arc_state.cos= 1.0F;
+        arc_state.sin= 0.0F;
+        next_chord();
+    }
+
     if(ok) {
         //SET_STEPTICKER_DEBUG_PIN(1);
         return true;
@@ -292,9 +635,114 @@ bool StepTicker::start_next_block()
 }
 
 
+// setup the running state of a motor from the tick info of a block that runs on the block's trapezoid
+void StepTicker::setup_tick_state(motor_tick_t& t, const Block::tickinfo_t& ti)
+{
+    t.steps_per_tick= ti.steps_per_tick;
+    t.accelerate_until= current_block->accelerate_until;
+    t.decelerate_after= current_block->decelerate_after;
+    t.next_accel_event= current_block->total_move_ticks + 1;
+    t.acceleration_change= 0;
+    if(current_block->accelerate_until != 0) { // If the next accel event is the end of accel
+        t.next_accel_event= current_block->accelerate_until;
+        if(!current_block->is_s_curve) t.acceleration_change= ti.accel;
+
+    } else if(current_block->decelerate_after == 0) {
+        // we start off decelerating
+        if(!current_block->is_s_curve) t.acceleration_change= -ti.decel;
+
+    } else if(current_block->decelerate_after != current_block->total_move_ticks) {
+        // If the next event is the start of decel ( don't set this if the next accel event is accel end )
+        t.next_accel_event= current_block->decelerate_after;
+    }
+}
+
+// returns current rate (steps/sec) for the given actuator of the current block
+float StepTicker::get_trapezoid_rate(int i) const
+{
+    // convert steps per tick from fixed point to float and convert to steps/sec
+    // FIXME steps_per_tick can change at any time, potential race condition if it changes while being read here
+    return STEPTICKER_FROMFP(tick_state[i].steps_per_tick) * frequency;
+}
+
+// returns true if a motion channel is running a move or has one ready to start
+// called from the main loop and from the step ticker ISR when a block has to wait for the channels (M401)
+bool StepTicker::is_channel_busy() const
+{
+    for (uint8_t c = 0; c < num_channels; c++) {
+        const channel_state_t& cs= channel_state[c];
+        if(cs.move != nullptr || cs.channel->get_next_move(THECONVEYOR->get_blocks_finished()) != nullptr) return true;
+    }
+    return false;
+}
+
+// returns true if a motion channel is running a move or has any queued, whether or not they can start yet
+// called from the main loop
+bool StepTicker::has_channel_moves() const
+{
+    for (uint8_t c = 0; c < num_channels; c++) {
+        const channel_state_t& cs= channel_state[c];
+        if(cs.move != nullptr || !cs.channel->is_empty()) return true;
+    }
+    return false;
+}
+
+// called from the main loop, arms an output change for when the motor reaches target steps during the moves queued after this
+// up to the next trigger, returns false if all the triggers are in use, they are freed as they fire or their moves finish
+bool StepTicker::add_position_trigger(uint8_t motor, int32_t target, uint32_t pulse_ticks, OutputEventQueue::output_fnc_t fnc, void *arg, float value, float pulse_value)
+{
+    if(motor >= num_motors) return false;
+
+    // the triggers that have had moves queued since they were added are for those moves only, the ones added since the last
+    // move are for the same moves as this one
+    uint32_t sequence= THECONVEYOR->get_sequence_point();
+    for(auto& pt : triggers) {
+        if(pt.state == TRIGGER_FREE || pt.state == TRIGGER_PULSING || pt.closed || pt.sequence == sequence) continue;
+        pt.until= sequence;
+        pt.closed= true;
+    }
+
+    for(auto& pt : triggers) {
+        if(pt.state != TRIGGER_FREE) continue;
+
+        pt.sequence= sequence;
+        pt.closed= false;
+        pt.target= target;
+        pt.pulse_ticks= pulse_ticks;
+        pt.fnc= fnc;
+        pt.arg= arg;
+        pt.value= value;
+        pt.pulse_value= pulse_value;
+        pt.motor= motor;
+        // the ISR does not look at it until this is set
+        pt.state= TRIGGER_PENDING;
+        return true;
+    }
+
+    return false;
+}
+
+// add a motion channel, its motors must already be registered and are then only moved by the channel
+bool StepTicker::register_channel(MotionChannel* channel)
+{
+    if(num_channels >= k_max_channels) return false;
+
+    channel_state_t& cs= channel_state[num_channels];
+    cs.channel= channel;
+    cs.move= nullptr;
+    cs.current_tick= 0;
+    cs.tick_state.fill(motor_tick_t{});
+    num_channels++;
+    return true;
+}
+
 // returns index of the stepper motor in the array and bitset
 int StepTicker::register_motor(StepperMotor* m)
 {
+    const Pin& step_pin= m->get_step_pin();
+    if(step_pin.connected()) {
+        step_ports.add(num_motors, step_pin.port, step_pin.pin, step_pin.is_inverting());
+    }
     motor[num_motors++] = m;
     return num_motors - 1;
 }
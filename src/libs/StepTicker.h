@@ -10,6 +10,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <math.h>
 #include <array>
 #include <bitset>
 #include <functional>
@@ -17,6 +18,9 @@
 
 #include "ActuatorCoordinates.h"
 #include "TSRingBuffer.h"
+#include "StepPortGroups.h"
+#include "MotionChannel.h"
+#include "OutputEventQueue.h"
 
 class StepperMotor;
 class Block;
@@ -24,6 +28,8 @@ class Block;
 // handle 2.62 Fixed point
 #define STEPTICKER_FPSCALE (1LL<<62)
 #define STEPTICKER_FROMFP(x) ((float)(x)/STEPTICKER_FPSCALE)
+// single precision only, scaling by 2^62 is exact so the error is that of the float (|x| must be < 2.0)
+#define STEPTICKER_TOFP(x) ((int64_t)llroundf((float)(x)*(float)STEPTICKER_FPSCALE))
 
 class StepTicker{
     public:
@@ -32,9 +38,30 @@ class StepTicker{
         void set_frequency( float frequency );
         void set_unstep_time( float microseconds );
         int register_motor(StepperMotor* motor);
+        bool register_channel(MotionChannel* channel);
+        bool is_channel_busy() const;
+        bool has_channel_moves() const;
+        bool add_position_trigger(uint8_t motor, int32_t target, uint32_t pulse_ticks, OutputEventQueue::output_fnc_t fnc, void *arg, float value, float pulse_value);
+        bool position_trigger_can_free() const;
+        void flush_position_triggers();
         float get_frequency() const { return frequency; }
+
+        // all the motor positions copied in one tick, so a status report has them from the same moment
+        // the main loop asks for one and the ISR takes it on its next tick, there is no cost to the ISR otherwise
+        struct position_snapshot_t {
+            int32_t steps[k_max_actuators];
+            bool moving;
+        };
+        void request_snapshot() { snapshot_requested= true; }
+        bool is_snapshot_ready() const { return !snapshot_requested; }
+        const position_snapshot_t& get_snapshot() const { return snapshot; }
         void unstep_tick();
         const Block *get_current_block() const { return current_block; }
+        // ticks done of the current block, the ISR changes it so it is read through volatile
+        uint32_t get_current_tick() const { return *(volatile const uint32_t *)&current_tick; }
+        float get_trapezoid_rate(int i) const;
+        // the rate along the path of the current arc block in steps/sec, its motors' rates change with the direction
+        float get_path_rate() const { return STEPTICKER_FROMFP(arc_state.path.steps_per_tick) * frequency; }
 
         void step_tick (void);
         void handle_finish (void);
@@ -49,17 +76,85 @@ class StepTicker{
         static StepTicker *instance;
 
         bool start_next_block();
+        void tick_channels();
+        void tick_triggers();
+        void take_snapshot();
+        void flush_steps();
 
         float frequency;
         uint32_t period;
         std::array<StepperMotor*, k_max_actuators> motor;
-        std::bitset<k_max_actuators> unstep;
+        StepPortGroups step_ports; // step pins grouped by port so each tick sets and clears them with one write per port
 
         Block *current_block;
         uint32_t current_tick{0};
 
+        // the running state of each motor for the current block, setup from the block's tick info when it starts
+        struct motor_tick_t {
+            int64_t steps_per_tick; // 2.62 fixed point
+            int64_t counter; // 2.62 fixed point
+            int64_t acceleration_change; // 2.62 fixed point signed
+            uint32_t steps_to_move;
+            uint32_t step_count;
+            uint32_t next_accel_event;
+            uint32_t accelerate_until; // the block's ramp ticks, or this motor's own for independent axis blocks
+            uint32_t decelerate_after;
+        };
+        std::array<motor_tick_t, k_max_actuators> tick_state;
+
+        bool step_motor(uint8_t m, motor_tick_t& t, const Block::tickinfo_t& ti, uint32_t tick, uint32_t total_move_ticks, bool s_curve);
+        void update_rate(motor_tick_t& t, const Block::tickinfo_t& ti, uint32_t tick, uint32_t total_move_ticks, bool s_curve);
+        void apply_jerk(motor_tick_t& t, const Block::tickinfo_t& ti, int jerk_phase);
+        void setup_tick_state(motor_tick_t& t, const Block::tickinfo_t& ti);
+
+        // the running state of an arc block, the path is ticked like a motor without a pin and each motor's rate is the path's
+        // times its share, which is worked out at the start of each chord from how far it has to go to the end of the chord
+        struct arc_tick_t {
+            motor_tick_t path;
+            std::array<uint32_t, 3> share; // 2.30 fixed point
+            uint32_t chord;
+            uint32_t chord_end; // the path steps at the end of the chord
+            float cos, sin;     // of the angle turned at the end of the chord
+        } arc_state{};
+        bool tick_arc(int jerk_phase);
+        void next_chord();
+
+        // the running state of each motion channel, its motors are not in any block so they have their own tick count
+        static const uint8_t k_max_channels= 2;
+        struct channel_state_t {
+            MotionChannel *channel;
+            const MotionChannel::move_t *move; // the move being run, nullptr if none
+            uint32_t current_tick;
+            std::array<motor_tick_t, MotionChannel::max_motors> tick_state;
+        };
+        std::array<channel_state_t, k_max_channels> channel_state;
+        void start_channel_move(channel_state_t& cs);
+
+        // outputs that are changed by the step ticker when a motor's position reaches a target, so they happen during a move
+        // the main loop fills in a free one and the ISR owns it until it sets it free again
+        static const uint8_t k_max_triggers= 4;
+        enum TRIGGER_STATE : uint8_t { TRIGGER_FREE, TRIGGER_PENDING, TRIGGER_BELOW, TRIGGER_ABOVE, TRIGGER_PULSING };
+        struct position_trigger_t {
+            uint32_t sequence;      // the number of Conveyor blocks that must have finished before it is armed
+            uint32_t until;         // and once closed, the number after which it is dropped if it has not fired
+            int32_t target;         // in steps
+            uint32_t pulse_ticks;   // if not 0 the output is set to pulse_value this many ticks after it fired
+            OutputEventQueue::output_fnc_t fnc;
+            void *arg;
+            float value;
+            float pulse_value;
+            uint8_t motor;
+            volatile bool closed;   // set by the main loop when a later trigger ends the moves it is for
+            volatile TRIGGER_STATE state;
+        };
+        std::array<position_trigger_t, k_max_triggers> triggers;
+
+        position_snapshot_t snapshot;
+        volatile bool snapshot_requested{false};
+
         struct {
             volatile bool running:1;
             uint8_t num_motors:4;
+            uint8_t num_channels:2;
         };
 };
@@ -19,7 +19,9 @@ class StepperMotor  : public Module {
         uint8_t get_motor_id() const { return motor_id; }
 
         // called from step ticker ISR
-        inline bool step() { step_pin.set(1); current_position_steps += (direction?-1:1); return moving; }
+        inline bool step() { step_pin.set(1); return stepped(); }
+        // called from step ticker ISR when the step pin has been set by the StepTicker port groups
+        inline bool stepped() { current_position_steps += (direction?-1:1); return moving; }
         // called from unstep ISR
         inline void unstep() { step_pin.set(0); }
         // called from step ticker ISR
@@ -34,6 +36,7 @@ class StepperMotor  : public Module {
         void manual_step(bool dir);
 
         bool which_direction() const { return direction; }
+        const Pin& get_step_pin() const { return step_pin; }
 
         float get_steps_per_second()  const { return steps_per_second; }
         float get_steps_per_mm()  const { return steps_per_mm; }
@@ -49,6 +52,8 @@ class StepperMotor  : public Module {
         void set_max_rate(float mr) { max_rate= mr; }
         void set_acceleration(float a) { acceleration= a; }
         float get_acceleration() const { return acceleration; }
+        void set_max_jerk(float j) { max_jerk= j; }
+        float get_max_jerk() const { return max_jerk; }
         bool is_selected() const { return selected; }
         void set_selected(bool b) { selected= b; }
         bool is_extruder() const { return extruder; }
@@ -69,6 +74,7 @@ class StepperMotor  : public Module {
         float steps_per_mm;
         float max_rate; // this is not really rate it is in mm/sec, misnamed used in Robot and Extruder
         float acceleration;
+        float max_jerk;
 
         volatile int32_t current_position_steps;
         int32_t last_milestone_steps;
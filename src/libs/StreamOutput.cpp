@@ -11,14 +11,17 @@ int StreamOutput::printf(const char *format, ...)
     va_start(args, format);
 
     int size = vsnprintf(b, 64, format, args) + 1; // we add one to take into account space for the terminating \0
+    va_end(args);
 
     if (size < 64) {
         buffer = b;
     } else {
+        // the args have been used up so start them again
         buffer = new char[size];
+        va_start(args, format);
         vsnprintf(buffer, size, format, args);
+        va_end(args);
     }
-    va_end(args);
 
     puts(buffer);
 
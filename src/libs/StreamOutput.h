@@ -28,6 +28,8 @@ class StreamOutput {
         virtual int _getc(void) { return 0; }
         virtual int puts(const char* str) = 0;
         virtual bool ready() { return true; };
+        // bytes a host may have sent and not had an ok for, 0 if it has to wait for the ok to each line
+        virtual int rx_window() { return 0; }
 
         static NullStreamOutput NullStream;
 };
@@ -2,3 +2,15 @@
 
 MemoryPool* _AHB0;
 MemoryPool* _AHB1;
+MemoryPool* _CCM;
+
+const char *memory_region(const void *p)
+{
+    uintptr_t a = (uintptr_t)p;
+    if (a >= 0x10000000 && a < 0x10010000) return "CCM";
+    if (a >= 0x20018000 && a < 0x2001C000) return "AHB0";
+    if (a >= 0x2001C000 && a < 0x20020000) return "AHB1";
+    if (a >= 0x20000000 && a < 0x20018000) return "RAM";
+    if (a >= 0x08000000 && a < 0x08100000) return "FLASH";
+    return "?";
+}
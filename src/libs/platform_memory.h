@@ -5,8 +5,17 @@
 
 #define AHB0 (*_AHB0)
 #define AHB1 (*_AHB1)
+#define CCM (*_CCM)
+
+// the CCM is zero wait state but it is not reachable by DMA and cannot hold code,
+// use this to put hot data used by the ISRs there, it is zeroed at startup
+#define CCM_SECTION __attribute__ ((section ("CCMRAM")))
 
 extern MemoryPool* _AHB0;
 extern MemoryPool* _AHB1;
+extern MemoryPool* _CCM;
+
+// returns the name of the memory region p is in
+const char *memory_region(const void *p);
 
 #endif /* _PLATFORM_MEMORY_H */
@@ -27,6 +27,7 @@
 #include "modules/utils/currentcontrol/CurrentControl.h"
 #include "modules/utils/player/Player.h"
 #include "modules/utils/killbutton/KillButton.h"
+#include "modules/utils/statusreport/StatusReport.h"
 #include "modules/utils/PlayLed/PlayLed.h"
 #include "modules/utils/panel/Panel.h"
 //#include "libs/Network/uip/Network.h"
@@ -131,6 +132,7 @@ void init() {
 
     kernel->add_module( new(AHB0) CurrentControl() );
     kernel->add_module( new(AHB0) KillButton() );
+    kernel->add_module( new(AHB0) StatusReport() );
     kernel->add_module( new(AHB0) PlayLed() );
 
     // these modules can be completely disabled in the Makefile by adding to EXCLUDE_MODULES
@@ -10,6 +10,10 @@
 #include "libs/Kernel.h"
 #include "Robot.h"
 #include "utils/Gcode.h"
+#include "utils/LineView.h"
+#include "utils/DecimalParser.h"
+#include "utils/BinaryFrame.h"
+#include "utils/LineSequence.h"
 #include "libs/nuts_bolts.h"
 #include "modules/robot/Conveyor.h"
 #include "libs/SerialMessage.h"
@@ -27,6 +31,8 @@
 #include "stm32f4xx.h"
 #include "version.h"
 
+#include <math.h>
+
 #define panel_display_message_checksum CHECKSUM("display_message")
 #define panel_checksum             CHECKSUM("panel")
 
@@ -39,10 +45,38 @@ static bool is_allowed_mcode(int m) {
     return false;
 }
 
+// the Gcode for each command comes from here rather than the heap, there are a few as a command can send a line
+// that is dispatched before it has finished (eg homing), if they are all in use it falls back to the heap
+static const int k_gcode_pool_size= 3;
+alignas(Gcode) static char gcode_pool[k_gcode_pool_size][sizeof(Gcode)];
+static bool gcode_pool_used[k_gcode_pool_size];
+
+static Gcode *new_gcode(const LineView& line, StreamOutput *stream)
+{
+    for (int i = 0; i < k_gcode_pool_size; ++i) {
+        if(!gcode_pool_used[i]) {
+            gcode_pool_used[i]= true;
+            return new(gcode_pool[i]) Gcode(line.p, line.n, stream);
+        }
+    }
+    return new Gcode(line.p, line.n, stream);
+}
+
+static void delete_gcode(Gcode *gcode)
+{
+    for (int i = 0; i < k_gcode_pool_size; ++i) {
+        if(gcode == reinterpret_cast<Gcode *>(gcode_pool[i])) {
+            gcode->~Gcode();
+            gcode_pool_used[i]= false;
+            return;
+        }
+    }
+    delete gcode;
+}
+
 GcodeDispatch::GcodeDispatch()
 {
     uploading = false;
-    currentline = -1;
     modal_group_1= 0;
 }
 
@@ -52,11 +86,78 @@ void GcodeDispatch::on_module_loaded()
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
 }
 
+// A binary frame from the console, moves go straight to the robot, outputs and queries are run as the gcode they stand for
+void GcodeDispatch::dispatch_frame(SerialMessage& message)
+{
+    uint8_t type;
+    const uint8_t *payload;
+    size_t len;
+    if(!BinaryFrame::check((const uint8_t *)message.message.data(), message.message.size(), type, payload, len)) {
+        message.stream->printf("rs frame\r\n");
+        return;
+    }
+
+    if(type == BinaryFrame::MOVE) {
+        BinaryFrame::move_t move;
+        if(!BinaryFrame::decode_move(payload, len, move)) {
+            message.stream->printf("rs frame\r\n");
+            return;
+        }
+        if(THEKERNEL->is_halted()) {
+            message.stream->printf("!!\r\n");
+            return;
+        }
+        modal_group_1= move.linear ? 1 : 0;
+        THEROBOT->append_frame_move(move.mask, move.pos, move.has_feed ? move.feed : NAN, move.linear);
+        message.stream->printf("ok\r\n");
+        return;
+    }
+
+    // outputs and queries are rare enough to go through the text
+    char buf[32];
+    if(type == BinaryFrame::OUTPUT && (len == 2 || len == 6)) {
+        int n= snprintf(buf, sizeof(buf), "M%u", payload[0] | (payload[1] << 8));
+        if(len == 6) {
+            int32_t s= payload[2] | (payload[3] << 8) | (payload[4] << 16) | ((uint32_t)payload[5] << 24);
+            snprintf(buf + n, sizeof(buf) - n, " S%1.4f", s / BinaryFrame::scale);
+        }
+
+    } else if(type == BinaryFrame::QUERY && len == 3) {
+        snprintf(buf, sizeof(buf), "M%u.%u", payload[0] | (payload[1] << 8), payload[2]);
+
+    } else {
+        message.stream->printf("rs frame\r\n");
+        return;
+    }
+
+    SerialMessage text{message.stream, buf};
+    on_console_line_received(&text);
+}
+
+bool GcodeDispatch::may_queue_blocks(const std::string& line)
+{
+    if(!line.empty() && line[0] == BINARY_FRAME_STX) return line.size() > 1 && line[1] == BinaryFrame::MOVE;
+
+    LineView v{line.data(), line.size()};
+    v.remove_prefix(v.find_first_not_of(" \t"));
+    if(!v.empty() && v[0] == 'N') {
+        // skip the line number
+        v.remove_prefix(v.find_first_not_of("0123456789 \t", 1));
+    }
+    if(v.empty()) return false;
+
+    // M and T codes, comments and the shell commands (which are lower case) do not queue moves, anything else might
+    char c= v[0];
+    return !(c == 'M' || c == 'T' || c == ';' || c == '(' || c == '$' || (c >= 'a' && c <= 'z'));
+}
+
 // When a command is received, if it is a Gcode, dispatch it as an object via an event
 void GcodeDispatch::on_console_line_received(void *line)
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(line);
-    string possible_command = new_message.message;
+    SerialMessage& new_message = *static_cast<SerialMessage *>(line);
+    // the line is picked apart in place, the commands are views of it rather than copies
+    LineView possible_command{new_message.message.data(), new_message.message.size()};
+    string rewritten; // only used if the line has to be changed
 
     int ln = 0;
     int cs = 0;
@@ -67,10 +168,15 @@ void GcodeDispatch::on_console_line_received(void *line)
         return;
     }
 
+    if(possible_command[0] == BINARY_FRAME_STX) {
+        dispatch_frame(new_message);
+        return;
+    }
+
 try_again:
 
     char first_char = possible_command[0];
-    unsigned int n;
+    size_t n;
 
     if(first_char == '$') {
         // ignore as simpleshell will handle it
@@ -85,14 +191,13 @@ try_again:
 
         //Get linenumber
         if ( first_char == 'N' ) {
-            Gcode full_line = Gcode(possible_command, new_message.stream, false);
-            ln = (int) full_line.get_value('N');
-            int chksum = (int) full_line.get_value('*');
+            Gcode full_line(possible_command.p, possible_command.n, new_message.stream, false);
+            ln = full_line.get_int('N');
 
             //Catch message if it is M110: Set Current Line Number
             if ( full_line.has_m ) {
                 if ( full_line.m == 110 ) {
-                    currentline = ln;
+                    line_sequence.set(ln);
                     new_message.stream->printf("ok\r\n");
                     return;
                 }
@@ -102,59 +207,39 @@ try_again:
             size_t chkpos = possible_command.find_first_of("*");
 
 			//Calculate checksum
-            if ( chkpos != string::npos ) {
-				possible_command = possible_command.substr(0, chkpos);
-                for (auto c = possible_command.cbegin(); *c != '*' && c != possible_command.cend(); c++)
-                    cs = cs ^ *c;
+            if ( chkpos != possible_command.n ) {
+                // the checksum runs to the end of the line, which is null terminated
+                int chksum = decimal_to_int(possible_command.p + chkpos + 1, nullptr);
+				possible_command.truncate(chkpos);
+                for (size_t i = 0; i < possible_command.n; i++)
+                    cs = cs ^ possible_command[i];
                 cs &= 0xff;  // Defensive programming...
                 cs -= chksum;
 			}
 
-            //Strip line number value from possible_command
-			size_t lnsize = possible_command.find_first_not_of("N0123456789.,- ");
-			if(lnsize != string::npos) {
-				possible_command = possible_command.substr(lnsize);
-			}else{
-				// it is a blank line
-				possible_command.clear();
-			}
+            //Strip line number value from possible_command, if it is all line number it is a blank line
+			possible_command.remove_prefix(possible_command.find_first_not_of("N0123456789.,- "));
 
         } else {
             //Assume checks succeeded
             cs = 0x00;
-            ln = currentline + 1;
         }
 
         //Remove comments
-        size_t comment = possible_command.find_first_of(";(");
-        if( comment != string::npos ) {
-            possible_command = possible_command.substr(0, comment);
-        }
-
-        //If checksum passes then process message, else request resend
-        int nextline = currentline + 1;
-        if( cs == 0x00 && ln == nextline ) {
-            if( first_char == 'N' ) {
-                currentline = nextline;
-            }
+        possible_command.truncate(possible_command.find_first_of(";("));
 
+        //If checksum and line number pass then process message, else reply as the sequence says, a line without N is always run
+        LineSequence::RESULT seq= (first_char == 'N') ? line_sequence.check(ln, cs == 0x00) : LineSequence::ACCEPT;
+        if( seq == LineSequence::ACCEPT ) {
             bool sent_ok= false; // used for G1 optimization
-            while(possible_command.size() > 0) {
+            while(!possible_command.empty()) {
                 // assumes G or M are always the first on the line
-                size_t nextcmd = possible_command.find_first_of("GM", 2);
-                string single_command;
-                if(nextcmd == string::npos) {
-                    single_command = possible_command;
-                    possible_command = "";
-                } else {
-                    single_command = possible_command.substr(0, nextcmd);
-                    possible_command = possible_command.substr(nextcmd);
-                }
+                LineView single_command = possible_command.take_front(possible_command.find_first_of("GM", 2));
 
 
                 if(!uploading || upload_stream != new_message.stream) {
                     // Prepare gcode for dispatch
-                    Gcode *gcode = new Gcode(single_command, new_message.stream);
+                    Gcode *gcode = new_gcode(single_command, new_message.stream);
 
                     if(THEKERNEL->is_halted()) {
                         // we ignore all commands until M999, unless it is in the exceptions list (like M105 get temp)
@@ -164,7 +249,7 @@ try_again:
                                 new_message.stream->printf("WARNING: After HALT you should HOME as position is currently unknown\n");
                             }
                             new_message.stream->printf("ok\n");
-                            delete gcode;
+                            delete_gcode(gcode);
                             return;
 
                         }else if(!is_allowed_mcode(gcode->m)) {
@@ -175,7 +260,7 @@ try_again:
                             }else{
                                 new_message.stream->printf("!!\r\n");
                             }
-                            delete gcode;
+                            delete_gcode(gcode);
                             return;
                         }
                     }
@@ -188,7 +273,7 @@ try_again:
                                 // use last gcode G1 or G0 if none on the line, and pass through as if it was a G0/G1
                                 // TODO it is really an error if the last is not G0 thru G3
                                 if(modal_group_1 > 3) {
-                                    delete gcode;
+                                    delete_gcode(gcode);
                                     new_message.stream->printf("ok - Invalid G53\r\n");
                                     return;
                                 }
@@ -196,13 +281,13 @@ try_again:
                                 gcode->g= modal_group_1;
 
                             }else{
-                                delete gcode;
+                                delete_gcode(gcode);
                                 // extract next G0/G1 from the rest of the line, ignore if it is not one of these
-                                gcode = new Gcode(possible_command, new_message.stream);
-                                possible_command= "";
+                                gcode = new_gcode(possible_command, new_message.stream);
+                                possible_command.n= 0;
                                 if(!gcode->has_g || gcode->g > 1) {
                                     // not G0 or G1 so ignore it as it is invalid
-                                    delete gcode;
+                                    delete_gcode(gcode);
                                     new_message.stream->printf("ok - Invalid G53\r\n");
                                     return;
                                 }
@@ -227,9 +312,9 @@ try_again:
                     if(gcode->has_m) {
                         switch (gcode->m) {
                             case 28: // start upload command
-                                delete gcode;
+                                delete_gcode(gcode);
 
-                                this->upload_filename = "/sd/" + single_command.substr(4); // rest of line is filename
+                                this->upload_filename = "/sd/" + single_command.str(4); // rest of line is filename
                                 // open file
                                 upload_fd = fopen(this->upload_filename.c_str(), "w");
                                 if(upload_fd != NULL) {
@@ -264,13 +349,21 @@ try_again:
                                 // disables heaters and motors, ignores further incoming Gcode and clears block queue
                                 THEKERNEL->call_event(ON_HALT, nullptr);
                                 THEKERNEL->streams->printf("ok Emergency Stop Requested - reset or M999 required to exit HALT state\r\n");
-                                delete gcode;
+                                delete_gcode(gcode);
                                 return;
 
                             case 115: { // M115 Get firmware version and capabilities
                                 Version vers;
 
-                                new_message.stream->printf("FIRMWARE_NAME:Smoothieware, FIRMWARE_URL:http%%3A//smoothieware.org, X-SOURCE_CODE_URL:https%%3A//github.com/janm012012/Smoothieware-CHMT, FIRMWARE_VERSION:%s, X-FIRMWARE_BUILD_DATE:%s, X-SYSTEM_CLOCK:%ldMHz, X-AXES:%d, X-PAXES:%d, X-GRBL_MODE:%d, X-SERIAL_FLOW:NONE", vers.get_build(), vers.get_build_date(), SystemCoreClock / 1000000, MAX_ROBOT_ACTUATORS, N_PRIMARY_AXIS, THEKERNEL->is_grbl_mode());
+                                new_message.stream->printf("FIRMWARE_NAME:Smoothieware, FIRMWARE_URL:http%%3A//smoothieware.org, X-SOURCE_CODE_URL:https%%3A//github.com/janm012012/Smoothieware-CHMT, FIRMWARE_VERSION:%s, X-FIRMWARE_BUILD_DATE:%s, X-SYSTEM_CLOCK:%ldMHz, X-AXES:%d, X-PAXES:%d, X-GRBL_MODE:%d", vers.get_build(), vers.get_build_date(), SystemCoreClock / 1000000, MAX_ROBOT_ACTUATORS, N_PRIMARY_AXIS, THEKERNEL->is_grbl_mode());
+
+                                // with a receive window the host may send lines until the bytes it has not had an ok for would
+                                // go over it, each line still gets one ok once it has been taken from the buffer
+                                if(new_message.stream->rx_window() > 0) {
+                                    new_message.stream->printf(", X-SERIAL_FLOW:CHARCOUNT, X-RX_BUFFER:%d, X-PLANNER_FREE:%u", new_message.stream->rx_window(), THECONVEYOR->get_free_blocks());
+                                } else {
+                                    new_message.stream->printf(", X-SERIAL_FLOW:NONE");
+                                }
 
                                 #ifdef CNC
                                 new_message.stream->printf(", X-CNC:1");
@@ -290,9 +383,9 @@ try_again:
 
                             case 117: // M117 is a special non compliant Gcode as it allows arbitrary text on the line following the command
                             {    // concatenate the command again and send to panel if enabled
-                                string str= single_command.substr(4) + possible_command;
+                                string str= single_command.str(4) + possible_command.str();
                                 PublicData::set_value( panel_checksum, panel_display_message_checksum, &str );
-                                delete gcode;
+                                delete_gcode(gcode);
                                 new_message.stream->printf("ok\r\n");
                                 return;
                             }
@@ -300,10 +393,10 @@ try_again:
                             case 1000: // M1000 is a special command that will pass thru the raw lowercased command to the simpleshell (for hosts that do not allow such things)
                             {
                                 // reconstruct entire command line again
-                                string str= single_command.substr(5) + possible_command;
+                                string str= single_command.str(5) + possible_command.str();
                                 while(is_whitespace(str.front())){ str= str.substr(1); } // strip leading whitespace
 
-                                delete gcode;
+                                delete_gcode(gcode);
 
                                 if(str.empty()) {
                                     SimpleShell::parse_command("help", "", new_message.stream);
@@ -335,7 +428,7 @@ try_again:
                                 // dispatch the M500 here so we can free up the stream when done
                                 THEKERNEL->call_event(ON_GCODE_RECEIVED, gcode );
                                 delete gcode->stream;
-                                delete gcode;
+                                delete_gcode(gcode);
                                 __enable_irq();
                                 new_message.stream->printf("Settings Stored to %s\r\nok\r\n", THEKERNEL->config_override_filename());
                                 continue;
@@ -343,19 +436,19 @@ try_again:
                             case 501: // load config override
                             case 504: // save to specific config override file
                                 {
-                                    string arg= get_arguments(single_command + possible_command); // rest of line is filename
+                                    string arg= get_arguments(single_command.str() + possible_command.str()); // rest of line is filename
                                     if(arg.empty()) arg= "/sd/config-override";
                                     else arg= "/sd/config-override." + arg;
                                     //new_message.stream->printf("args: <%s>\n", arg.c_str());
                                     SimpleShell::parse_command((gcode->m == 501) ? "load_command" : "save_command", arg, new_message.stream);
                                 }
-                                delete gcode;
+                                delete_gcode(gcode);
                                 new_message.stream->printf("ok\r\n");
                                 return;
 
                             case 502: // M502 deletes config-override so everything defaults to what is in config
                                 remove(THEKERNEL->config_override_filename());
-                                delete gcode;
+                                delete_gcode(gcode);
                                 new_message.stream->printf("config override file deleted %s, reboot needed\r\nok\r\n", THEKERNEL->config_override_filename());
                                 continue;
 
@@ -420,11 +513,11 @@ try_again:
                         }
                     }
 
-                    delete gcode;
+                    delete_gcode(gcode);
 
                 } else {
                     // we are uploading and it is the upload stream so so save it
-                    if(single_command.substr(0, 3) == "M29") {
+                    if(single_command.starts_with("M29")) {
                         // done uploading, close file
                         fclose(upload_fd);
                         upload_fd = NULL;
@@ -441,8 +534,7 @@ try_again:
                         continue;
                     }
 
-                    single_command.append("\n");
-                    if(fwrite(single_command.c_str(), 1, single_command.size(), upload_fd) != single_command.size()) {
+                    if(fwrite(single_command.p, 1, single_command.n, upload_fd) != single_command.n || fputc('\n', upload_fd) == EOF) {
                         // error writing to file
                         new_message.stream->printf("Error:error writing to file.\r\n");
                         fclose(upload_fd);
@@ -456,20 +548,29 @@ try_again:
                 }
             }
 
-        } else {
+        } else if( seq == LineSequence::DUPLICATE ) {
+            // it has already been run, the host went back further than it needed to
+            new_message.stream->printf("ok\r\n");
+
+        } else if( seq == LineSequence::RESEND ) {
             //Request resend
-            new_message.stream->printf("rs N%d\r\n", nextline);
+            new_message.stream->printf("rs N%d\r\n", (int)line_sequence.expected());
+
+        } else {
+            // in flight after a line that is being resent
+            new_message.stream->printf("ok - discarded\r\n");
         }
 
     } else if ( first_char == ';' || first_char == '(' || first_char == '\n' || first_char == '\r' ) {
         // Ignore comments and blank lines
         new_message.stream->printf("ok\n");
 
-    } else if( (n=possible_command.find_first_of("XYZF")) == 0 || (first_char == ' ' && n != string::npos) ) {
+    } else if( (n=possible_command.find_first_of("XYZF")) == 0 || (first_char == ' ' && n != possible_command.n) ) {
         // handle pycam syntax, use last modal group 1 command and resubmit if an X Y Z or F is found on its own line
         char buf[6];
         snprintf(buf, sizeof(buf), "G%d ", modal_group_1);
-        possible_command.insert(0, buf);
+        rewritten= buf + possible_command.str();
+        possible_command= LineView{rewritten.data(), rewritten.size()};
         goto try_again;
 
 
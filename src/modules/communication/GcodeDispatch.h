@@ -8,11 +8,13 @@
 #pragma once
 
 #include "libs/Module.h"
+#include "utils/LineSequence.h"
 
 #include <stdio.h>
 #include <string>
 
 class StreamOutput;
+struct SerialMessage;
 
 class GcodeDispatch : public Module
 {
@@ -23,8 +25,14 @@ public:
     virtual void on_console_line_received(void *line);
 
     uint8_t get_modal_command() const { return modal_group_1<4 ? modal_group_1 : 0; }
+
+    // true if the line could put blocks on the planner queue, the consoles hold such a line back while the queue is full,
+    // it waits for room for one block so a line that is segmented can still wait in the planner for the rest
+    static bool may_queue_blocks(const std::string& line);
 private:
-    int currentline;
+    void dispatch_frame(SerialMessage& message);
+
+    LineSequence line_sequence;
     std::string upload_filename;
     FILE *upload_fd;
     StreamOutput* upload_stream{nullptr};
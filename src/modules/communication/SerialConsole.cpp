@@ -7,6 +7,7 @@
 
 #include <string>
 #include <stdarg.h>
+#include <functional>
 using std::string;
 #include "libs/Module.h"
 #include "libs/Kernel.h"
@@ -16,21 +17,30 @@ using std::string;
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutput.h"
 #include "libs/StreamOutputPool.h"
+#include "GcodeDispatch.h"
+#include "Conveyor.h"
 
 // Serial reading module
 // Treats every received line as a command and passes it ( via event call ) to the command dispatcher.
 // The command dispatcher will then ask other modules if they can do something with it
 SerialConsole::SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate ){
-    this->serial = new mbed::Serial( rx_pin, tx_pin );
-    this->serial->baud(baud_rate);
+    this->serial = new DmaSerial( rx_pin, tx_pin, baud_rate );
+}
+
+// the startup console is deleted once the config is loaded, this stops its DMA so the new one can use the UART
+SerialConsole::~SerialConsole(){
+    delete this->serial;
 }
 
 // Called when the module has just been loaded
 void SerialConsole::on_module_loaded() {
-    // We want to be called every time a new char is received
-    this->serial->attach(this, &SerialConsole::on_serial_char_received, mbed::Serial::RxIrq);
+    // We want to be called every time new chars are received
+    this->serial->attach_rx(std::bind(&SerialConsole::on_serial_chars_received, this, std::placeholders::_1, std::placeholders::_2));
     query_flag= false;
     halt_flag= false;
+    last_cr= false;
+    raw= false;
+    parked= false;
 
     // We only call the command dispatcher in the main loop, nowhere else
     this->register_for_event(ON_MAIN_LOOP);
@@ -40,10 +50,41 @@ void SerialConsole::on_module_loaded() {
     THEKERNEL->streams->append_stream(this);
 }
 
-// Called on Serial::RxIrq interrupt, meaning we have received a char
-void SerialConsole::on_serial_char_received(){
-    while(this->serial->readable()){
-        char received = this->serial->getc();
+// Called from the serial interrupt when the line goes idle or the receive buffer is half full, meaning we have received some chars
+void SerialConsole::on_serial_chars_received(const char *buf, size_t n){
+    for (size_t i = 0; i < n; ++i) {
+        char received = buf[i];
+        if(raw) {
+            // an upload reads every char as it is sent until the ^D or ^Z that ends it, then it is lines again
+            if(this->buffer.size() < this->buffer.capacity()) this->buffer.push_back(received);
+            if(received == 4 || received == 26) {
+                raw= false;
+                last_cr= false;
+                rx_overflow= false;
+                line_start= this->buffer.head;
+            }
+            continue;
+        }
+        if(frame_rx.active()) {
+            // in a binary frame none of the text handling applies, it goes in the buffer once it is whole
+            int r= frame_rx.put(received);
+            if(r == 0) continue;
+            if(r > 0) {
+                if(rx_window() - this->buffer.size() >= (int)frame_rx.size()) {
+                    for (size_t j = 0; j < frame_rx.size(); ++j) this->buffer.push_back(frame_rx.data()[j]);
+                    ++lines_in;
+                } else {
+                    push_overflow('F');
+                }
+                line_start= this->buffer.head;
+                continue;
+            }
+            // not a frame after all, this char is text
+        }
+        if(received == BINARY_FRAME_STX) {
+            frame_rx.start();
+            continue;
+        }
         if(received == '?') {
             query_flag= true;
             continue;
@@ -52,12 +93,46 @@ void SerialConsole::on_serial_char_received(){
             halt_flag= true;
             continue;
         }
-        // convert CR to NL (for host OSs that don't send NL)
-        if( received == '\r' ){ received = '\n'; }
-        this->buffer.push_back(received);
+        // convert CR to NL (for host OSs that don't send NL), CR NL is one line end so a host counting characters gets one ok per line
+        bool cr= received == '\r';
+        if( cr ){ received = '\n'; }
+        else if( received == '\n' && last_cr ){ last_cr= false; continue; }
+        last_cr= cr;
+        // a host counting characters keeps within rx_window(), a line that does not fit is dropped rather than overwriting
+        // the line being read, what there is of it is taken back out so none of it is run
+        if(received != '\n') {
+            if(rx_overflow) continue;
+            if(this->buffer.size() < rx_window()) {
+                this->buffer.push_back(received);
+            } else {
+                this->buffer.head= line_start;
+                rx_overflow= true;
+            }
+            continue;
+        }
+        if(rx_overflow || this->buffer.size() >= rx_window()) {
+            this->buffer.head= line_start;
+            rx_overflow= false;
+            push_overflow('L');
+        } else {
+            this->buffer.push_back(received);
+            ++lines_in;
+        }
+        line_start= this->buffer.head;
     }
 }
 
+// puts a mark in the buffer in place of a line or frame that did not fit, so it still gets its reply and in order,
+// there is room for it unless the host is not keeping within rx_window()
+void SerialConsole::push_overflow(char what)
+{
+    if(this->buffer.capacity() - this->buffer.size() < 3) return;
+    this->buffer.push_back(overflow_mark);
+    this->buffer.push_back(what);
+    this->buffer.push_back('\n');
+    ++lines_in;
+}
+
 void SerialConsole::on_idle(void * argument)
 {
     if(query_flag) {
@@ -77,39 +152,93 @@ void SerialConsole::on_idle(void * argument)
 
 // Actual event calling must happen in the main loop because if it happens in the interrupt we will loose data
 void SerialConsole::on_main_loop(void * argument){
-    if( this->has_char('\n') ){
-        string received;
-        received.reserve(20);
-        while(1){
-           char c;
-           this->buffer.pop_front(c);
-           if( c == '\n' ){
-                struct SerialMessage message;
-                message.message = received;
-                message.stream = this;
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-                return;
-            }else{
-                received += c;
-            }
+    if(!parked) {
+        if( lines_in == lines_out ) return;
+        ++lines_out;
+        read_line();
+
+        if(!this->line.message.empty() && this->line.message[0] == overflow_mark) {
+            // a host counting characters frees the window of a frame on its reply, a numbered line gets resent when the
+            // next one is out of order
+            puts(this->line.message[1] == 'F' ? "rs frame\r\n" : "error:line too long\r\n");
+            return;
         }
     }
+
+    // while the planner queue is full a move waits here rather than in the planner, so the main loop keeps running
+    // and the other streams and the realtime commands are still serviced, the host sees no ok until it is dispatched.
+    // This only covers the first block, a line the planner splits into several (segmented arcs and lines) still waits
+    // in the planner for room for the rest
+    parked= THECONVEYOR->is_queue_full() && !THEKERNEL->is_halted() && GcodeDispatch::may_queue_blocks(this->line.message);
+    if(parked) return;
+
+    THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &this->line );
 }
 
+// takes the next line or frame out of the buffer
+void SerialConsole::read_line()
+{
+    // the line is built in place, clearing it keeps its capacity so once it has grown there is no allocation per line
+    this->line.message.clear();
+    this->line.stream = this;
 
+    char c;
+    if(this->buffer.get_tail_ref()[0] == BINARY_FRAME_STX) {
+        // a binary frame is passed on whole, GcodeDispatch knows it by the STX
+        char len;
+        this->buffer.get(2, len);
+        for (int i = 0; i < (uint8_t)len + 5; ++i) {
+            this->buffer.pop_front(c);
+            this->line.message += c;
+        }
+        return;
+    }
+
+    while(1){
+        this->buffer.pop_front(c);
+        if( c == '\n' ) return;
+        this->line.message += c;
+    }
+}
+
+
+// queued and sent by DMA, only waits if the transmit queue is full
 int SerialConsole::puts(const char* s)
 {
-    return fwrite(s, strlen(s), 1, (FILE*)(*this->serial));
+    return this->serial->send_all(s, strlen(s));
 }
 
 int SerialConsole::_putc(int c)
 {
-    return this->serial->putc(c);
+    char ch= c;
+    this->serial->send_all(&ch, 1);
+    return c;
 }
 
+// the received chars all go into the buffer, so read from there
 int SerialConsole::_getc()
 {
-    return this->serial->getc();
+    start_raw();
+    while(this->buffer.size() == 0) ;
+    char c;
+    this->buffer.pop_front(c);
+    return c;
+}
+
+bool SerialConsole::ready()
+{
+    start_raw();
+    return this->buffer.size() > 0;
+}
+
+// only an upload reads the console with ready() and _getc(), from then on the chars are not made into lines, so they
+// are written as they were sent, until the ^D or ^Z that ends it. What is in the buffer already is read by the upload
+// too so it is no longer counted as lines
+void SerialConsole::start_raw()
+{
+    if(raw) return;
+    raw= true;
+    lines_out= lines_in;
 }
 
 // Does the queue have a given char ?
@@ -9,13 +9,15 @@
 #define SERIALCONSOLE_H
 
 #include "libs/Module.h"
-#include "Serial.h" // mbed.h lib
+#include "libs/DmaSerial.h"
 #include "libs/Kernel.h"
 #include <vector>
 #include <string>
 using std::string;
 #include "libs/RingBuffer.h"
 #include "libs/StreamOutput.h"
+#include "libs/SerialMessage.h"
+#include "utils/BinaryFrame.h"
 
 
 #define baud_rate_setting_checksum CHECKSUM("baud_rate")
@@ -23,25 +25,41 @@ using std::string;
 class SerialConsole : public Module, public StreamOutput {
     public:
         SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate );
+        ~SerialConsole();
 
         void on_module_loaded();
-        void on_serial_char_received();
+        void on_serial_chars_received(const char *buf, size_t n);
         void on_main_loop(void * argument);
         void on_idle(void * argument);
         bool has_char(char letter);
+        void read_line();
 
         int _putc(int c);
         int _getc(void);
         int puts(const char*);
+        bool ready();
+        // three chars are kept back for the mark that stands in for a line or frame that did not fit
+        int rx_window() { return buffer.capacity() - 3; }
+        void push_overflow(char what);
+        void start_raw();
+        static const char overflow_mark= 0x15;
 
         //string receive_buffer;                 // Received chars are stored here until a newline character is received
         //vector<std::string> received_lines;    // Received lines are stored here until they are requested
         RingBuffer<char,256> buffer;             // Receive buffer
-        mbed::Serial* serial;
-        struct {
-          bool query_flag:1;
-          bool halt_flag:1;
-        };
+        DmaSerial* serial;
+        SerialMessage line;                      // the line being dispatched, reused for each line
+        BinaryFrame frame_rx;                    // the binary frame being received
+        volatile uint16_t lines_in{0};           // lines and frames put in the buffer by the interrupt
+        uint16_t lines_out{0};                   // and taken out by the main loop
+        int line_start{0};                       // where the line being received starts in the buffer
+        bool rx_overflow{false};                 // the line being received did not fit, the rest of it is dropped
+        // set by the interrupt, each in a byte of its own so writing one does not write back the others
+        volatile bool query_flag;
+        volatile bool halt_flag;
+        volatile bool last_cr;
+        volatile bool raw;                       // an upload is reading the chars as they are, see start_raw()
+        bool parked;                             // line holds a single block move waiting for room in the planner queue
 };
 
 #endif
@@ -0,0 +1,103 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BinaryFrame.h"
+
+#include <string.h>
+
+const float BinaryFrame::scale= 10000.0F;
+
+static int32_t get_int32(const uint8_t *p)
+{
+    return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+uint16_t BinaryFrame::crc16(const uint8_t *p, size_t n, uint16_t crc)
+{
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= (uint16_t)p[i] << 8;
+        for (int b = 0; b < 8; ++b) {
+            crc= (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool BinaryFrame::check(const uint8_t *frame, size_t n, uint8_t& type, const uint8_t *&payload, size_t& len)
+{
+    if(n < 5 || frame[0] != BINARY_FRAME_STX) return false;
+    len= frame[2];
+    if(n != len + 5) return false;
+
+    uint16_t crc= frame[3 + len] | (frame[4 + len] << 8);
+    if(crc16(frame + 1, len + 2) != crc) return false;
+
+    type= frame[1];
+    payload= frame + 3;
+    return true;
+}
+
+bool BinaryFrame::decode_move(const uint8_t *payload, size_t len, move_t& move)
+{
+    if(len < 2) return false;
+    uint8_t flags= payload[0];
+    move.linear= (flags & 1) != 0;
+    move.has_feed= (flags & 2) != 0;
+    move.mask= payload[1] & ((1 << max_axis) - 1);
+
+    size_t n= 2;
+    if(move.has_feed) {
+        if(len < n + 4) return false;
+        move.feed= get_int32(payload + n) / scale;
+        n += 4;
+    }
+
+    // only the axes in the mask are set
+    for (size_t i = 0; i < max_axis; ++i) {
+        if(!(move.mask & (1 << i))) continue;
+        if(len < n + 4) return false;
+        // exact up to +-1677 units, which is a single correctly rounded division
+        move.pos[i]= get_int32(payload + n) / scale;
+        n += 4;
+    }
+    return n == len;
+}
+
+size_t BinaryFrame::encode(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out)
+{
+    if(len > max_payload) return 0;
+    out[0]= BINARY_FRAME_STX;
+    out[1]= type;
+    out[2]= len;
+    memcpy(out + 3, payload, len);
+    uint16_t crc= crc16(out + 1, len + 2);
+    out[3 + len]= crc & 0xFF;
+    out[4 + len]= crc >> 8;
+    return len + 5;
+}
+
+int BinaryFrame::put(uint8_t c)
+{
+    frame[pos++]= c;
+    if(pos == 2) {
+        // not a type we know so it was not the start of a frame
+        if(c != MOVE && c != OUTPUT && c != QUERY) {
+            pos= 0;
+            return -1;
+        }
+    } else if(pos == 3) {
+        if(c > max_payload) {
+            pos= 0;
+            return -1;
+        }
+        frame_size= c + 5;
+    } else if(pos > 3 && pos == frame_size) {
+        pos= 0;
+        return 1;
+    }
+    return 0;
+}
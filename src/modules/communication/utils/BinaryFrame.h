@@ -0,0 +1,76 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Binary framed commands, sent on the same port as the gcode text between lines.
+ *
+ *   STX type len payload[len] crc16
+ *
+ * STX (0x02) never appears in gcode so it is the escape into binary, the console goes back to text after the frame.
+ * The crc is CRC-16/CCITT-FALSE over type, len and the payload, low byte first, as are all the multi byte values.
+ * Each frame gets one reply line the same as a gcode line does, so a host counting characters counts the frame bytes.
+ *
+ * move 'G'   flags, axis mask, [int32 feed], int32 position for each axis in the mask
+ *            flags bit 0 is G1 rather than G0, bit 1 says there is a feed rate (mm/min)
+ *            mask bit 0 is X up to bit 6 which is D, the positions are absolute work coordinates in mm
+ *            all values are in 1/10000 units
+ * output 'O' uint16 M code, [int32 S value in 1/10000 units], run as the gcode Mnnn Snnn
+ * query 'Q'  uint16 M code, uint8 subcode, run as the gcode Mnnn.s
+ *
+ * See smoothie-binary.py for an encoder.
+ */
+
+#define BINARY_FRAME_STX 0x02
+
+class BinaryFrame {
+    public:
+        enum TYPE : uint8_t {
+            MOVE= 'G',
+            OUTPUT= 'O',
+            QUERY= 'Q'
+        };
+
+        static const size_t max_payload= 48;
+        static const size_t max_size= 3 + max_payload + 2;
+        static const size_t max_axis= 7;
+        static const float scale; // of the values in a frame, 10000 per unit
+
+        struct move_t {
+            bool linear;
+            bool has_feed;
+            uint8_t mask;
+            float feed;
+            float pos[max_axis];
+        };
+
+        static uint16_t crc16(const uint8_t *p, size_t n, uint16_t crc= 0xFFFF);
+
+        // checks a whole frame from the STX, sets the type and the payload
+        static bool check(const uint8_t *frame, size_t n, uint8_t& type, const uint8_t *&payload, size_t& len);
+        static bool decode_move(const uint8_t *payload, size_t len, move_t& move);
+
+        // builds a frame in out, which must hold max_size, returns its size
+        static size_t encode(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out);
+
+        // receiving a byte at a time, called from the serial interrupt once the STX has been seen
+        void start() { pos= 1; frame[0]= BINARY_FRAME_STX; }
+        bool active() const { return pos != 0; }
+        // returns 1 when the frame is complete, -1 if it cannot be a frame and the bytes go back to being text, 0 for more
+        int put(uint8_t c);
+        const uint8_t *data() const { return frame; }
+        size_t size() const { return frame_size; }
+
+    private:
+        uint8_t frame[max_size];
+        size_t pos{0};
+        size_t frame_size{0};
+};
@@ -0,0 +1,111 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DecimalParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const float pow10f[]= {1e0F, 1e1F, 1e2F, 1e3F, 1e4F, 1e5F, 1e6F, 1e7F, 1e8F, 1e9F, 1e10F};
+
+static const double pow10d[]= {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+float decimal_to_float(const char *s, char **end)
+{
+    const char *p= s;
+    while(*p == ' ' || *p == '\t') ++p;
+    const char *number= p;
+    bool neg= *p == '-';
+    if(neg || *p == '+') ++p;
+
+    // the digits as an integer, scaled by 10^-frac
+    uint64_t m= 0;
+    int digits= 0, frac= 0;
+    bool exact= true, any= false;
+    for (; is_digit(*p); ++p) {
+        any= true;
+        if(digits < 19) {
+            m= m * 10 + (*p - '0');
+            if(m != 0) ++digits;
+        } else {
+            exact= false;
+        }
+    }
+    if(*p == '.') {
+        ++p;
+        for (; is_digit(*p); ++p) {
+            any= true;
+            if(digits < 19) {
+                m= m * 10 + (*p - '0');
+                if(m != 0) ++digits;
+                ++frac;
+            } else {
+                exact= false;
+            }
+        }
+    }
+
+    if(!any) {
+        if(end != nullptr) *end= (char *)s;
+        return 0;
+    }
+    if(end != nullptr) *end= (char *)p;
+
+    float r;
+    if(exact && frac <= 10 && m <= (1UL << 24)) {
+        // both are exact in a float so the one division is correctly rounded, this is most gcode values
+        r= (float)m / pow10f[frac];
+
+    } else {
+        bool ok= false;
+        if(exact && frac <= 22 && m <= (1ULL << 53)) {
+            // exact in a double so the quotient is correctly rounded to a double, rounding that to a float is only
+            // wrong when it lands exactly half way between two floats
+            double q= (double)m / pow10d[frac];
+            uint64_t bits;
+            memcpy(&bits, &q, sizeof(bits));
+            if((bits & 0x1FFFFFFFULL) != 0x10000000ULL) {
+                r= (float)q;
+                ok= true;
+            }
+        }
+        if(!ok) {
+            // very long or very small numbers, strtof on a copy so it cannot take an exponent
+            char buf[64];
+            size_t n= p - number;
+            if(n >= sizeof(buf)) n= sizeof(buf) - 1;
+            memcpy(buf, number, n);
+            buf[n]= '\0';
+            return strtof(buf, nullptr);
+        }
+    }
+
+    return neg ? -r : r;
+}
+
+int32_t decimal_to_int(const char *s, char **end)
+{
+    const char *p= s;
+    while(*p == ' ' || *p == '\t') ++p;
+    bool neg= *p == '-';
+    if(neg || *p == '+') ++p;
+
+    if(!is_digit(*p)) {
+        if(end != nullptr) *end= (char *)s;
+        return 0;
+    }
+
+    uint32_t n= 0;
+    for (; is_digit(*p); ++p) n= n * 10 + (*p - '0');
+    if(end != nullptr) *end= (char *)p;
+    return neg ? (int32_t)(0 - n) : (int32_t)n;
+}
@@ -0,0 +1,20 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Number parsers for the values of gcode words, they only take what gcode uses: leading blanks, a sign, digits and an
+// optional fraction. There is no exponent, so X1E2 is X1 followed by E2, and no hex, inf or nan.
+// Like strtof/strtol end is set to just after the number, or to s if there is none, and may be nullptr.
+
+// correctly rounded, the same as strtof for the same digits
+float decimal_to_float(const char *s, char **end);
+
+// the integer part, wraps rather than saturating so it can also be used for unsigned values
+int32_t decimal_to_int(const char *s, char **end);
@@ -7,103 +7,135 @@
 
 
 #include "Gcode.h"
+#include "DecimalParser.h"
 #include "libs/StreamOutput.h"
 #include "utils.h"
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <algorithm>
 
 // This is a gcode object. It represents a GCode string/command, and caches some important values about that command for the sake of performance.
 // It gets passed around in events, and attached to the queue ( that'll change )
-Gcode::Gcode(const string &command, StreamOutput *stream, bool strip)
+// The line is tokenized once when it is created into a value for each letter, lines that fit in the object are not copied to the heap
+Gcode::Gcode(const string &command, StreamOutput *stream, bool strip) : Gcode(command.data(), command.size(), stream, strip)
 {
-    this->command= strdup(command.c_str());
+}
+
+// n chars of line, which does not need to be null terminated
+Gcode::Gcode(const char *line, size_t n, StreamOutput *stream, bool strip)
+{
+    this->command= nullptr;
+    set_command(line, n);
     this->m= 0;
     this->g= 0;
     this->subcode= 0;
     this->add_nl= false;
     this->is_error= false;
     this->stream= stream;
-    prepare_cached_values(strip);
     this->stripped= strip;
+    prepare_cached_values(strip);
 }
 
 Gcode::~Gcode()
 {
-    if(command != nullptr) {
-        // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+    if(command != inline_command) {
         free(command);
     }
 }
 
 Gcode::Gcode(const Gcode &to_copy)
 {
-    this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
-    this->has_m                 = to_copy.has_m;
-    this->has_g                 = to_copy.has_g;
-    this->m                     = to_copy.m;
-    this->g                     = to_copy.g;
-    this->subcode               = to_copy.subcode;
-    this->add_nl                = to_copy.add_nl;
-    this->is_error              = to_copy.is_error;
-    this->stream                = to_copy.stream;
-    this->txt_after_ok.assign( to_copy.txt_after_ok );
+    this->command= nullptr;
+    *this= to_copy;
 }
 
 Gcode &Gcode::operator= (const Gcode &to_copy)
 {
     if( this != &to_copy ) {
-        this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+        set_command(to_copy.command, strlen(to_copy.command));
         this->has_m                 = to_copy.has_m;
         this->has_g                 = to_copy.has_g;
         this->m                     = to_copy.m;
         this->g                     = to_copy.g;
         this->subcode               = to_copy.subcode;
         this->add_nl                = to_copy.add_nl;
+        this->stripped              = to_copy.stripped;
         this->is_error              = to_copy.is_error;
         this->stream                = to_copy.stream;
         this->txt_after_ok.assign( to_copy.txt_after_ok );
+        this->letters               = to_copy.letters;
+        this->arg_letters           = to_copy.arg_letters;
+        this->value_letters         = to_copy.value_letters;
+        this->num_args              = to_copy.num_args;
+        memcpy(this->values, to_copy.values, sizeof(values));
+        memcpy(this->int_values, to_copy.int_values, sizeof(int_values));
     }
     return *this;
 }
 
+// copy the text of the command, into the object if it fits
+void Gcode::set_command(const char *s, size_t n)
+{
+    // s may be in our own buffer when stripping so move rather than copy
+    if(n < k_inline_command) {
+        memmove(inline_command, s, n);
+        inline_command[n]= '\0';
+        if(command != nullptr && command != inline_command) free(command);
+        command= inline_command;
+
+    } else {
+        char *c= (char *)malloc(n + 1);
+        memcpy(c, s, n);
+        c[n]= '\0';
+        if(command != nullptr && command != inline_command) free(command);
+        command= c;
+    }
+}
 
 // Whether or not a Gcode has a letter
 bool Gcode::has_letter( char letter ) const
 {
-    for (size_t i = 0; i < strlen(this->command); ++i) {
-        if( command[i] == letter ) {
-            return true;
-        }
+    if(letter >= 'A' && letter <= 'Z') {
+        return letters & (1UL << (letter - 'A'));
     }
-    return false;
+    return strchr(command, letter) != nullptr;
 }
 
 // Retrieve the value for a given letter
 float Gcode::get_value( char letter, char **ptr ) const
 {
-    const char *cs = command;
-    char *cn = NULL;
-    for (; *cs; cs++) {
-        if( letter == *cs ) {
-            cs++;
-            float r = strtof(cs, &cn);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
-                return r;
-        }
+    if(ptr == nullptr && letter >= 'A' && letter <= 'Z') {
+        return (value_letters & (1UL << (letter - 'A'))) ? values[letter - 'A'] : 0;
     }
-    if(ptr != nullptr) *ptr= nullptr;
-    return 0;
+    return scan_value(letter, ptr);
 }
 
 int Gcode::get_int( char letter, char **ptr ) const
+{
+    if(ptr == nullptr && letter >= 'A' && letter <= 'Z') {
+        return (value_letters & (1UL << (letter - 'A'))) ? int_values[letter - 'A'] : 0;
+    }
+    return scan_int(letter, ptr);
+}
+
+uint32_t Gcode::get_uint( char letter, char **ptr ) const
+{
+    if(ptr == nullptr && letter >= 'A' && letter <= 'Z') {
+        return (value_letters & (1UL << (letter - 'A'))) ? int_values[letter - 'A'] : 0;
+    }
+    return scan_int(letter, ptr);
+}
+
+// the slow way, for anything other than a letter or when the end of the value is needed
+float Gcode::scan_value( char letter, char **ptr ) const
 {
     const char *cs = command;
     char *cn = NULL;
     for (; *cs; cs++) {
         if( letter == *cs ) {
             cs++;
-            int r = strtol(cs, &cn, 10);
+            float r = decimal_to_float(cs, &cn);
             if(ptr != nullptr) *ptr= cn;
             if (cn > cs)
                 return r;
@@ -113,14 +145,14 @@ int Gcode::get_int( char letter, char **ptr ) const
     return 0;
 }
 
-uint32_t Gcode::get_uint( char letter, char **ptr ) const
+long Gcode::scan_int( char letter, char **ptr ) const
 {
     const char *cs = command;
     char *cn = NULL;
     for (; *cs; cs++) {
         if( letter == *cs ) {
             cs++;
-            int r = strtoul(cs, &cn, 10);
+            int r = decimal_to_int(cs, &cn);
             if(ptr != nullptr) *ptr= cn;
             if (cn > cs)
                 return r;
@@ -132,25 +164,14 @@ uint32_t Gcode::get_uint( char letter, char **ptr ) const
 
 int Gcode::get_num_args() const
 {
-    int count = 0;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        if( this->command[i] >= 'A' && this->command[i] <= 'Z' ) {
-            if(this->command[i] == 'T') continue;
-            count++;
-        }
-    }
-    return count;
+    return num_args;
 }
 
 std::map<char,float> Gcode::get_args() const
 {
     std::map<char,float> m;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        char c= this->command[i];
-        if( c >= 'A' && c <= 'Z' ) {
-            if(c == 'T') continue;
-            m[c]= get_value(c);
-        }
+    for (int i = 0; i < 26; ++i) {
+        if(arg_letters & (1UL << i)) m['A' + i]= get_value('A' + i);
     }
     return m;
 }
@@ -158,85 +179,113 @@ std::map<char,float> Gcode::get_args() const
 std::map<char,int> Gcode::get_args_int() const
 {
     std::map<char,int> m;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        char c= this->command[i];
-        if( c >= 'A' && c <= 'Z' ) {
-            if(c == 'T') continue;
-            m[c]= get_int(c);
-        }
+    for (int i = 0; i < 26; ++i) {
+        if(arg_letters & (1UL << i)) m['A' + i]= get_int('A' + i);
     }
     return m;
 }
 
+// one pass over the command, records which letters there are and the value after the first of each letter that has one
+// every upper case letter counts, even in the middle of a word, the same as searching the line for it would
+void Gcode::parse_args()
+{
+    letters= 0;
+    arg_letters= 0;
+    value_letters= 0;
+    num_args= 0;
+
+    // when not stripped the first letter is the G or M
+    size_t first_arg= stripped ? 0 : 1;
+    for (size_t i = 0; command[i] != '\0'; ++i) {
+        char c= command[i];
+        if(c < 'A' || c > 'Z') continue;
+
+        uint32_t bit= 1UL << (c - 'A');
+        letters |= bit;
+        if(i >= first_arg && c != 'T') {
+            arg_letters |= bit;
+            ++num_args;
+        }
+
+        if(value_letters & bit) continue;
+
+        const char *cs= &command[i + 1];
+        char *cn;
+        float r= decimal_to_float(cs, &cn);
+        if(cn > cs) {
+            value_letters |= bit;
+            values[c - 'A']= r;
+            int_values[c - 'A']= decimal_to_int(cs, nullptr);
+        }
+    }
+}
+
 // Cache some of this command's properties, so we don't have to parse the string every time we want to look at them
 void Gcode::prepare_cached_values(bool strip)
 {
     char *p= nullptr;
-    if( this->has_letter('G') ) {
-        this->has_g = true;
-        this->g = this->get_int('G', &p);
-
-    } else {
-        this->has_g = false;
+    char *pg= nullptr;
+    int gv= scan_int('G', &pg);
+    this->has_g = pg != nullptr;
+    if(has_g) {
+        this->g = gv;
+        p= pg;
     }
 
-    if( this->has_letter('M') ) {
-        this->has_m = true;
-        this->m = this->get_int('M', &p);
-
-    } else {
-        this->has_m = false;
+    char *pm= nullptr;
+    int mv= scan_int('M', &pm);
+    this->has_m = pm != nullptr;
+    if(has_m) {
+        this->m = mv;
+        p= pm;
     }
 
     if(has_g || has_m) {
         // look for subcode and extract it
         if(p != nullptr && *p == '.') {
-            this->subcode = strtoul(p+1, &p, 10);
+            this->subcode = decimal_to_int(p+1, &p);
 
         }else{
             this->subcode= 0;
         }
     }
 
-    if(!strip) return;
-
     // remove the Gxxx or Mxxx from string
-    if (p != nullptr) {
-        char *n= strdup(p); // create new string starting at end of the numeric value
-        free(command);
-        command= n;
+    if (strip && p != nullptr) {
+        set_command(p, strlen(p)); // starting at end of the numeric value
     }
+
+    parse_args();
 }
 
 // strip off X Y Z I J K parameters if G0/1/2/3
 void Gcode::strip_parameters()
 {
     if(has_g && g < 4){
-        // strip the command of the XYZIJK parameters
-        string newcmd;
+        // strip the command of the XYZIJK parameters, in place as it only gets shorter
+        char *out= command;
         char *cn= command;
         // find the start of each parameter
         char *pch= strpbrk(cn, "XYZIJK");
         while (pch != nullptr) {
             if(pch > cn) {
                 // copy non parameters to new string
-                newcmd.append(cn, pch-cn);
+                memmove(out, cn, pch-cn);
+                out += pch-cn;
             }
             // find the end of the parameter and its value
             char *eos;
-            strtof(pch+1, &eos);
+            decimal_to_float(pch+1, &eos);
             cn= eos; // point to end of last parameter
             pch= strpbrk(cn, "XYZIJK"); // find next parameter
         }
         // append anything left on the line
-        newcmd.append(cn);
+        size_t n= strlen(cn);
+        memmove(out, cn, n + 1);
 
         // strip whitespace to save even more, this causes problems so don't do it
         //newcmd.erase(std::remove_if(newcmd.begin(), newcmd.end(), ::isspace), newcmd.end());
 
-        // release the old one
-        free(command);
-        // copy the new shortened one
-        command= strdup(newcmd.c_str());
+        parse_args();
     }
 }
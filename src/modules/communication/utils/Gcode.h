@@ -19,6 +19,7 @@ class StreamOutput;
 class Gcode {
     public:
         Gcode(const string&, StreamOutput*, bool strip=true);
+        Gcode(const char *line, size_t n, StreamOutput*, bool strip=true);
         Gcode(const Gcode& to_copy);
         Gcode& operator= (const Gcode& to_copy);
         ~Gcode();
@@ -51,6 +52,20 @@ class Gcode {
 
     private:
         void prepare_cached_values(bool strip=true);
-        char *command;
+        void set_command(const char *s, size_t n);
+        void parse_args();
+        float scan_value(char letter, char **ptr) const;
+        long scan_int(char letter, char **ptr) const;
+
+        // the line is tokenized once into a value per letter, so looking up a letter does not have to parse the line
+        static const size_t k_inline_command= 96;
+        char *command;                          // points at inline_command unless the line is too long for it
+        char inline_command[k_inline_command];
+        uint32_t letters;                       // a bit for each upper case letter anywhere in the command
+        uint32_t arg_letters;                   // the same for the letters counted as arguments
+        uint32_t value_letters;                 // a bit for each letter that is followed by a number
+        uint8_t num_args;
+        float values[26];                       // the value after the first of each letter that has one
+        int32_t int_values[26];                 // and the same as an integer
 };
 #endif
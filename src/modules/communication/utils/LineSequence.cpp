@@ -0,0 +1,39 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LineSequence.h"
+
+LineSequence::RESULT LineSequence::check(int32_t ln, bool good)
+{
+    if(good) {
+        if(ln == last + 1) {
+            last= ln;
+            resending= false;
+            return ACCEPT;
+        }
+        if(ln <= last && last - ln < k_window) {
+            // the host has gone back further than it was asked to, from here on it is resending
+            if(resending) restarted= true;
+            return DUPLICATE;
+        }
+    }
+
+    // until the host goes back the lines that were in flight when rs was sent come in order and are dropped, anything
+    // else means a line has been lost or corrupted since, maybe the resent line itself, so the host is asked again
+    // rather than every line after it being dropped. A bad line with the expected N is the resent line failing again
+    if(resending && !restarted && (good ? ln == next : ln != last + 1) && discarded < k_window) {
+        ++next;
+        ++discarded;
+        return DISCARD;
+    }
+
+    resending= true;
+    restarted= false;
+    discarded= 0;
+    next= ln > last ? ln + 1 : last + 2;
+    return RESEND;
+}
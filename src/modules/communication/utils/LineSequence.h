@@ -0,0 +1,45 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Checks the N numbers of lines sent with a line number and checksum, so a host can have many lines in flight.
+ *
+ * Every line gets one reply, so a host counting characters can still free the bytes of each line.
+ * The first line that fails the checksum or is out of order gets rs N<next>, the host resends from there.
+ * The lines after it that were already in flight are discarded with "ok - discarded" rather than each asking for the
+ * resend again, until N<next> arrives. If the resent line is lost or corrupted too, the first line that does not carry on
+ * from the ones in flight asks again, and so does a run of more than k_window discarded lines in case it can not tell.
+ * A line that has already been run and is within the last k_window lines is a duplicate from the host going back too
+ * far, it gets ok and is not run again.
+ */
+class LineSequence {
+    public:
+        enum RESULT {
+            ACCEPT,     // run it
+            DUPLICATE,  // reply ok, do not run it
+            RESEND,     // reply rs N<expected>
+            DISCARD     // reply ok - discarded
+        };
+
+        static const int32_t k_window= 64;
+
+        RESULT check(int32_t ln, bool good);
+        // M110, the next line is ln + 1
+        void set(int32_t ln) { last= ln; resending= false; restarted= false; }
+        int32_t expected() const { return last + 1; }
+
+    private:
+        int32_t last{-1};
+        int32_t next{0};        // the N the next line in flight has if the host has not gone back yet
+        int32_t discarded{0};   // since the last rs
+        bool resending{false};
+        bool restarted{false};  // the host has gone back to resend
+};
@@ -0,0 +1,63 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <string.h>
+
+// A piece of a received line that points into it rather than copying it, so a line can be picked apart without allocating.
+// The line must stay put while the view is in use.
+struct LineView {
+    const char *p;
+    size_t n;
+
+    bool empty() const { return n == 0; }
+    char operator[](size_t i) const { return p[i]; }
+
+    // index of the first char in set at or after from, n if there is none
+    size_t find_first_of(const char *set, size_t from= 0) const
+    {
+        for (size_t i = from; i < n; ++i) {
+            if(in_set(p[i], set)) return i;
+        }
+        return n;
+    }
+
+    // index of the first char not in set at or after from, n if there is none
+    size_t find_first_not_of(const char *set, size_t from= 0) const
+    {
+        for (size_t i = from; i < n; ++i) {
+            if(!in_set(p[i], set)) return i;
+        }
+        return n;
+    }
+
+    bool starts_with(const char *s) const
+    {
+        size_t k= strlen(s);
+        return k <= n && strncmp(p, s, k) == 0;
+    }
+
+    void remove_prefix(size_t k) { p += k; n -= k; }
+    void truncate(size_t k) { if(k < n) n= k; }
+
+    // splits off the first k chars and returns them
+    LineView take_front(size_t k)
+    {
+        if(k > n) k= n;
+        LineView v{p, k};
+        remove_prefix(k);
+        return v;
+    }
+
+    // a copy from index from to the end, for the few commands that need a string
+    std::string str(size_t from= 0) const { return from < n ? std::string(p + from, n - from) : std::string(); }
+
+    // strchr() would match the terminating null
+    static bool in_set(char c, const char *set) { return c != '\0' && strchr(set, c) != nullptr; }
+};
@@ -25,8 +25,11 @@ using std::string;
 
 #define STEP_TICKER_FREQUENCY THEKERNEL->step_ticker->get_frequency()
 
+// an S-curve ramp is rounded up to whole ticks, so the speeds it is planned for allow it this many ticks more
+static const float ramp_rounding_ticks= 3;
+
 uint8_t Block::n_actuators= 0;
-double Block::fp_scale= 0;
+float Block::fp_scale= 0;
 
 // A block represents a movement, it's length for each stepper motor, and the corresponding acceleration curves.
 // It's stacked on a queue, and that queue is then executed in order, to move the motors.
@@ -36,13 +39,14 @@ double Block::fp_scale= 0;
 Block::Block()
 {
     tick_info= nullptr;
+    arc= nullptr;
     clear();
 }
 
 void Block::init(uint8_t n)
 {
     n_actuators= n;
-    fp_scale= (double)STEPTICKER_FPSCALE / pow((double)STEP_TICKER_FREQUENCY, 2.0); // we scale up by fixed point offset first to avoid tiny values
+    fp_scale= 1.0F / (STEP_TICKER_FREQUENCY * STEP_TICKER_FREQUENCY); // single precision, 1/f² is well within float range and the fixed point scaling is done by STEPTICKER_TOFP
 }
 
 void Block::clear()
@@ -58,37 +62,40 @@ void Block::clear()
     entry_speed         = 0.0F;
     exit_speed          = 0.0F;
     acceleration        = 100.0F; // we don't want to get divide by zeroes if this is not set
+    jerk                = 0.0F;
     initial_rate        = 0.0F;
     accelerate_until    = 0;
     decelerate_after    = 0;
+    accel_jerk_ticks    = 0;
+    decel_jerk_ticks    = 0;
     direction_bits      = 0;
     recalculate_flag    = false;
     nominal_length_flag = false;
+    stale_trapezoid     = false;
     max_entry_speed     = 0.0F;
     is_ticking          = false;
     is_g123             = false;
     locked              = false;
+    is_s_curve          = false;
+    is_independent      = false;
+    wait_for_channels   = false;
     s_value             = 0.0F;
 
     total_move_ticks= 0;
-    if(tick_info == nullptr) {
-        // we create this once for this block
-        tick_info= new tickinfo_t[n_actuators]; //(tickinfo_t *)malloc(sizeof(tickinfo_t) * n_actuators);
-        if(tick_info == nullptr) {
-            // if we ran out of memory in AHB0 just stop here
-            __debugbreak();
-        }
+
+    if(arc != nullptr) {
+        arc->in_use= false;
+        arc= nullptr;
     }
 
+    // the tick info is assigned by the BlockQueue from its pool once the block is in the queue
+    if(tick_info == nullptr) return;
+
     for(int i = 0; i < n_actuators; ++i) {
         tick_info[i].steps_per_tick= 0;
-        tick_info[i].counter= 0;
-        tick_info[i].acceleration_change= 0;
-        tick_info[i].deceleration_change= 0;
+        tick_info[i].accel= 0;
+        tick_info[i].decel= 0;
         tick_info[i].plateau_rate= 0;
-        tick_info[i].steps_to_move= 0;
-        tick_info[i].step_count= 0;
-        tick_info[i].next_accel_event= 0;
     }
 }
 
@@ -98,12 +105,13 @@ void Block::debug() const
     for (size_t i = E_AXIS; i < n_actuators; ++i) {
         THEKERNEL->streams->printf("%c:%lu ", 'A' + i-E_AXIS, this->steps[i]);
     }
-    THEKERNEL->streams->printf("(max:%lu) nominal:r%1.4f/s%1.4f mm:%1.4f acc:%1.2f accu:%lu decu:%lu ticks:%lu rates:%1.4f/%1.4f entry/max:%1.4f/%1.4f exit:%1.4f primary:%d ready:%d locked:%d ticking:%d recalc:%d nomlen:%d time:%f\r\n",
+    THEKERNEL->streams->printf("(max:%lu) nominal:r%1.4f/s%1.4f mm:%1.4f acc:%1.2f jerk:%1.2f accu:%lu decu:%lu ticks:%lu rates:%1.4f/%1.4f entry/max:%1.4f/%1.4f exit:%1.4f primary:%d ready:%d locked:%d ticking:%d recalc:%d nomlen:%d time:%f\r\n",
                                this->steps_event_count,
                                this->nominal_rate,
                                this->nominal_speed,
                                this->millimeters,
                                this->acceleration,
+                               this->jerk,
                                this->accelerate_until,
                                this->decelerate_after,
                                this->total_move_ticks,
@@ -135,7 +143,8 @@ void Block::debug() const
 void Block::calculate_trapezoid( float entryspeed, float exitspeed )
 {
     // if block is currently executing, don't touch anything!
-    if (is_ticking) return;
+    // independent axis blocks always start and end at rest so they were calculated once when they were added
+    if (is_ticking || is_independent) return;
 
     float initial_rate = this->nominal_rate * (entryspeed / this->nominal_speed); // steps/sec
     float final_rate = this->nominal_rate * (exitspeed / this->nominal_speed);
@@ -144,72 +153,103 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     // This is a simplification to get rid of rate_delta and get the steps/s² accel directly from the mm/s² accel
     float acceleration_per_second = (this->acceleration * this->steps_event_count) / this->millimeters;
 
-    float maximum_possible_rate = sqrtf( ( this->steps_event_count * acceleration_per_second ) + ( ( powf(initial_rate, 2) + powf(final_rate, 2) ) / 2.0F ) );
-
-    //printf("id %d: acceleration_per_second: %f, maximum_possible_rate: %f steps/sec, %f mm/sec\n", this->id, acceleration_per_second, maximum_possible_rate, maximum_possible_rate/100);
-
-    // Now this is the maximum rate we'll achieve this move, either because
-    // it's the higher we can achieve, or because it's the higher we are
-    // allowed to achieve
-    this->maximum_rate = std::min(maximum_possible_rate, this->nominal_rate);
+    uint32_t acceleration_ticks, deceleration_ticks, total_move_ticks;
+    float acceleration_in_steps = 0, deceleration_in_steps = 0;
+    float accel_jerk_in_steps = 0, decel_jerk_in_steps = 0;
+    uint32_t accel_jerk_ticks = 0, decel_jerk_ticks = 0;
+    bool s_curve = false;
+
+    if(this->jerk > 0.0F) {
+        // For an S-curve each ramp ramps the acceleration up at the jerk limit, holds it at the acceleration limit if the
+        // change in rate is large enough to reach it, and ramps it down again, so with the plateau there are 7 segments.
+        // The ramps are longer than the trapezoid's so neither limit is passed, the planner allows for that in its speeds.
+        float jerk_per_second = (this->jerk * this->steps_event_count) / this->millimeters; // steps/s³
+        this->maximum_rate = s_curve_peak_rate(initial_rate, final_rate, acceleration_per_second, jerk_per_second);
+
+        // a ramp takes no more ticks than the whole block would at its average rate, it only needs capping when rounding
+        // leaves it short of room, then the acceleration is ramped for the whole ramp which gives the lowest jerk in it
+        auto max_ticks = [&](float rate) { return (uint32_t)floorf(2.0F * this->steps_event_count / (rate + this->maximum_rate) * STEP_TICKER_FREQUENCY); };
+        acceleration_ticks = ramp_ticks(this->maximum_rate - initial_rate, acceleration_per_second, jerk_per_second, max_ticks(initial_rate), accel_jerk_ticks, accel_jerk_in_steps);
+        deceleration_ticks = ramp_ticks(this->maximum_rate - final_rate, acceleration_per_second, jerk_per_second, max_ticks(final_rate), decel_jerk_ticks, decel_jerk_in_steps);
+
+        // a ramp covers its average rate over its time, the plateau is the rest
+        float ramp_steps = ((initial_rate + this->maximum_rate) * acceleration_ticks + (this->maximum_rate + final_rate) * deceleration_ticks) / (2.0F * STEP_TICKER_FREQUENCY);
+        float plateau_steps = this->steps_event_count - ramp_steps;
+        total_move_ticks = acceleration_ticks + deceleration_ticks;
+        if(plateau_steps > 0.0F) total_move_ticks += floorf(plateau_steps / this->maximum_rate * STEP_TICKER_FREQUENCY);
+        s_curve = accel_jerk_ticks > 0 || decel_jerk_ticks > 0;
+
+    } else {
+        float maximum_possible_rate = sqrtf( ( this->steps_event_count * acceleration_per_second ) + ( ( powf(initial_rate, 2) + powf(final_rate, 2) ) / 2.0F ) );
+
+        //printf("id %d: acceleration_per_second: %f, maximum_possible_rate: %f steps/sec, %f mm/sec\n", this->id, acceleration_per_second, maximum_possible_rate, maximum_possible_rate/100);
+
+        // Now this is the maximum rate we'll achieve this move, either because
+        // it's the higher we can achieve, or because it's the higher we are
+        // allowed to achieve
+        this->maximum_rate = std::min(maximum_possible_rate, this->nominal_rate);
+
+        // Now figure out how long it takes to accelerate in seconds
+        float time_to_accelerate = ( this->maximum_rate - initial_rate ) / acceleration_per_second;
+
+        // Now figure out how long it takes to decelerate
+        float time_to_decelerate = ( final_rate -  this->maximum_rate ) / -acceleration_per_second;
+
+        // Now we know how long it takes to accelerate and decelerate, but we must
+        // also know how long the entire move takes so we can figure out how long
+        // is the plateau if there is one
+        float plateau_time = 0;
+
+        // Only if there is actually a plateau ( we are limited by nominal_rate )
+        if(maximum_possible_rate > this->nominal_rate) {
+            // Figure out the acceleration and deceleration distances ( in steps )
+            float acceleration_distance = ( ( initial_rate + this->maximum_rate ) / 2.0F ) * time_to_accelerate;
+            float deceleration_distance = ( ( this->maximum_rate + final_rate ) / 2.0F ) * time_to_decelerate;
+
+            // Figure out the plateau steps
+            float plateau_distance = this->steps_event_count - acceleration_distance - deceleration_distance;
+
+            // Figure out the plateau time in seconds
+            plateau_time = plateau_distance / this->maximum_rate;
+        }
 
-    // Now figure out how long it takes to accelerate in seconds
-    float time_to_accelerate = ( this->maximum_rate - initial_rate ) / acceleration_per_second;
+        // Figure out how long the move takes total ( in seconds )
+        float total_move_time = time_to_accelerate + time_to_decelerate + plateau_time;
+        //puts "total move time: #{total_move_time}s time to accelerate: #{time_to_accelerate}, time to decelerate: #{time_to_decelerate}"
 
-    // Now figure out how long it takes to decelerate
-    float time_to_decelerate = ( final_rate -  this->maximum_rate ) / -acceleration_per_second;
+        // We now have the full timing for acceleration, plateau and deceleration,
+        // yay \o/ Now this is very important these are in seconds, and we need to
+        // round them into ticks. This means instead of accelerating in 100.23
+        // ticks we'll accelerate in 100 ticks. Which means to reach the exact
+        // speed we want to reach, we must figure out a new/slightly different
+        // acceleration/deceleration to be sure we accelerate and decelerate at
+        // the exact rate we want
 
-    // Now we know how long it takes to accelerate and decelerate, but we must
-    // also know how long the entire move takes so we can figure out how long
-    // is the plateau if there is one
-    float plateau_time = 0;
+        // First off round total time, acceleration time and deceleration time in ticks
+        acceleration_ticks = floorf( time_to_accelerate * STEP_TICKER_FREQUENCY );
+        deceleration_ticks = floorf( time_to_decelerate * STEP_TICKER_FREQUENCY );
+        total_move_ticks   = floorf( total_move_time    * STEP_TICKER_FREQUENCY );
 
-    // Only if there is actually a plateau ( we are limited by nominal_rate )
-    if(maximum_possible_rate > this->nominal_rate) {
-        // Figure out the acceleration and deceleration distances ( in steps )
-        float acceleration_distance = ( ( initial_rate + this->maximum_rate ) / 2.0F ) * time_to_accelerate;
-        float deceleration_distance = ( ( this->maximum_rate + final_rate ) / 2.0F ) * time_to_decelerate;
+        // Now deduce the plateau time for those new values expressed in tick
+        //uint32_t plateau_ticks = total_move_ticks - acceleration_ticks - deceleration_ticks;
 
-        // Figure out the plateau steps
-        float plateau_distance = this->steps_event_count - acceleration_distance - deceleration_distance;
+        // Now we figure out the acceleration value to reach EXACTLY maximum_rate(steps/s) in EXACTLY acceleration_ticks(ticks) amount of time in seconds
+        float acceleration_time = acceleration_ticks / STEP_TICKER_FREQUENCY;  // This can be moved into the operation below, separated for clarity, note we need to do this instead of using time_to_accelerate(seconds) directly because time_to_accelerate(seconds) and acceleration_ticks(seconds) do not have the same value anymore due to the rounding
+        float deceleration_time = deceleration_ticks / STEP_TICKER_FREQUENCY;
 
-        // Figure out the plateau time in seconds
-        plateau_time = plateau_distance / this->maximum_rate;
+        acceleration_in_steps = (acceleration_time > 0.0F ) ? ( this->maximum_rate - initial_rate ) / acceleration_time : 0;
+        deceleration_in_steps =  (deceleration_time > 0.0F ) ? ( this->maximum_rate - final_rate ) / deceleration_time : 0;
     }
 
-    // Figure out how long the move takes total ( in seconds )
-    float total_move_time = time_to_accelerate + time_to_decelerate + plateau_time;
-    //puts "total move time: #{total_move_time}s time to accelerate: #{time_to_accelerate}, time to decelerate: #{time_to_decelerate}"
-
-    // We now have the full timing for acceleration, plateau and deceleration,
-    // yay \o/ Now this is very important these are in seconds, and we need to
-    // round them into ticks. This means instead of accelerating in 100.23
-    // ticks we'll accelerate in 100 ticks. Which means to reach the exact
-    // speed we want to reach, we must figure out a new/slightly different
-    // acceleration/deceleration to be sure we accelerate and decelerate at
-    // the exact rate we want
-
-    // First off round total time, acceleration time and deceleration time in ticks
-    uint32_t acceleration_ticks = floorf( time_to_accelerate * STEP_TICKER_FREQUENCY );
-    uint32_t deceleration_ticks = floorf( time_to_decelerate * STEP_TICKER_FREQUENCY );
-    uint32_t total_move_ticks   = floorf( total_move_time    * STEP_TICKER_FREQUENCY );
-
-    // Now deduce the plateau time for those new values expressed in tick
-    //uint32_t plateau_ticks = total_move_ticks - acceleration_ticks - deceleration_ticks;
-
-    // Now we figure out the acceleration value to reach EXACTLY maximum_rate(steps/s) in EXACTLY acceleration_ticks(ticks) amount of time in seconds
-    float acceleration_time = acceleration_ticks / STEP_TICKER_FREQUENCY;  // This can be moved into the operation below, separated for clarity, note we need to do this instead of using time_to_accelerate(seconds) directly because time_to_accelerate(seconds) and acceleration_ticks(seconds) do not have the same value anymore due to the rounding
-    float deceleration_time = deceleration_ticks / STEP_TICKER_FREQUENCY;
-
-    float acceleration_in_steps = (acceleration_time > 0.0F ) ? ( this->maximum_rate - initial_rate ) / acceleration_time : 0;
-    float deceleration_in_steps =  (deceleration_time > 0.0F ) ? ( this->maximum_rate - final_rate ) / deceleration_time : 0;
-
     // we have a potential race condition here as we could get interrupted anywhere in the middle of this call, we need to lock
     // the updates to the blocks to get around it
     this->locked= true;
     // Now figure out the two acceleration ramp change events in ticks
     this->accelerate_until = acceleration_ticks;
     this->decelerate_after = total_move_ticks - deceleration_ticks;
+    this->is_s_curve = s_curve;
+    this->accel_jerk_ticks = s_curve ? accel_jerk_ticks : 0;
+    this->decel_jerk_ticks = s_curve ? decel_jerk_ticks : 0;
 
     // We now have everything we need for this block to call a Steppermotor->move method !!!!
     // Theorically, if accel is done per tick, the speed curve should be perfect.
@@ -219,16 +259,178 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     this->exit_speed = exitspeed;
 
     // prepare the block for stepticker
-    this->prepare(acceleration_in_steps, deceleration_in_steps);
+    this->prepare(acceleration_in_steps, deceleration_in_steps, accel_jerk_in_steps, decel_jerk_in_steps);
 
     this->locked= false;
 }
 
+// Calculates a trapezoid for each motor on its own, using that motor's rate (steps/sec) and acceleration (steps/sec²),
+// each motor starts and ends at rest and finishes as soon as it can, the block is done when the last motor is done.
+// This is not called again by the planner as nothing before or after the block can change it.
+void Block::calculate_independent_trapezoids(const float rates[], const float accelerations[])
+{
+    uint32_t longest_ticks = 0;
+
+    this->locked= true;
+    this->is_independent = true;
+    this->is_s_curve = false;
+    this->accel_jerk_ticks = 0;
+    this->decel_jerk_ticks = 0;
+    this->initial_rate = 0;
+    this->entry_speed = 0;
+    this->exit_speed = 0;
+    this->maximum_rate = 0;
+
+    for (uint8_t m = 0; m < n_actuators; m++) {
+        if(this->steps[m] == 0) continue;
+
+        uint32_t move_ticks = independent_trapezoid(this->steps[m], rates[m], accelerations[m], this->tick_info[m]);
+        if(move_ticks > longest_ticks) {
+            longest_ticks = move_ticks;
+            this->maximum_rate = std::min(rates[m], sqrtf(this->steps[m] * accelerations[m])); // for debug only as each motor has its own
+        }
+    }
+
+    // the block level ramp ticks are not used by independent blocks, only the total
+    this->accelerate_until = 0;
+    this->decelerate_after = longest_ticks;
+    this->total_move_ticks = longest_ticks;
+
+    this->locked= false;
+}
+
+// A trapezoid for one motor that starts and ends at rest, or a triangle if it cannot reach the rate,
+// sets the ramp ticks, acceleration and plateau rate in the tick info and returns the ticks the move takes
+uint32_t Block::independent_trapezoid(uint32_t steps, float rate, float acceleration, tickinfo_t &ti)
+{
+    float inv_frequency = 1.0F / STEP_TICKER_FREQUENCY;
+
+    rate = std::min(rate, sqrtf(steps * acceleration));
+    float time_to_accelerate = rate / acceleration;
+    float plateau_time = (steps - rate * time_to_accelerate) / rate;
+    if(plateau_time < 0) plateau_time = 0;
+
+    // round up to whole ticks so the acceleration used is never more than the limit
+    uint32_t acceleration_ticks = ceilf(time_to_accelerate * STEP_TICKER_FREQUENCY);
+    uint32_t move_ticks = 2 * acceleration_ticks + floorf(plateau_time * STEP_TICKER_FREQUENCY);
+
+    // the acceleration to reach exactly the rate in exactly acceleration_ticks
+    float acceleration_per_tick = (rate / (acceleration_ticks * inv_frequency)) * fp_scale;
+
+    ti.ramp.accelerate_until = acceleration_ticks;
+    ti.ramp.decelerate_after = move_ticks - acceleration_ticks;
+    ti.accel = STEPTICKER_TOFP(acceleration_per_tick);
+    ti.decel = ti.accel;
+    ti.plateau_rate = STEPTICKER_TOFP(rate * inv_frequency);
+
+    return move_ticks;
+}
+
+// the time an S-curve ramp takes to change the rate by rate_change, and the time at each end of it the acceleration is
+// changing, the acceleration is held at its limit in between if the change is large enough to reach it
+float Block::s_curve_time(float rate_change, float acceleration, float jerk, float &jerk_time)
+{
+    if(rate_change * jerk >= acceleration * acceleration) {
+        jerk_time = acceleration / jerk;
+        return rate_change / acceleration + jerk_time;
+    }
+    jerk_time = sqrtf(rate_change / jerk);
+    return 2.0F * jerk_time;
+}
+
+// the highest rate an S-curve block can reach between starting at initial_rate and ending at final_rate within its steps
+float Block::s_curve_peak_rate(float initial_rate, float final_rate, float acceleration_in_steps, float jerk_in_steps) const
+{
+    float jerk_time;
+    float rounding_time = ramp_rounding_ticks / STEP_TICKER_FREQUENCY;
+    auto ramp_steps = [&](float from, float to) {
+        if(to == from) return 0.0F;
+        return (from + to) / 2.0F * (s_curve_time(fabsf(to - from), acceleration_in_steps, jerk_in_steps, jerk_time) + rounding_time);
+    };
+    auto steps_to = [&](float rate) { return ramp_steps(initial_rate, rate) + ramp_steps(rate, final_rate); };
+
+    if(steps_to(this->nominal_rate) <= this->steps_event_count) return this->nominal_rate;
+    float lo = std::max(initial_rate, final_rate);
+    if(steps_to(lo) >= this->steps_event_count) return lo;
+
+    // when both ramps reach the acceleration limit the steps are a quadratic in the rate
+    float k = acceleration_in_steps * acceleration_in_steps / jerk_in_steps;
+    float kr = k + acceleration_in_steps * rounding_time;
+    float c = (kr * (initial_rate + final_rate) - initial_rate * initial_rate - final_rate * final_rate) / 2.0F - acceleration_in_steps * this->steps_event_count;
+    float rate = (sqrtf(kr * kr - 4.0F * c) - kr) / 2.0F;
+    if(rate - initial_rate >= k && rate - final_rate >= k) return rate;
+
+    // otherwise halve the range, keeping to the side that fits
+    float hi = this->nominal_rate;
+    for (int i = 0; i < 16; i++) {
+        float mid = (lo + hi) / 2.0F;
+        if(steps_to(mid) <= this->steps_event_count) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Works out the ticks an S-curve ramp changing the rate by rate_change takes, and the ticks at each end of it where the
+// acceleration is changing, rounded up so neither the acceleration nor the jerk limit is passed. If that is more than
+// max_ticks the acceleration is ramped for the whole of max_ticks, which gives the lowest jerk possible in them.
+// ramp_jerk_in_steps is the jerk (steps/s³) that makes the ramp reach exactly rate_change in its ticks
+uint32_t Block::ramp_ticks(float rate_change, float acceleration_in_steps, float jerk_in_steps, uint32_t max_ticks, uint32_t &jerk_ticks, float &ramp_jerk_in_steps) const
+{
+    jerk_ticks = 0;
+    ramp_jerk_in_steps = 0;
+    if(rate_change <= 0.0F) return 0;
+
+    float jerk_time;
+    float ramp_time = s_curve_time(rate_change, acceleration_in_steps, jerk_in_steps, jerk_time);
+
+    // the peak acceleration is rate_change / (ramp_time - jerk_time) so that is rounded up on its own
+    jerk_ticks = ceilf(jerk_time * STEP_TICKER_FREQUENCY);
+    uint32_t ticks = jerk_ticks + ceilf((ramp_time - jerk_time) * STEP_TICKER_FREQUENCY);
+    if(ticks > max_ticks) {
+        ticks = max_ticks;
+        jerk_ticks = ticks / 2;
+    }
+    if(jerk_ticks == 0) return 0;
+
+    jerk_time = jerk_ticks / STEP_TICKER_FREQUENCY;
+    ramp_time = ticks / STEP_TICKER_FREQUENCY;
+    ramp_jerk_in_steps = rate_change / (jerk_time * (ramp_time - jerk_time));
+
+    return ticks;
+}
+
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
-// acceleration within the allotted distance.
-float Block::max_allowable_speed(float acceleration, float target_velocity, float distance)
+// acceleration within the allotted distance, for an S-curve block without passing the jerk limit either.
+// An S-curve ramp over a short distance covers more of it the faster it ends, so a higher target can need a lower speed
+// here, but the planner relies on a higher exit speed never needing a lower entry speed. So the ramp is taken to be at
+// the higher of its speeds all the way, which is only a little further than it is unless the change in speed is large.
+float Block::max_allowable_speed(float acceleration, float target_velocity, float distance) const
 {
-    return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+    if(this->jerk <= 0.0F) return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+
+    // the ramp time is rounded up by a few ticks too
+    float a = -acceleration;
+    float v = target_velocity;
+    float r = ramp_rounding_ticks / STEP_TICKER_FREQUENCY;
+    if(distance <= v * r) return v;
+
+    // a ramp that reaches the acceleration limit takes (speed - v)/a + a/jerk, the distance is a quadratic in the speed
+    float k = a * a / this->jerk;
+    float kr = k + a * r;
+    float b = kr - v;
+    float speed = (sqrtf(b * b + 4.0F * a * distance) - b) / 2.0F;
+    if(speed - v >= k) return speed;
+
+    // one that does not ramps up for a time t and straight back down, so (v + jerk*t²)(2t + r) = distance, Newton's
+    // method closes in on the one root from above it, starting from the lower of the times the largest terms alone give
+    float t = cbrtf(distance / (2.0F * this->jerk));
+    if(v > 0.0F) t = std::min(t, distance / (2.0F * v));
+    for (int i = 0; i < 4; i++) {
+        float g = (v + this->jerk * t * t) * (2.0F * t + r) - distance;
+        float dg = 6.0F * this->jerk * t * t + 2.0F * this->jerk * t * r + 2.0F * v;
+        t -= g / dg;
+    }
+    return v + this->jerk * t * t;
 }
 
 // Called by Planner::recalculate() when scanning the plan from last to first entry.
@@ -289,6 +491,10 @@ float Block::max_exit_speed()
     if(is_ticking)
         return this->exit_speed;
 
+    // independent axis blocks always end at rest
+    if(is_independent)
+        return 0.0F;
+
     // if nominal_length_flag is asserted
     // we are guaranteed to reach nominal speed regardless of entry speed
     // thus, max exit will always be nominal
@@ -303,70 +509,62 @@ float Block::max_exit_speed()
 
 // prepare block for the step ticker, called everytime the block changes
 // this is done during planning so does not delay tick generation and step ticker can simply grab the next block during the interrupt
-void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
+void Block::prepare(float acceleration_in_steps, float deceleration_in_steps, float accel_jerk_in_steps, float decel_jerk_in_steps)
 {
 
     float inv = 1.0F / this->steps_event_count;
 
-    // Now figure out the acceleration PER TICK, this should ideally be held as a double as it's very critical to the block timing
-    // steps/tick^2
+    // Now figure out the acceleration PER TICK in steps/tick^2
+    // this is all single precision as the FPU does not do doubles, the values are small but well within float range,
+    // and the conversion to 2.62 fixed point is an exact power of two scaling so the only error is the float rounding (~1e-7 relative)
     // was....
-    // float acceleration_per_tick = acceleration_in_steps / STEP_TICKER_FREQUENCY_2; // that is 100,000² too big for a float
-    // float deceleration_per_tick = deceleration_in_steps / STEP_TICKER_FREQUENCY_2;
-    double acceleration_per_tick = acceleration_in_steps * fp_scale; // this is now scaled to fit a 2.30 fixed point number
-    double deceleration_per_tick = deceleration_in_steps * fp_scale;
+    // double acceleration_per_tick = acceleration_in_steps * fp_scale; // with fp_scale= 2^62/f² in double
+    float acceleration_per_tick = acceleration_in_steps * fp_scale;
+    float deceleration_per_tick = deceleration_in_steps * fp_scale;
+    // steps/tick^3
+    float accel_jerk_per_tick = accel_jerk_in_steps * fp_scale / STEP_TICKER_FREQUENCY;
+    float decel_jerk_per_tick = decel_jerk_in_steps * fp_scale / STEP_TICKER_FREQUENCY;
+    // steps/sec to steps/tick
+    float rate_scale = 1.0F / STEP_TICKER_FREQUENCY;
+
+    auto scale = [&](tickinfo_t& ti, float aratio) {
+        ti.steps_per_tick = STEPTICKER_TOFP((this->initial_rate * aratio) * rate_scale); // steps/sec / tick frequency to get steps per tick in 2.62 fixed point
+
+        // scale by ratio and convert to fixed point, the step ticker works out which of these applies when from the block's ramp ticks
+        if(this->is_s_curve) {
+            // the acceleration starts and ends each ramp at zero, the step ticker changes it by the jerk every tick
+            ti.accel= STEPTICKER_TOFP(accel_jerk_per_tick * aratio);
+            ti.decel= STEPTICKER_TOFP(decel_jerk_per_tick * aratio);
+        }else{
+            ti.accel= STEPTICKER_TOFP(acceleration_per_tick * aratio);
+            ti.decel= STEPTICKER_TOFP(deceleration_per_tick * aratio);
+        }
+        ti.plateau_rate= STEPTICKER_TOFP((this->maximum_rate * aratio) * rate_scale);
+    };
+
+    if(this->arc != nullptr) {
+        // the step ticker runs the path and works out each motor's share of it chord by chord
+        scale(this->arc->path, 1.0F);
+        return;
+    }
 
     for (uint8_t m = 0; m < n_actuators; m++) {
         uint32_t steps = this->steps[m];
-        this->tick_info[m].steps_to_move = steps;
         if(steps == 0) continue;
 
-        float aratio = inv * steps;
-
-        this->tick_info[m].steps_per_tick = (int64_t)round((((double)this->initial_rate * aratio) / STEP_TICKER_FREQUENCY) * STEPTICKER_FPSCALE); // steps/sec / tick frequency to get steps per tick in 2.62 fixed point
-        this->tick_info[m].counter = 0; // 2.62 fixed point
-        this->tick_info[m].step_count = 0;
-        this->tick_info[m].next_accel_event = this->total_move_ticks + 1;
-
-        double acceleration_change = 0;
-        if(this->accelerate_until != 0) { // If the next accel event is the end of accel
-            this->tick_info[m].next_accel_event = this->accelerate_until;
-            acceleration_change = acceleration_per_tick;
-
-        } else if(this->decelerate_after == 0 /*&& this->accelerate_until == 0*/) {
-            // we start off decelerating
-            acceleration_change = -deceleration_per_tick;
-
-        } else if(this->decelerate_after != this->total_move_ticks /*&& this->accelerate_until == 0*/) {
-            // If the next event is the start of decel ( don't set this if the next accel event is accel end )
-            this->tick_info[m].next_accel_event = this->decelerate_after;
-        }
-
-        // already converted to fixed point just needs scaling by ratio
-        //#define STEPTICKER_TOFP(x) ((int64_t)round((double)(x)*STEPTICKER_FPSCALE))
-        this->tick_info[m].acceleration_change= (int64_t)round(acceleration_change * aratio);
-        this->tick_info[m].deceleration_change= -(int64_t)round(deceleration_per_tick * aratio);
-        this->tick_info[m].plateau_rate= (int64_t)round(((this->maximum_rate * aratio) / STEP_TICKER_FREQUENCY) * STEPTICKER_FPSCALE);
+        scale(this->tick_info[m], inv * steps);
 
         #if 0
         THEKERNEL->streams->printf("spt: %08lX %08lX, ac: %08lX %08lX, dc: %08lX %08lX, pr: %08lX %08lX\n",
             (uint32_t)(this->tick_info[m].steps_per_tick>>32), // 2.62 fixed point
             (uint32_t)(this->tick_info[m].steps_per_tick&0xFFFFFFFF), // 2.62 fixed point
-            (uint32_t)(this->tick_info[m].acceleration_change>>32), // 2.62 fixed point signed
-            (uint32_t)(this->tick_info[m].acceleration_change&0xFFFFFFFF), // 2.62 fixed point signed
-            (uint32_t)(this->tick_info[m].deceleration_change>>32), // 2.62 fixed point
-            (uint32_t)(this->tick_info[m].deceleration_change&0xFFFFFFFF), // 2.62 fixed point
+            (uint32_t)(this->tick_info[m].accel>>32), // 2.62 fixed point
+            (uint32_t)(this->tick_info[m].accel&0xFFFFFFFF), // 2.62 fixed point
+            (uint32_t)(this->tick_info[m].decel>>32), // 2.62 fixed point
+            (uint32_t)(this->tick_info[m].decel&0xFFFFFFFF), // 2.62 fixed point
             (uint32_t)(this->tick_info[m].plateau_rate>>32), // 2.62 fixed point
             (uint32_t)(this->tick_info[m].plateau_rate&0xFFFFFFFF) // 2.62 fixed point
         );
         #endif
     }
 }
-
-// returns current rate (steps/sec) for the given actuator
-float Block::get_trapezoid_rate(int i) const
-{
-    // convert steps per tick from fixed point to float and convert to steps/sec
-    // FIXME steps_per_tick can change at any time, potential race condition if it changes while being read here
-    return STEPTICKER_FROMFP(tick_info[i].steps_per_tick) * STEP_TICKER_FREQUENCY;
-}
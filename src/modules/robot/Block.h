@@ -17,20 +17,23 @@ class Block {
         static void init(uint8_t);
 
         void calculate_trapezoid( float entry_speed, float exit_speed );
+        void calculate_independent_trapezoids(const float rates[], const float accelerations[]);
 
         float reverse_pass(float exit_speed);
         float forward_pass(float next_entry_speed);
         float max_exit_speed();
+        float max_allowable_speed( float acceleration, float target_velocity, float distance) const;
         void debug() const;
         void ready() { is_ready= true; }
         void clear();
-        float get_trapezoid_rate(int i) const;
 
     private:
-        float max_allowable_speed( float acceleration, float target_velocity, float distance);
-        void prepare(float acceleration_in_steps, float deceleration_in_steps);
+        void prepare(float acceleration_in_steps, float deceleration_in_steps, float accel_jerk_in_steps, float decel_jerk_in_steps);
+        static float s_curve_time(float rate_change, float acceleration, float jerk, float &jerk_time);
+        float s_curve_peak_rate(float initial_rate, float final_rate, float acceleration_in_steps, float jerk_in_steps) const;
+        uint32_t ramp_ticks(float rate_change, float acceleration_in_steps, float jerk_in_steps, uint32_t max_ticks, uint32_t &jerk_ticks, float &ramp_jerk_in_steps) const;
 
-        static double fp_scale; // optimize to store this as it does not change
+        static float fp_scale; // 1/f², optimize to store this as it does not change
 
     public:
         std::array<uint32_t, k_max_actuators> steps; // Number of steps for each axis for this block
@@ -41,6 +44,7 @@ class Block {
         float entry_speed;
         float exit_speed;
         float acceleration;       // the acceleration for this block
+        float jerk;               // the max jerk for this block in mm/s^3, 0 for a plain trapezoid
         float initial_rate;       // Initial rate in steps per second
         float maximum_rate;
 
@@ -50,33 +54,59 @@ class Block {
         uint32_t accelerate_until;
         uint32_t decelerate_after;
         uint32_t total_move_ticks;
+        uint32_t accel_jerk_ticks;  // S-curve: ticks at the start and end of the accel ramp where the acceleration is changing
+        uint32_t decel_jerk_ticks;  // S-curve: ticks at the start and end of the decel ramp where the deceleration is changing
         std::bitset<k_max_actuators> direction_bits;     // Direction for each axis in bit form, relative to the direction port's mask
 
-        // this is the data needed to determine when each motor needs to be issued a step
+        // this is the data needed to determine when each motor needs to be issued a step,
+        // it does not change while the block is ticking, the step ticker keeps the running state for the current block
         using tickinfo_t= struct {
-            int64_t steps_per_tick; // 2.62 fixed point
-            int64_t counter; // 2.62 fixed point
-            int64_t acceleration_change; // 2.62 fixed point signed
-            int64_t deceleration_change; // 2.62 fixed point
+            union {
+                int64_t steps_per_tick; // 2.62 fixed point, rate at the start of the block
+                struct {
+                    // independent axis blocks always start at rest, so instead each motor has its own ramp ticks
+                    uint32_t accelerate_until;
+                    uint32_t decelerate_after;
+                } ramp;
+            };
+            int64_t accel; // 2.62 fixed point, change in rate per tick while accelerating, or for S-curves the change in acceleration per tick
+            int64_t decel; // 2.62 fixed point, same for decelerating, both are positive
             int64_t plateau_rate; // 2.62 fixed point
-            uint32_t steps_to_move;
-            uint32_t step_count;
-            uint32_t next_accel_event;
         };
 
-        // need info for each active motor
+        // need info for each active motor, this is the block's slot in the BlockQueue tick info pool
         tickinfo_t *tick_info;
 
+        static uint32_t independent_trapezoid(uint32_t steps, float rate, float acceleration, tickinfo_t &ti);
+
+        // an arc block moves the XYZ actuators around a circle or helix, the trapezoid is for the path along it which is steps_event_count
+        // steps long, the step ticker moves the actuators in a straight line between the points at the end of each chord as it goes.
+        // an actuator's steps at the end of chord n, counted in its direction, are u*(cos(n*theta) - 1) + v*sin(n*theta) + w*n
+        using arc_t= struct {
+            tickinfo_t path;            // as for a motor moving steps_event_count steps
+            float u[3], v[3], w[3];     // steps, or mm for the geometry the Robot gives the Planner
+            float cos_theta, sin_theta;
+            uint32_t chords;
+            bool in_use;                // the Planner has given it to a block
+        };
+
+        // nullptr for a straight move, otherwise the slot in the Planner's arc pool, it goes back when the block is cleared
+        arc_t *arc;
+
         static uint8_t n_actuators;
 
         struct {
             bool recalculate_flag:1;             // Planner flag to recalculate trapezoids on entry junction
             bool nominal_length_flag:1;          // Planner flag for nominal speed always reached
+            bool stale_trapezoid:1;              // Planner flag for the speeds having changed since the trapezoid was worked out
             bool is_ready:1;
             bool primary_axis:1;                 // set if this move is a primary axis
             bool is_g123:1;                      // set if this is a G1, G2 or G3
             volatile bool is_ticking:1;          // set when this block is being actively ticked by the stepticker
             volatile bool locked:1;              // set to true when the critical data is being updated, stepticker will have to skip if this is set
+            bool is_s_curve:1;                   // set if the ramps are jerk limited
+            bool is_independent:1;               // set if each motor has its own trapezoid, the block starts and ends at rest
+            bool wait_for_channels:1;            // set if the block must not start until the motion channels are done
             uint16_t s_value:12;                 // for laser 1.11 Fixed point
         };
 };
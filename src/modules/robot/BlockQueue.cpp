@@ -5,6 +5,38 @@
 #include "cmsis.h"
 #include "platform_memory.h"
 
+/*
+ * the ring is put in CCM where the step ISR can get at it without wait states,
+ * if it does not fit it falls back to AHB0 and then the heap.
+ * The tick info for all the blocks is one pool allocated right after the ring so there is no allocation per block,
+ * each block gets the slot for its index.
+ */
+
+static Block* alloc_ring(unsigned int length)
+{
+    size_t ring_size= (sizeof(Block) * length + 7) & ~7;
+    size_t size= ring_size + sizeof(Block::tickinfo_t) * Block::n_actuators * length;
+    void *v= CCM.alloc(size);
+    if(v == nullptr) v= AHB0.alloc(size);
+    if(v == nullptr) v= malloc(size);
+    if(v == nullptr) return nullptr;
+
+    Block* ring= new(v) Block[length];
+    Block::tickinfo_t* pool= (Block::tickinfo_t*)((uint8_t*)v + ring_size);
+    for (unsigned int i = 0; i < length; ++i) {
+        ring[i].tick_info= &pool[i * Block::n_actuators];
+        ring[i].clear();
+    }
+    return ring;
+}
+
+static void free_ring(Block* ring)
+{
+    if(CCM.has(ring)) CCM.dealloc(ring);
+    else if(AHB0.has(ring)) AHB0.dealloc(ring);
+    else free(ring);
+}
+
 /*
  * constructors
  */
@@ -20,8 +52,7 @@ BlockQueue::BlockQueue(unsigned int length)
 {
     head_i = tail_i = 0;
     isr_tail_i = tail_i;
-    void *v= AHB0.alloc(sizeof(Block) * length);
-    ring = new(v) Block[length];
+    ring = alloc_ring(length);
     // TODO: handle allocation failure
     this->length = length;
 }
@@ -35,7 +66,7 @@ BlockQueue::~BlockQueue()
     head_i = tail_i = length = 0;
     isr_tail_i = tail_i;
     if(ring != nullptr)
-        AHB0.dealloc(ring); // delete [] ring;
+        free_ring(ring); // delete [] ring;
     ring = nullptr;
 }
 
@@ -169,7 +200,7 @@ bool BlockQueue::resize(unsigned int length)
                 __enable_irq();
 
                 if (ring != nullptr)
-                    AHB0.dealloc(ring); // delete [] ring;
+                    free_ring(ring); // delete [] ring;
                 ring = nullptr;
 
                 return true;
@@ -181,8 +212,7 @@ bool BlockQueue::resize(unsigned int length)
         }
 
         // Note: we don't use realloc so we can fall back to the existing ring if allocation fails
-        void *v= AHB0.alloc(sizeof(Block) * length);
-        Block* newring = new(v) Block[length];
+        Block* newring = alloc_ring(length);
 
         if (newring != nullptr)
         {
@@ -199,14 +229,14 @@ bool BlockQueue::resize(unsigned int length)
                 __enable_irq();
 
                 if (oldring != nullptr)
-                    AHB0.dealloc(oldring); // delete [] oldring;
+                    free_ring(oldring); // delete [] oldring;
 
                 return true;
             }
 
             __enable_irq();
 
-            AHB0.dealloc(newring); // delete [] newring;
+            free_ring(newring); // delete [] newring;
         }
     }
 
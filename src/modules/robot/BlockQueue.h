@@ -37,6 +37,7 @@ public:
      */
     bool is_empty(void) const;
     bool is_full(void) const;
+    unsigned int free_slots(void) const { return length == 0 ? 0 : (tail_i + length - head_i - 1) % length; }
 
     /*
      * resize
@@ -22,6 +22,8 @@
 #include "StepTicker.h"
 #include "Robot.h"
 #include "StepperMotor.h"
+#include "StreamOutput.h"
+#include "platform_memory.h"
 
 #include <functional>
 
@@ -88,6 +90,8 @@ void Conveyor::on_halt(void* argument)
 {
     if(argument == nullptr) {
         flush_queue();
+        // drop any output changes still waiting, they are not run while halted so this is safe here
+        output_events.flush();
     }
 }
 
@@ -97,6 +101,9 @@ void Conveyor::on_idle(void*)
         check_queue();
     }
 
+    // keep the trapezoids up to date ahead of the blocks running while the main loop waits
+    THEKERNEL->planner->refresh_trapezoids();
+
     // we can garbage collect the block queue here
     if (queue.tail_i != queue.isr_tail_i) {
         if (queue.is_empty()) {
@@ -116,7 +123,7 @@ void Conveyor::on_idle(void*)
 // checks that all motors are no longer moving
 bool Conveyor::is_idle() const
 {
-    if(queue.is_empty()) {
+    if(queue.is_empty() && output_events.is_empty() && !THEKERNEL->step_ticker->is_channel_busy()) {
         for(auto &a : THEROBOT->actuators) {
             if(a->is_moving()) return false;
         }
@@ -166,7 +173,9 @@ void Conveyor::queue_head_block()
         return; // if we got a halt then we are done here
     }
 
+    ticks_queued += queue.head_ref()->total_move_ticks;
     queue.produce_head();
+    blocks_queued++;
 
     // not sure if this is the correct place but we need to turn on the motors if they were not already on
     THEKERNEL->call_event(ON_ENABLE, (void*)1); // turn all enable pins on
@@ -184,21 +193,37 @@ void Conveyor::check_queue(bool force)
 
     // if we have been waiting for more than the required waiting time and the queue is not empty, or the queue is full, then allow stepticker to get the tail
     // we do this to allow an idle system to pre load the queue a bit so the first few blocks run smoothly.
-    if(force || queue.is_full() || (us_ticker_read() - last_time_check) >= (queue_delay_time_ms * 1000)) {
+    if(force || is_queue_full() || (us_ticker_read() - last_time_check) >= (queue_delay_time_ms * 1000)) {
         last_time_check = us_ticker_read(); // reset timeout
         if(!flush) allow_fetch = true;
         return;
     }
 }
 
+bool Conveyor::is_queue_full()
+{
+    return queue.is_full() || THEKERNEL->planner->arcs_low();
+}
+
 // called from step ticker ISR
 bool Conveyor::get_next_block(Block **block)
 {
     // mark entire queue for GC if flush flag is asserted
     if (flush){
         while (queue.isr_tail_i != queue.head_i) {
+            ticks_finished += queue.item_ref(queue.isr_tail_i)->total_move_ticks;
             queue.isr_tail_i = queue.next(queue.isr_tail_i);
+            blocks_finished++;
         }
+        output_events.flush();
+        THEKERNEL->step_ticker->flush_position_triggers();
+    }
+
+    // any output changes queued after the blocks that have finished happen now, before the next block starts, one that has
+    // to wait for the motion channels holds the blocks after it
+    if(!output_events.is_empty() && !THEKERNEL->is_halted()) {
+        output_events.run(blocks_finished, THEKERNEL->step_ticker->is_channel_busy());
+        if(output_events.is_waiting(blocks_finished)) return false;
     }
 
     // default the feerate to zero if there is no block available
@@ -210,8 +235,8 @@ bool Conveyor::get_next_block(Block **block)
     if(!allow_fetch) return false;
 
     Block *b= queue.item_ref(queue.isr_tail_i);
-    // we cannot use this now if it is being updated
-    if(!b->locked) {
+    // we cannot use this now if it is being updated, or it has to wait for the motion channel moves queued before it (M401)
+    if(!b->locked && !(b->wait_for_channels && THEKERNEL->step_ticker->is_channel_busy())) {
         if(!b->is_ready) __debugbreak(); // should never happen
 
         b->is_ticking= true;
@@ -228,7 +253,48 @@ bool Conveyor::get_next_block(Block **block)
 void Conveyor::block_finished()
 {
     // we increment the isr_tail_i so we can get the next block
+    ticks_finished += queue.item_ref(queue.isr_tail_i)->total_move_ticks;
     queue.isr_tail_i= queue.next(queue.isr_tail_i);
+    blocks_finished++;
+}
+
+// called from the main loop, the running block's ticks are taken off as it goes
+uint32_t Conveyor::get_ticks_remaining() const
+{
+    uint32_t left, done;
+    do {
+        // read again if a block finished in between, as the tick count would be for the next one
+        left= ticks_queued - ticks_finished;
+        done= THEKERNEL->step_ticker->get_current_tick();
+    } while(left != ticks_queued - ticks_finished);
+
+    // a block can run a tick or so over what was planned
+    return done < left ? left - done : 0;
+}
+
+float Conveyor::get_time_remaining() const
+{
+    return get_ticks_remaining() / THEKERNEL->step_ticker->get_frequency();
+}
+
+// called from the main loop, the output change is run by the step ticker ISR once the blocks queued before it have finished,
+// and the motion channel moves if there are any, if nothing is queued or moving it is done right away
+void Conveyor::queue_output_event(OutputEventQueue::output_fnc_t fnc, void *arg, float value)
+{
+    bool channels= THEKERNEL->step_ticker->has_channel_moves();
+    if(output_events.is_empty() && blocks_finished == blocks_queued && !channels) {
+        fnc(arg, value);
+        return;
+    }
+
+    // wait for room, the events run as the blocks finish
+    while (output_events.is_full() && !THEKERNEL->is_halted()) {
+        THEKERNEL->call_event(ON_IDLE, this);
+    }
+
+    if(THEKERNEL->is_halted()) return;
+
+    output_events.put(get_sequence_point(), fnc, arg, value, channels);
 }
 
 /*
@@ -252,6 +318,19 @@ void Conveyor::flush_queue()
 }
 
 // Debug function
+// show where the block queue lives, used by the mem command
+void Conveyor::dump_memory_map(StreamOutput *stream)
+{
+    if(queue.ring == nullptr || queue.length == 0) {
+        stream->printf("Block queue: not allocated\r\n");
+        return;
+    }
+
+    size_t tick_size= sizeof(Block::tickinfo_t) * Block::n_actuators;
+    stream->printf("Block queue: %u blocks, %u bytes each (%u Block + %u tick info) at %p in %s\r\n",
+        queue.length, sizeof(Block) + tick_size, sizeof(Block), tick_size, queue.ring, memory_region(queue.ring));
+}
+
 void Conveyor::dump_queue()
 {
     for (unsigned int index = queue.tail_i, i = 0; true; index = queue.next(index), i++ ) {
@@ -9,8 +9,10 @@
 
 #include "libs/Module.h"
 #include "BlockQueue.h"
+#include "OutputEventQueue.h"
 
 class Block;
+class StreamOutput;
 
 class Conveyor : public Module
 {
@@ -24,7 +26,9 @@ public:
 
     void wait_for_idle(bool wait_for_motors=true);
     bool is_queue_empty() { return queue.is_empty(); };
-    bool is_queue_full() { return queue.is_full(); };
+    // there is no room in the queue, or in the planner's arcs, for another move, it waits rather than the planner
+    bool is_queue_full();
+    unsigned int get_free_blocks() const { return queue.free_slots(); }
     bool is_idle() const;
 
     // returns next available block writes it to block and returns true
@@ -32,8 +36,20 @@ public:
     void block_finished();
 
     void dump_queue(void);
+    void dump_memory_map(StreamOutput *stream);
     void flush_queue(void);
     float get_current_feedrate() const { return current_feedrate; }
+    // count of the blocks queued and finished (or flushed), used to start motion channel moves in order with the blocks
+    uint32_t get_blocks_queued() const { return blocks_queued; }
+    uint32_t get_blocks_finished() const { return blocks_finished; }
+    // the blocks queued so far, for something that has to happen once they have finished, the last one is not merged with later moves
+    uint32_t get_sequence_point() { merge_barrier= blocks_queued; return blocks_queued; }
+    // the planned step ticks of the blocks queued, less what the running block has done, and that as seconds
+    uint32_t get_ticks_remaining() const;
+    float get_time_remaining() const;
+
+    // have an output change happen between the blocks queued so far and the next one, without waiting for the queue to empty
+    void queue_output_event(OutputEventQueue::output_fnc_t fnc, void *arg, float value);
     void force_queue() { check_queue(true); }
 
     friend class Planner; // for queue
@@ -48,6 +64,13 @@ private:
     uint32_t queue_delay_time_ms;
     size_t queue_size;
     float current_feedrate{0}; // actual nominal feedrate that current block is running at in mm/sec
+    uint32_t blocks_queued{0};
+    volatile uint32_t blocks_finished{0};
+    uint32_t merge_barrier{0}; // blocks_queued when something was tied to the end of the last block, the planner must not extend it
+    // sums of the planned ticks of the blocks queued and finished, kept up to date as the queued blocks are replanned
+    uint32_t ticks_queued{0};
+    volatile uint32_t ticks_finished{0};
+    OutputEventQueue output_events;
 
     struct {
         volatile bool running:1;
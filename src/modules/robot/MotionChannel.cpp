@@ -0,0 +1,54 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MotionChannel.h"
+#include "Kernel.h"
+
+MotionChannel::MotionChannel(const char *name, uint8_t n, const uint8_t motors[])
+{
+    this->name= name;
+    n_motors= n > max_motors ? max_motors : n;
+    for (uint8_t i = 0; i < n_motors; i++) {
+        motor[i]= motors[i];
+    }
+}
+
+bool MotionChannel::has_motor(uint8_t m) const
+{
+    for (uint8_t i = 0; i < n_motors; i++) {
+        if(motor[i] == m) return true;
+    }
+    return false;
+}
+
+// push the prepared head move, blocks until there is room in the queue, returns false if it was dropped by a halt
+bool MotionChannel::queue_head_move()
+{
+    while (is_full() && !THEKERNEL->is_halted()) {
+        THEKERNEL->call_event(ON_IDLE, this);
+    }
+
+    if(THEKERNEL->is_halted()) return false; // the move is dropped like the blocks are
+
+    head_i= next(head_i);
+
+    // turn the motors on if they were not already on
+    THEKERNEL->call_event(ON_ENABLE, (void*)1);
+    return true;
+}
+
+// returns the tail move if there is one and the blocks queued before it have all finished
+const MotionChannel::move_t *MotionChannel::get_next_move(uint32_t finished_blocks) const
+{
+    if(is_empty()) return nullptr;
+
+    const move_t *move= &ring[tail_i];
+    // the counts wrap so compare the difference
+    if((int32_t)(finished_blocks - move->sequence) < 0) return nullptr;
+
+    return move;
+}
@@ -0,0 +1,64 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+#include "Block.h"
+
+/*
+ * A motion channel is a small queue of moves for a few motors that are not part of the coordinated moves in the Conveyor,
+ * each motor runs its own trapezoid so the channel can move while the blocks in the Conveyor are still running.
+ *
+ * A move is started by the StepTicker once all the blocks that were queued in the Conveyor before it have finished,
+ * so the moves still happen in the order of the gcode, they just do not hold up the blocks after them.
+ *
+ * Like the BlockQueue the main loop prepares the head and the StepTicker ISR consumes the tail.
+ */
+class MotionChannel {
+    public:
+        static const uint8_t max_motors= 2;
+        static const uint8_t queue_size= 8;
+
+        MotionChannel(const char *name, uint8_t n, const uint8_t motors[]);
+
+        struct move_t {
+            uint32_t sequence;         // the number of Conveyor blocks that must have finished before this can start
+            uint32_t total_move_ticks; // ticks for the slowest motor
+            std::array<uint32_t, max_motors> steps;
+            std::array<Block::tickinfo_t, max_motors> tick_info; // uses the ramp ticks as each move starts and ends at rest
+            uint8_t direction_bits;
+        };
+
+        const char *get_name() const { return name; }
+        uint8_t get_num_motors() const { return n_motors; }
+        uint8_t get_motor(uint8_t i) const { return motor[i]; }
+        bool has_motor(uint8_t m) const;
+
+        // called from the main loop
+        move_t *head_ref() { return &ring[head_i]; }
+        bool queue_head_move();
+        bool is_empty() const { return head_i == tail_i; }
+        bool is_full() const { return next(head_i) == tail_i; }
+
+        // called from the step ticker ISR
+        const move_t *get_next_move(uint32_t finished_blocks) const;
+        void move_finished() { tail_i= next(tail_i); }
+        void flush() { tail_i= head_i; }
+
+    private:
+        uint8_t next(uint8_t i) const { return (i + 1) % queue_size; }
+
+        const char *name;
+        std::array<move_t, queue_size> ring;
+        volatile uint8_t head_i{0};
+        volatile uint8_t tail_i{0};
+        uint8_t n_motors;
+        uint8_t motor[max_motors];
+};
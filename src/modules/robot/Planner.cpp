@@ -21,6 +21,7 @@ using namespace std;
 #include "checksumm.h"
 #include "Robot.h"
 #include "ConfigValue.h"
+#include "StepTicker.h"
 
 #include <math.h>
 #include <algorithm>
@@ -28,6 +29,8 @@ using namespace std;
 #define junction_deviation_checksum    CHECKSUM("junction_deviation")
 #define z_junction_deviation_checksum  CHECKSUM("z_junction_deviation")
 #define minimum_planner_speed_checksum CHECKSUM("minimum_planner_speed")
+#define trapezoid_horizon_checksum     CHECKSUM("planner_trapezoid_horizon_ms")
+#define merge_angle_checksum           CHECKSUM("planner_merge_angle")
 
 // The Planner does the acceleration math for the queue of Blocks ( movements ).
 // It makes sure the speed stays within the configured constraints ( acceleration, junction_deviation, etc )
@@ -45,12 +48,27 @@ void Planner::config_load()
     this->junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
     this->z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(NAN)->as_number(); // disabled by default
     this->minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    float horizon_ms = THEKERNEL->config->value(trapezoid_horizon_checksum)->by_default(0.0f)->as_number();
+    this->trapezoid_horizon_ticks = horizon_ms > 0 ? horizon_ms * THEKERNEL->step_ticker->get_frequency() / 1000.0F : 0;
+    float merge_angle = THEKERNEL->config->value(merge_angle_checksum)->by_default(0.0f)->as_number(); // disabled by default
+    this->merge_angle_cos = merge_angle > 0 ? cosf(merge_angle * 3.14159265F / 180.0F) : NAN;
 }
 
 
 // Append a block to the queue, compute it's speed factors
-bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float s_value, bool g123)
+// if axis_rates and axis_accelerations are given (mm/s and mm/s/s per actuator) each actuator moves on its own trapezoid
+// and the block starts and ends at rest, used for independent axis G0
+// if arc is given the block goes round it to actuator_pos, its geometry is in actuator mm from the start and distance is the
+// length of the arc, unit_vec is the direction it starts in and exit_unit_vec the one it ends in
+bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float jerk, float s_value, bool g123,
+                            const float *axis_rates, const float *axis_accelerations, const Block::arc_t *arc, const float *exit_unit_vec)
 {
+    Block::arc_t *arc_slot = nullptr;
+    if(arc != nullptr) {
+        arc_slot = get_free_arc();
+        if(arc_slot == nullptr) return false;
+    }
+
     // Create ( recycle ) a new block
     Block* block = THECONVEYOR->queue.head_ref();
 
@@ -93,6 +111,10 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     block->s_value = roundf(s_value*(1<<11)); // 1.11 fixed point
     block->is_g123 = g123;
 
+    // the step ticker holds this block until the motion channel moves queued before it are done
+    block->wait_for_channels = this->wait_for_channels;
+    this->wait_for_channels = false;
+
     // use default JD
     float junction_deviation = this->junction_deviation;
 
@@ -102,6 +124,7 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     }
 
     block->acceleration = acceleration; // save in block
+    block->jerk = jerk;
 
     // Max number of steps, for all axes
     auto mi = std::max_element(block->steps.begin(), block->steps.end());
@@ -109,6 +132,41 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
 
     block->millimeters = distance;
 
+    if(arc != nullptr) {
+        // the geometry in steps counted in each motor's direction, and the steps along the path enough that no motor goes faster
+        // than it anywhere on the arc, so the step ticker can give each one a share of the path's rate
+        float theta = fabsf(atan2f(arc->sin_theta, arc->cos_theta)) * arc->chords;
+        float path_steps_per_mm = 0;
+        for (size_t i = 0; i < 3; i++) {
+            float steps_per_mm = THEROBOT->actuators[i]->get_steps_per_mm();
+            float sign = block->direction_bits[i] ? -steps_per_mm : steps_per_mm;
+            arc_slot->u[i] = arc->u[i] * sign;
+            arc_slot->v[i] = arc->v[i] * sign;
+            arc_slot->w[i] = arc->w[i] * sign;
+            path_steps_per_mm = std::max(path_steps_per_mm, steps_per_mm * (hypotf(arc->u[i], arc->v[i]) * theta + fabsf(arc->w[i]) * arc->chords) / distance);
+        }
+        block->steps_event_count = std::max(block->steps_event_count, (uint32_t)ceilf(distance * path_steps_per_mm));
+
+        arc_slot->cos_theta = arc->cos_theta;
+        arc_slot->sin_theta = arc->sin_theta;
+        arc_slot->chords = arc->chords;
+        if(arc_slot->chords > block->steps_event_count) {
+            // a chord has to be at least a step of the path
+            float c = (float)arc_slot->chords / block->steps_event_count;
+            float t = atan2f(arc->sin_theta, arc->cos_theta) * c;
+            arc_slot->cos_theta = cosf(t);
+            arc_slot->sin_theta = sinf(t);
+            for (size_t i = 0; i < 3; i++) {
+                arc_slot->w[i] *= c;
+            }
+            arc_slot->chords = block->steps_event_count;
+        }
+
+        arc_slot->in_use = true;
+        block->arc = arc_slot;
+        stats.arcs++;
+    }
+
     // Calculate speed in mm/sec for each axis. No divide by zero due to previous checks.
     if( distance > 0.0F ) {
         block->nominal_speed = rate_mm_s;           // (mm/s) Always > 0
@@ -137,8 +195,12 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // and this allows one to stop with little to no decleration in many cases. This is particualrly bad on leadscrew based systems that will skip steps.
     float vmax_junction = minimum_planner_speed; // Set default max junction speed
 
+    if(axis_rates != nullptr) {
+        // independent axis moves always start and end at rest
+        vmax_junction = 0.0F;
+
     // if unit_vec was null then it was not a primary axis move so we skip the junction deviation stuff
-    if (unit_vec != nullptr && !THECONVEYOR->is_queue_empty()) {
+    } else if (unit_vec != nullptr && !THECONVEYOR->is_queue_empty()) {
         Block *prev_block = THECONVEYOR->queue.item_ref(THECONVEYOR->queue.prev(THECONVEYOR->queue.head_i));
         if (junction_deviation > 0.0F 
             && prev_block->primary_axis == block->primary_axis // distance calculation (primary/auxiliary) must match
@@ -176,7 +238,7 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     block->max_entry_speed = vmax_junction;
 
     // Initialize block entry speed. Compute based on deceleration to user-defined minimum_planner_speed.
-    float v_allowable = max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
+    float v_allowable = block->max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
     block->entry_speed = std::min(vmax_junction, v_allowable);
 
     // Initialize planner efficiency flags
@@ -193,25 +255,162 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // Always calculate trapezoid for new block
     block->recalculate_flag = true;
 
+    if(axis_rates != nullptr) {
+        // the trapezoids only depend on this block so they are done once here, the planner will leave them alone
+        float rates[k_max_actuators], accelerations[k_max_actuators];
+        for (size_t i = 0; i < n_motors; i++) {
+            float steps_per_mm = THEROBOT->actuators[i]->get_steps_per_mm();
+            rates[i] = axis_rates[i] * steps_per_mm;
+            accelerations[i] = axis_accelerations[i] * steps_per_mm;
+        }
+        block->entry_speed = 0.0F;
+        block->nominal_length_flag = false;
+        block->calculate_independent_trapezoids(rates, accelerations);
+    }
+
     // Update previous path unit_vector and nominal speed
-    if(unit_vec != nullptr) {
+    merge_error = 0;
+    if(exit_unit_vec != nullptr) {
+        memcpy(previous_unit_vec, exit_unit_vec, sizeof(previous_unit_vec));
+    } else if(unit_vec != nullptr) {
         memcpy(previous_unit_vec, unit_vec, sizeof(previous_unit_vec)); // previous_unit_vec[] = unit_vec[]
     } else {
         memset(previous_unit_vec, 0, sizeof(previous_unit_vec));
     }
 
     // Math-heavy re-computing of the whole queue to take the new
-    this->recalculate();
+    this->recalculate(THECONVEYOR->queue.head_i);
 
     // The block can now be used
     block->ready();
 
     THECONVEYOR->queue_head_block();
 
+    // once it is queued, so the stale block before it is worked out to the speed it enters at
+    this->refresh_trapezoids();
+
+    return true;
+}
+
+// returns a slot in the arc pool for a new arc block, waits for one of the arc blocks queued to finish if they are all in use
+// returns nullptr if halted while waiting
+Block::arc_t *Planner::get_free_arc()
+{
+    for (auto &a : arcs) {
+        if (!a.in_use) return &a;
+    }
+    return nullptr;
+}
+
+uint8_t Planner::free_arcs() const
+{
+    uint8_t n = 0;
+    for (auto &a : arcs) {
+        if (!a.in_use) n++;
+    }
+    return n;
+}
+
+// Extends the last block queued to the new target rather than adding another block, when the move carries straight on from it
+// at the same rate and acceleration, so runs of short nearly collinear moves take fewer blocks. The steps are still counted to the
+// actuator target so the end position is exactly the same as if the move had a block of its own.
+// returns false if the move has to be added with append_block
+bool Planner::merge_block(ActuatorCoordinates &actuator_pos, uint8_t n_motors, float rate_mm_s, float distance, float *unit_vec, float acceleration, float jerk, float s_value, bool g123)
+{
+    Conveyor::Queue_t &queue = THECONVEYOR->queue;
+
+    // nothing is waiting to run, or something has to happen after the last block (an output change, a channel move, M401)
+    if (isnan(merge_angle_cos) || THEKERNEL->is_halted() || queue.isr_tail_i == queue.head_i || THECONVEYOR->merge_barrier == THECONVEYOR->blocks_queued || this->wait_for_channels) return false;
+
+    Block *block = queue.item_ref(queue.prev(queue.head_i));
+    if (block->is_ticking || block->is_independent || block->arc != nullptr || !block->primary_axis || block->is_g123 != g123 || block->s_value != (uint16_t)roundf(s_value*(1<<11))) return false;
+
+    // the axis limits can make the rate and acceleration differ a little with the direction, the lower is used
+    auto close = [](float a, float b) { return fabsf(a - b) <= 0.01F * std::max(a, b); };
+    if (!close(block->nominal_speed, rate_mm_s) || !close(block->acceleration, acceleration) || !close(block->jerk, jerk)) return false;
+
+    float cos_theta = 0;
+    for (size_t i = 0; i < n_motors; i++) {
+        cos_theta += this->previous_unit_vec[i] * unit_vec[i];
+    }
+    if (cos_theta < merge_angle_cos) return false;
+
+    // the moves merged so far stay within merge_error of the block, and its end is this far from the new one, so keeping the sum
+    // within the junction deviation keeps the path as close as the planner takes it to a corner, however many moves are merged
+    float chord[MAX_ROBOT_ACTUATORS];
+    float sos = 0, dot = 0;
+    for (size_t i = 0; i < n_motors; i++) {
+        chord[i] = this->previous_unit_vec[i] * block->millimeters + unit_vec[i] * distance;
+        sos += powf(chord[i], 2);
+    }
+    float chord_length = sqrtf(sos);
+    for (size_t i = 0; i < n_motors; i++) {
+        chord[i] /= chord_length;
+        dot += this->previous_unit_vec[i] * block->millimeters * chord[i];
+    }
+    float error = merge_error + sqrtf(std::max(0.0F, powf(block->millimeters, 2) - powf(dot, 2)));
+    if (error > junction_deviation) return false;
+
+    // only the primary axes, and no motor can turn round within a block
+    int32_t steps[MAX_ROBOT_ACTUATORS];
+    for (size_t i = 0; i < n_motors; i++) {
+        steps[i] = THEROBOT->actuators[i]->steps_to_target(actuator_pos[i]);
+        if (i >= N_PRIMARY_AXIS && (steps[i] != 0 || block->steps[i] != 0)) return false;
+        if (steps[i] != 0 && block->steps[i] != 0 && block->direction_bits[i] != (steps[i] < 0)) return false;
+    }
+
+    // the step ticker skips a locked block, if it has taken it already it is too late. It is only locked until it has a
+    // trapezoid for its new length, if it is left locked while the queue is planned again the step ticker can get to it and
+    // has to stop dead at the end of the block before
+    block->locked = true;
+    if (block->is_ticking) {
+        block->locked = false;
+        return false;
+    }
+
+    for (size_t i = 0; i < n_motors; i++) {
+        if (steps[i] == 0) continue;
+        THEROBOT->actuators[i]->update_last_milestones(actuator_pos[i], steps[i]);
+        block->direction_bits[i] = (steps[i] < 0) ? 1 : 0;
+        block->steps[i] += labs(steps[i]);
+    }
+    auto mi = std::max_element(block->steps.begin(), block->steps.end());
+    block->steps_event_count = *mi;
+
+    // the block now goes straight from where it started to the new target
+    memcpy(this->previous_unit_vec, chord, n_motors*sizeof(float));
+    block->millimeters = chord_length;
+    merge_error = error;
+
+    block->nominal_speed = std::min(block->nominal_speed, rate_mm_s);
+    block->nominal_rate = block->steps_event_count * block->nominal_speed / block->millimeters;
+    block->acceleration = std::min(block->acceleration, acceleration);
+    block->jerk = std::min(block->jerk, jerk);
+
+    // the junction it starts at is the same, but it is longer now so it can be planned again as if it had just been added
+    float entry_speed = std::min(trapezoid_entry_speed(queue.prev(queue.head_i)), block->nominal_speed);
+    float v_allowable = block->max_allowable_speed(-block->acceleration, minimum_planner_speed, block->millimeters);
+    block->max_entry_speed = std::min(block->max_entry_speed, block->nominal_speed);
+    block->entry_speed = std::min(block->max_entry_speed, v_allowable);
+    block->nominal_length_flag = (block->nominal_speed <= v_allowable);
+    block->recalculate_flag = true;
+
+    // until then it goes from the speed the block before ends at to a stop as it did before, this unlocks it, if the step
+    // ticker takes it before it is planned again it runs this
+    uint32_t ticks = block->total_move_ticks;
+    block->calculate_trapezoid(entry_speed, minimum_planner_speed);
+    block->stale_trapezoid = false;
+    THECONVEYOR->ticks_queued += block->total_move_ticks - ticks;
+
+    stats.merges++;
+    this->recalculate(queue.prev(queue.head_i));
+    this->refresh_trapezoids();
+
     return true;
 }
 
-void Planner::recalculate()
+// newest_i is the block just added, at the head and not queued yet, or the last block queued when a move was merged into it
+void Planner::recalculate(unsigned int newest_i)
 {
     Conveyor::Queue_t &queue = THECONVEYOR->queue;
 
@@ -253,16 +452,22 @@ void Planner::recalculate()
 
     float entry_speed = minimum_planner_speed;
 
-    block_index = queue.head_i;
+    block_index = newest_i;
     current     = queue.item_ref(block_index);
 
+    stats.appends++;
+
     if (!queue.is_empty()) {
+        uint32_t walk = 0;
         while ((block_index != queue.tail_i) && current->recalculate_flag) {
             entry_speed = current->reverse_pass(entry_speed);
+            walk++;
 
             block_index = queue.prev(block_index);
             current     = queue.item_ref(block_index);
         }
+        stats.reverse += walk;
+        if (walk > stats.max_walk) stats.max_walk = walk;
 
         /*
          * Step 2:
@@ -275,7 +480,7 @@ void Planner::recalculate()
 
         float exit_speed = current->max_exit_speed();
 
-        while (block_index != queue.head_i) {
+        while (block_index != newest_i) {
             previous    = current;
             block_index = queue.next(block_index);
             current     = queue.item_ref(block_index);
@@ -283,8 +488,11 @@ void Planner::recalculate()
             // we pass the exit speed of the previous block
             // so this block can decide if it's accel or decel limited and update its fields as appropriate
             exit_speed = current->forward_pass(exit_speed);
+            stats.forward++;
 
-            previous->calculate_trapezoid(previous->entry_speed, current->entry_speed);
+            // with a horizon the trapezoid is left until the block is about to run, the speeds may well change again before then
+            if (trapezoid_horizon_ticks == 0) calculate_queued_trapezoid(queue.prev(block_index), current->entry_speed);
+            else previous->stale_trapezoid = true;
         }
     }
 
@@ -293,18 +501,85 @@ void Planner::recalculate()
      * work out trapezoid for final (and newest) block
      */
 
-    // now current points to the head item
+    // now current points to the newest item
     // which has not had calculate_trapezoid run yet
-    current->calculate_trapezoid(current->entry_speed, minimum_planner_speed);
+    if (newest_i == queue.head_i) current->calculate_trapezoid(trapezoid_entry_speed(newest_i), minimum_planner_speed);
+    else calculate_queued_trapezoid(newest_i, minimum_planner_speed);
 }
 
 
-// Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
-// acceleration within the allotted distance.
-float Planner::max_allowable_speed(float acceleration, float target_velocity, float distance)
+// the speed the trapezoid of the block at i starts at, which is the speed the trapezoid of the block before it ends at if
+// that is lower, as it is while that one is stale, so the speed never steps from one block to the next
+float Planner::trapezoid_entry_speed(unsigned int i) const
 {
-    // Was acceleration*60*60*distance, in case this breaks, but here we prefer to use seconds instead of minutes
-    return(sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance));
+    Conveyor::Queue_t &queue = THECONVEYOR->queue;
+    float entry_speed = queue.item_ref(i)->entry_speed;
+    if (i == queue.tail_i) return entry_speed;
+    return std::min(entry_speed, queue.item_ref(queue.prev(i))->exit_speed);
+}
+
+// the speed the block at i is planned to end at, the entry speed of the block after it
+float Planner::planned_exit_speed(unsigned int i) const
+{
+    Conveyor::Queue_t &queue = THECONVEYOR->queue;
+    unsigned int n = queue.next(i);
+    return (n == queue.head_i) ? minimum_planner_speed : queue.item_ref(n)->entry_speed;
+}
+
+// the block is already queued so its change in ticks goes to the queue's total
+void Planner::calculate_queued_trapezoid(unsigned int i, float exit_speed)
+{
+    Block *block = THECONVEYOR->queue.item_ref(i);
+    if (!block->is_ticking && !block->is_independent) stats.trapezoids++;
+
+    uint32_t ticks = block->total_move_ticks;
+    block->calculate_trapezoid(trapezoid_entry_speed(i), exit_speed);
+    THECONVEYOR->ticks_queued += block->total_move_ticks - ticks;
 }
 
+/*
+ * When streaming short segments faster than the queue can stop from, every block added raises the entry speed of every
+ * block queued, so all their trapezoids change each time and working them out is most of the planner's time, more so
+ * with a long queue. Only the trapezoids of the blocks about to run matter though, so with planner_trapezoid_horizon_ms
+ * set they are only worked out for the blocks that start within that time, the rest are marked stale and done as they
+ * come within it. The speeds a block runs at are the same either way as long as the main loop gets back here before the
+ * blocks within the horizon have run.
+ *
+ * If it does not a stale block runs with the older trapezoid it has, so the trapezoids must always join up: a block's
+ * trapezoid starts no faster than the one before it ends, and when that end is raised the block after is worked out
+ * again too. Past the horizon it keeps the exit it has if it can still slow down to it, otherwise it is worked out in
+ * full and the one after it is looked at in turn.
+ */
+void Planner::refresh_trapezoids()
+{
+    if (trapezoid_horizon_ticks == 0) return;
 
+    Conveyor::Queue_t &queue = THECONVEYOR->queue;
+
+    // from the block running now to the last one queued
+    uint32_t ticks = 0;
+    bool raised = false; // the exit of the block before this one was raised so its trapezoid no longer joins up
+    for (unsigned int i = queue.isr_tail_i; i != queue.head_i; i = queue.next(i)) {
+        Block *block = queue.item_ref(i);
+        // the running block can finish its steps before its last tick, so the horizon is counted from the next one
+        if (block->is_ticking) continue;
+
+        float exit_speed = block->exit_speed;
+        if (ticks < trapezoid_horizon_ticks) {
+            if (block->stale_trapezoid || raised) {
+                calculate_queued_trapezoid(i, planned_exit_speed(i));
+                block->stale_trapezoid = false;
+            }
+        } else {
+            if (!raised) break;
+            if (trapezoid_entry_speed(i) <= block->max_allowable_speed(-block->acceleration, exit_speed, block->millimeters)) {
+                calculate_queued_trapezoid(i, exit_speed);
+                break;
+            }
+            calculate_queued_trapezoid(i, planned_exit_speed(i));
+            block->stale_trapezoid = false;
+        }
+        raised = block->exit_speed != exit_speed;
+        ticks += block->total_move_ticks;
+    }
+}
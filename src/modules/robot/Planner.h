@@ -9,24 +9,59 @@
 #define PLANNER_H
 
 #include "ActuatorCoordinates.h"
-class Block;
+#include "Block.h"
 
 class Planner
 {
 public:
     Planner();
-    float max_allowable_speed( float acceleration, float target_velocity, float distance);
+
+    // how much work recalculate() has done, the motion simulator reports it with -p
+    struct stats_t {
+        uint32_t appends;    // blocks planned
+        uint32_t reverse;    // blocks walked back over
+        uint32_t forward;    // blocks walked forward over
+        uint32_t trapezoids; // trapezoids calculated for blocks already queued
+        uint32_t max_walk;   // most blocks walked back over for one append
+        uint32_t merges;     // moves merged into the block before them rather than added
+        uint32_t arcs;       // arc blocks planned
+    };
+    const stats_t& get_stats() const { return stats; }
+
+    // fewer arcs are free than an arc can take, moves wait for the arc blocks queued to run as they do for a full queue
+    bool arcs_low() const { return free_arcs() < k_arcs_per_move; }
+
+    // works out the trapezoids left out of date for the blocks that start within the horizon, called as blocks are added and on idle
+    void refresh_trapezoids();
 
     friend class Robot; // for acceleration, junction deviation, minimum_planner_speed
 
 private:
-    bool append_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float accleration, float s_value, bool g123);
-    void recalculate();
+    bool append_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float accleration, float jerk, float s_value, bool g123,
+                      const float *axis_rates= nullptr, const float *axis_accelerations= nullptr, const Block::arc_t *arc= nullptr, const float *exit_unit_vec= nullptr);
+    bool merge_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float acceleration, float jerk, float s_value, bool g123);
+    void recalculate(unsigned int newest_i);
+    void calculate_queued_trapezoid(unsigned int i, float exit_speed);
+    float trapezoid_entry_speed(unsigned int i) const;
+    float planned_exit_speed(unsigned int i) const;
+    Block::arc_t *get_free_arc();
+    uint8_t free_arcs() const;
     void config_load();
     float previous_unit_vec[MAX_ROBOT_ACTUATORS];
     float junction_deviation;    // Setting
     float z_junction_deviation;  // Setting
     float minimum_planner_speed; // Setting
+    uint32_t trapezoid_horizon_ticks; // Setting, 0 works out every trapezoid as soon as its speeds change
+    float merge_angle_cos;       // Setting, cos of planner_merge_angle, NAN if moves are not merged
+    float merge_error{0};        // how far the moves merged into the last block can be from it
+    bool wait_for_channels{false}; // set by M401 so the next block waits for the motion channel moves before it
+    stats_t stats{};
+
+    // the arc blocks in the queue each have one, an arc is segmented if there are not enough free for all its blocks,
+    // which only happens if it is split into more than k_arcs_per_move (a circle on a cartesian machine is 5)
+    static const uint8_t k_max_arcs= 32;
+    static const uint8_t k_arcs_per_move= 8;
+    Block::arc_t arcs[k_max_arcs]{};
 };
 
 
@@ -25,6 +25,7 @@
 #include "arm_solutions/CoreXZSolution.h"
 #include "arm_solutions/MorganSCARASolution.h"
 #include "StepTicker.h"
+#include "MotionChannel.h"
 #include "checksumm.h"
 #include "utils.h"
 #include "ConfigValue.h"
@@ -34,11 +35,13 @@
 #include "GcodeDispatch.h"
 #include "ActuatorCoordinates.h"
 #include "EndstopsPublicAccess.h"
+#include "FixedFormat.h"
 
 #include "mbed.h" // for us_ticker_read()
 #include "mri.h"
 
 #include <fastmath.h>
+#include <ctype.h>
 #include <string>
 #include <algorithm>
 
@@ -49,10 +52,14 @@
 #define  mm_per_arc_segment_checksum         CHECKSUM("mm_per_arc_segment")
 #define  mm_max_arc_error_checksum           CHECKSUM("mm_max_arc_error")
 #define  arc_correction_checksum             CHECKSUM("arc_correction")
+#define  arc_blocks_checksum                 CHECKSUM("arc_blocks")
 #define  x_axis_max_speed_checksum           CHECKSUM("x_axis_max_speed")
 #define  y_axis_max_speed_checksum           CHECKSUM("y_axis_max_speed")
 #define  z_axis_max_speed_checksum           CHECKSUM("z_axis_max_speed")
 #define  segment_z_moves_checksum            CHECKSUM("segment_z_moves")
+#define  g0_independent_axes_checksum        CHECKSUM("g0_independent_axes")
+#define  rotation_channel_axes_checksum      CHECKSUM("rotation_channel_axes")
+#define  feeder_channel_axes_checksum        CHECKSUM("feeder_channel_axes")
 #define  save_g92_checksum                   CHECKSUM("save_g92")
 #define  save_g54_checksum                   CHECKSUM("save_g54")
 #define  set_g92_checksum                    CHECKSUM("set_g92")
@@ -81,6 +88,7 @@
 #define  max_speed_checksum                  CHECKSUM("max_speed")
 #define  acceleration_checksum               CHECKSUM("acceleration")
 #define  z_acceleration_checksum             CHECKSUM("z_acceleration")
+#define  max_jerk_checksum                   CHECKSUM("max_jerk")
 
 #define  alpha_checksum                      CHECKSUM("alpha")
 #define  beta_checksum                       CHECKSUM("beta")
@@ -139,7 +147,8 @@ void Robot::on_module_loaded()
     CHECKSUM(X "_en_pin"),          \
     CHECKSUM(X "_steps_per_mm"),    \
     CHECKSUM(X "_max_rate"),        \
-    CHECKSUM(X "_acceleration")     \
+    CHECKSUM(X "_acceleration"),    \
+    CHECKSUM(X "_max_jerk")         \
 }
 
 void Robot::load_config()
@@ -183,6 +192,7 @@ void Robot::load_config()
     this->mm_per_arc_segment  = THEKERNEL->config->value(mm_per_arc_segment_checksum  )->by_default(    0.0f)->as_number();
     this->mm_max_arc_error    = THEKERNEL->config->value(mm_max_arc_error_checksum    )->by_default(   0.01f)->as_number();
     this->arc_correction      = THEKERNEL->config->value(arc_correction_checksum      )->by_default(    5   )->as_number();
+    this->arc_blocks          = THEKERNEL->config->value(arc_blocks_checksum          )->by_default(false)->as_bool();
 
     // in mm/sec but specified in config as mm/min
     this->max_speeds[X_AXIS]  = THEKERNEL->config->value(x_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
@@ -191,6 +201,8 @@ void Robot::load_config()
     this->max_speed           = THEKERNEL->config->value(max_speed_checksum           )->by_default(  -60.0F)->as_number() / 60.0F;
 
     this->segment_z_moves     = THEKERNEL->config->value(segment_z_moves_checksum     )->by_default(true)->as_bool();
+    this->independent_g0      = THEKERNEL->config->value(g0_independent_axes_checksum )->by_default(false)->as_bool();
+    this->independent_move    = false;
     this->save_g92            = THEKERNEL->config->value(save_g92_checksum            )->by_default(false)->as_bool();
     this->save_g54            = THEKERNEL->config->value(save_g54_checksum            )->by_default(THEKERNEL->is_grbl_mode())->as_bool();
     string g92                = THEKERNEL->config->value(set_g92_checksum             )->by_default("")->as_string();
@@ -228,6 +240,8 @@ void Robot::load_config()
 
     // default acceleration setting, can be overriden with newer per axis settings
     this->default_acceleration= THEKERNEL->config->value(acceleration_checksum)->by_default(100.0F )->as_number(); // Acceleration is in mm/s^2
+    // default jerk limit for S-curve ramps, 0 uses plain trapezoids unless set per axis
+    this->default_max_jerk= THEKERNEL->config->value(max_jerk_checksum)->by_default(0.0F )->as_number(); // Jerk is in mm/s^3
 
     // make each motor
     for (size_t a = 0; a < MAX_ROBOT_ACTUATORS; a++) {
@@ -257,10 +271,21 @@ void Robot::load_config()
         actuators[a]->change_steps_per_mm(THEKERNEL->config->value(motor_checksums[a][3])->by_default(a == 2 ? 2560.0F : 80.0F)->as_number());
         actuators[a]->set_max_rate(THEKERNEL->config->value(motor_checksums[a][4])->by_default(30000.0F)->as_number()/60.0F); // it is in mm/min and converted to mm/sec
         actuators[a]->set_acceleration(THEKERNEL->config->value(motor_checksums[a][5])->by_default(NAN)->as_number()); // mm/secs²
+        actuators[a]->set_max_jerk(THEKERNEL->config->value(motor_checksums[a][6])->by_default(NAN)->as_number()); // mm/secs³
     }
 
     check_max_actuator_speeds(); // check the configs are sane
 
+    // the nozzle rotation axes can have their own motion channel so they turn while the other axes are moving
+    if(motion_channels.empty()) {
+        MotionChannel *mc= make_motion_channel("rotation", THEKERNEL->config->value(rotation_channel_axes_checksum)->by_default("")->as_string());
+        if(mc != nullptr) motion_channels.push_back(mc);
+
+        // and the feeder/peeler axes so a peel can run during the travel to the next part
+        feeder_channel= make_motion_channel("feeder", THEKERNEL->config->value(feeder_channel_axes_checksum)->by_default("")->as_string());
+        if(feeder_channel != nullptr) motion_channels.push_back(feeder_channel);
+    }
+
     // if we have not specified a z acceleration see if the legacy config was set
     if(isnan(actuators[Z_AXIS]->get_acceleration())) {
         float acc= THEKERNEL->config->value(z_acceleration_checksum)->by_default(NAN)->as_number(); // disabled by default
@@ -309,6 +334,86 @@ uint8_t Robot::register_motor(StepperMotor *motor)
     return n_motors++;
 }
 
+// make a motion channel for the given axis letters (A, B, ...) and register it with the step ticker
+// returns nullptr if there are no axes or they are not valid
+MotionChannel *Robot::make_motion_channel(const char *name, const std::string& axes)
+{
+    uint8_t motors[MotionChannel::max_motors];
+    uint8_t n= 0;
+    for (char c : axes) {
+        if(c == ' ' || c == ',') continue;
+        int a= A_AXIS + (toupper(c) - 'A');
+        if(a < A_AXIS || a >= n_motors || actuators[a]->is_extruder() || n >= MotionChannel::max_motors) {
+            THEKERNEL->streams->printf("ERROR: %s channel axis %c is not valid, channel disabled\n", name, c);
+            return nullptr;
+        }
+        for (auto mc : motion_channels) {
+            if(mc->has_motor(a)) {
+                THEKERNEL->streams->printf("ERROR: %s channel axis %c is already in the %s channel, channel disabled\n", name, c, mc->get_name());
+                return nullptr;
+            }
+        }
+        motors[n++]= a;
+    }
+    if(n == 0) return nullptr;
+
+    MotionChannel *mc= new MotionChannel(name, n, motors);
+    if(!THEKERNEL->step_ticker->register_channel(mc)) {
+        THEKERNEL->streams->printf("ERROR: too many motion channels, %s channel disabled\n", name);
+        delete mc;
+        return nullptr;
+    }
+    return mc;
+}
+
+// queue a move for the channel's axes to the given target, each axis moves at its own max rate and acceleration
+// if rate_limited the requested rate also limits each axis (when nothing else is moving)
+// if after_blocks the move waits for the blocks already queued, otherwise it starts as soon as the channel is free
+// returns true if there was something to move
+bool Robot::append_channel_move(MotionChannel *channel, const float target[], float rate_mm_s, bool rate_limited, bool after_blocks)
+{
+    if(THEKERNEL->is_halted()) return false;
+
+    MotionChannel::move_t *move= channel->head_ref();
+    bool moved= false;
+    int32_t steps_moved[MotionChannel::max_motors];
+    move->total_move_ticks= 0;
+    move->direction_bits= 0;
+    for (uint8_t i = 0; i < channel->get_num_motors(); i++) {
+        uint8_t a= channel->get_motor(i);
+        StepperMotor *sm= actuators[a];
+        int32_t steps= sm->steps_to_target(target[a]);
+        steps_moved[i]= steps;
+        move->steps[i]= labs(steps);
+        if(steps == 0) continue;
+
+        if(steps < 0) move->direction_bits |= (1 << i);
+        moved= true;
+
+        float rate= sm->get_max_rate();
+        if(rate_limited && rate > rate_mm_s) rate= rate_mm_s;
+        float acceleration= sm->get_acceleration();
+        if(isnan(acceleration)) acceleration= default_acceleration;
+
+        float steps_per_mm= sm->get_steps_per_mm();
+        uint32_t ticks= Block::independent_trapezoid(move->steps[i], rate * steps_per_mm, acceleration * steps_per_mm, move->tick_info[i]);
+        if(ticks > move->total_move_ticks) move->total_move_ticks= ticks;
+    }
+
+    if(!moved) return false;
+
+    // starts once the blocks already queued have finished, or right away
+    move->sequence= after_blocks ? THECONVEYOR->get_sequence_point() : THECONVEYOR->get_blocks_finished();
+    if(!channel->queue_head_move()) return false;
+
+    // the actuators are only where the move takes them once it is queued, a halt while it waited for room dropped it
+    for (uint8_t i = 0; i < channel->get_num_motors(); i++) {
+        uint8_t a= channel->get_motor(i);
+        if(steps_moved[i] != 0) actuators[a]->update_last_milestones(target[a], steps_moved[i]);
+    }
+    return true;
+}
+
 void  Robot::push_state()
 {
     bool am = this->absolute_mode;
@@ -357,6 +462,15 @@ void Robot::get_current_machine_position(float *pos) const
     arm_solution->actuator_to_cartesian(current_position, pos);
 }
 
+// appends " X:x Y:y Z:z" after the label
+static void append_xyz(std::string& res, const char *label, float x, float y, float z)
+{
+    res.append(label).append(" X:");
+    append_fixed(res, x, 4).append(" Y:");
+    append_fixed(res, y, 4).append(" Z:");
+    append_fixed(res, z, 4);
+}
+
 void Robot::print_position(uint8_t subcode, std::string& res, bool ignore_extruders) const
 {
     // M114.1 is a new way to do this (similar to how GRBL does it).
@@ -364,20 +478,18 @@ void Robot::print_position(uint8_t subcode, std::string& res, bool ignore_extrud
     // this does require a FK to get a machine position from the actuator position
     // and then invert all the transforms to get a workspace position from machine position
     // M114 just does it the old way uses machine_position and does inverse transforms to get the requested position
-    uint32_t n = 0;
-    char buf[64];
     if(subcode == 0) { // M114 print WCS
         wcs_t pos= mcs2wcs(machine_position);
-        n = snprintf(buf, sizeof(buf), "C: X:%1.4f Y:%1.4f Z:%1.4f", from_millimeters(std::get<X_AXIS>(pos)), from_millimeters(std::get<Y_AXIS>(pos)), from_millimeters(std::get<Z_AXIS>(pos)));
+        append_xyz(res, "C:", from_millimeters(std::get<X_AXIS>(pos)), from_millimeters(std::get<Y_AXIS>(pos)), from_millimeters(std::get<Z_AXIS>(pos)));
 
     } else if(subcode == 4) {
         // M114.4 print last milestone
-        n = snprintf(buf, sizeof(buf), "MP: X:%1.4f Y:%1.4f Z:%1.4f", machine_position[X_AXIS], machine_position[Y_AXIS], machine_position[Z_AXIS]);
+        append_xyz(res, "MP:", machine_position[X_AXIS], machine_position[Y_AXIS], machine_position[Z_AXIS]);
 
     } else if(subcode == 5) {
         // M114.5 print last machine position (which should be the same as M114.1 if axis are not moving and no level compensation)
         // will differ from LMS by the compensation at the current position otherwise
-        n = snprintf(buf, sizeof(buf), "CMP: X:%1.4f Y:%1.4f Z:%1.4f", compensated_machine_position[X_AXIS], compensated_machine_position[Y_AXIS], compensated_machine_position[Z_AXIS]);
+        append_xyz(res, "CMP:", compensated_machine_position[X_AXIS], compensated_machine_position[Y_AXIS], compensated_machine_position[Z_AXIS]);
 
     } else {
         // get real time positions
@@ -389,10 +501,10 @@ void Robot::print_position(uint8_t subcode, std::string& res, bool ignore_extrud
 
         if(subcode == 1) { // M114.1 print realtime WCS
             wcs_t pos= mcs2wcs(mpos);
-            n = snprintf(buf, sizeof(buf), "WCS: X:%1.4f Y:%1.4f Z:%1.4f", from_millimeters(std::get<X_AXIS>(pos)), from_millimeters(std::get<Y_AXIS>(pos)), from_millimeters(std::get<Z_AXIS>(pos)));
+            append_xyz(res, "WCS:", from_millimeters(std::get<X_AXIS>(pos)), from_millimeters(std::get<Y_AXIS>(pos)), from_millimeters(std::get<Z_AXIS>(pos)));
 
         } else if(subcode == 2) { // M114.2 print realtime Machine coordinate system
-            n = snprintf(buf, sizeof(buf), "MCS: X:%1.4f Y:%1.4f Z:%1.4f", mpos[X_AXIS], mpos[Y_AXIS], mpos[Z_AXIS]);
+            append_xyz(res, "MCS:", mpos[X_AXIS], mpos[Y_AXIS], mpos[Z_AXIS]);
 
         } else if(subcode == 3) { // M114.3 print realtime actuator position
             // get real time current actuator position in mm
@@ -401,31 +513,30 @@ void Robot::print_position(uint8_t subcode, std::string& res, bool ignore_extrud
                 actuators[Y_AXIS]->get_current_position(),
                 actuators[Z_AXIS]->get_current_position()
             };
-            n = snprintf(buf, sizeof(buf), "APOS: X:%1.4f Y:%1.4f Z:%1.4f", current_position[X_AXIS], current_position[Y_AXIS], current_position[Z_AXIS]);
+            append_xyz(res, "APOS:", current_position[X_AXIS], current_position[Y_AXIS], current_position[Z_AXIS]);
         }
     }
 
-    if(n > sizeof(buf)) n= sizeof(buf);
-    res.append(buf, n);
-
     #if MAX_ROBOT_ACTUATORS > 3
     // deal with the ABC axis
     for (int i = A_AXIS; i < n_motors; ++i) {
-        n= 0;
         if(ignore_extruders && actuators[i]->is_extruder()) continue; // don't show an extruder as that will be E
+        float v;
         if(subcode == 0) { // M114 print last milestone which is the machine position with g92 offset applied for ABC
-            n= snprintf(buf, sizeof(buf), " %c:%1.4f", 'A'+i-A_AXIS, machine_position[i] + g92_offset[i]);
+            v= machine_position[i] + g92_offset[i];
         }else if(subcode == 4) { // M114.4 print last milestone in machine coordinates
-            n= snprintf(buf, sizeof(buf), " %c:%1.4f", 'A'+i-A_AXIS, machine_position[i]);
+            v= machine_position[i];
         }else if(subcode == 1) { // M114.1 prints real time position which is the machine position with g92 offset applied for ABC
             // current position 
-            n= snprintf(buf, sizeof(buf), " %c:%1.4f", 'A'+i-A_AXIS,  actuators[i]->get_current_position() + g92_offset[i]);
+            v= actuators[i]->get_current_position() + g92_offset[i];
         }else if(subcode == 2 || subcode == 3) { // M114.1/M114.2/M114.3 print actuator position which is the same as machine position for ABC
             // current actuator position
-            n= snprintf(buf, sizeof(buf), " %c:%1.4f", 'A'+i-A_AXIS, actuators[i]->get_current_position());
+            v= actuators[i]->get_current_position();
+        }else{
+            continue;
         }
-        if(n > sizeof(buf)) n= sizeof(buf);
-        if(n > 0) res.append(buf, n);
+        res.append(1, ' ').append(1, 'A'+i-A_AXIS).append(1, ':');
+        append_fixed(res, v, 4);
     }
     #endif
 }
@@ -854,6 +965,57 @@ void Robot::on_gcode_received(void *argument)
                 THEKERNEL->conveyor->wait_for_idle();
                 break;
 
+            case 401: // the next move waits until the motion channel moves queued before it are done, without stopping the queue
+                if(!motion_channels.empty()) THEKERNEL->planner->wait_for_channels= true;
+                break;
+
+            case 402: { // report the planned time in seconds for the moves queued to finish, and how many blocks that is
+                std::string res("Time:");
+                append_fixed(res, THECONVEYOR->get_time_remaining(), 4).append(" Blocks:");
+                append_fixed(res, THECONVEYOR->get_blocks_queued() - THECONVEYOR->get_blocks_finished(), 0);
+                gcode->txt_after_ok.append(res);
+            }
+            break;
+
+            case 430: { // M430 Cnnn Dnnn relative feeder move that starts now and runs alongside the other moves, M430 reports if it is done
+                if(feeder_channel == nullptr) {
+                    gcode->stream->printf("Error: no feeder channel, set feeder_channel_axes\n");
+                    break;
+                }
+
+                float target[n_motors];
+                memcpy(target, machine_position, n_motors*sizeof(float));
+                bool has_axis= false;
+                for (uint8_t i = 0; i < feeder_channel->get_num_motors(); i++) {
+                    uint8_t a= feeder_channel->get_motor(i);
+                    char letter= 'A'+a-A_AXIS;
+                    if(gcode->has_letter(letter)) {
+                        target[a] += gcode->get_value(letter);
+                        has_axis= true;
+                    }
+                }
+
+                if(!has_axis) {
+                    gcode->stream->printf("Feeder:%s\n", feeder_channel->is_empty() ? "idle" : "busy");
+                    break;
+                }
+
+                // F limits the rate of each axis otherwise they move at their max rate
+                bool rate_limited= gcode->has_letter('F');
+                float rate_mm_s= rate_limited ? gcode->get_value('F') / seconds_per_minute : 0;
+                if(rate_limited && rate_mm_s <= 0) break;
+
+                // while halted the move is dropped, so the positions stay where the feeder is, as for the other moves
+                if(THEKERNEL->is_halted()) break;
+                append_channel_move(feeder_channel, target, rate_mm_s, rate_limited, false);
+                if(THEKERNEL->is_halted()) break;
+                for (uint8_t i = 0; i < feeder_channel->get_num_motors(); i++) {
+                    uint8_t a= feeder_channel->get_motor(i);
+                    compensated_machine_position[a]= machine_position[a]= target[a];
+                }
+            }
+            break;
+
             case 500: // M500 saves some volatile settings to config override file
             case 503: { // M503 just prints the settings
                 gcode->stream->printf(";Steps per unit:\nM92 ");
@@ -1087,7 +1249,10 @@ void Robot::process_move(Gcode *gcode, enum MOTION_MODE_T motion_mode)
         case NONE: break;
 
         case SEEK:
+            // each axis can move on its own at its max rate and acceleration, the path is not a straight line
+            this->independent_move= this->independent_g0 && straight_for_actuators();
             moved= this->append_line(gcode, target, this->seek_rate / seconds_per_minute, delta_e );
+            this->independent_move= false;
             break;
 
         case LINEAR:
@@ -1110,6 +1275,41 @@ void Robot::process_move(Gcode *gcode, enum MOTION_MODE_T motion_mode)
     }
 }
 
+// a move from a binary frame, the positions are absolute work coordinates in mm as for G90 G0/G1 and only the axes in
+// mask move, it goes to append_milestone without a Gcode so there is no segmentation or extruder handling
+bool Robot::append_frame_move(uint8_t mask, const float pos[], float rate_mm_min, bool linear)
+{
+    float target[n_motors];
+    memcpy(target, machine_position, n_motors*sizeof(float));
+
+    const float offset[3]= {
+        std::get<X_AXIS>(wcs_offsets[current_wcs]) - g92_offset[X_AXIS] + std::get<X_AXIS>(tool_offset),
+        std::get<Y_AXIS>(wcs_offsets[current_wcs]) - g92_offset[Y_AXIS] + std::get<Y_AXIS>(tool_offset),
+        std::get<Z_AXIS>(wcs_offsets[current_wcs]) - g92_offset[Z_AXIS] + std::get<Z_AXIS>(tool_offset)
+    };
+    for (int i = 0; i < n_motors; ++i) {
+        if(!(mask & (1 << i))) continue;
+        target[i]= i <= Z_AXIS ? pos[i] + offset[i] : pos[i] - g92_offset[i];
+    }
+
+    if(!isnan(rate_mm_min)) {
+        if(linear) this->feed_rate= rate_mm_min;
+        else this->seek_rate= rate_mm_min;
+    }
+    float rate_mm_s= (linear ? this->feed_rate : this->seek_rate) / seconds_per_minute;
+    if(rate_mm_s <= 0.0F) return false;
+
+    this->independent_move= !linear && this->independent_g0 && straight_for_actuators();
+    bool moved= this->append_milestone(target, rate_mm_s);
+    this->independent_move= false;
+
+    memcpy(arc_milestone, target, sizeof(arc_milestone));
+    if(moved) {
+        memcpy(machine_position, target, n_motors*sizeof(float));
+    }
+    return moved;
+}
+
 // reset the machine position for all axis. Used for homing.
 // after homing we supply the cartesian coordinates that the head is at when homed,
 // however for Z this is the compensated machine position (if enabled)
@@ -1253,6 +1453,29 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
     }
 
 
+    // axes with their own motion channel are queued there and take no part in the coordinated move,
+    // when nothing else moves the requested rate applies to them as well
+    bool channel_moved= false;
+    if(!motion_channels.empty()) {
+        bool others_moving= false;
+        for (size_t i = 0; i < n_motors; i++) {
+            if(transformed_target[i] == compensated_machine_position[i]) continue;
+            bool in_channel= false;
+            for (auto mc : motion_channels) {
+                if(mc->has_motor(i)) in_channel= true;
+            }
+            if(!in_channel) others_moving= true;
+        }
+
+        for (auto mc : motion_channels) {
+            if(append_channel_move(mc, transformed_target, rate_mm_s, !others_moving)) channel_moved= true;
+            for (uint8_t i = 0; i < mc->get_num_motors(); i++) {
+                uint8_t a= mc->get_motor(i);
+                compensated_machine_position[a]= transformed_target[a];
+            }
+        }
+    }
+
     bool primary_move= false;
     bool secondary_move = false;
     float sos= 0; // sum of squares for just primary axis (XYZ usually)
@@ -1271,8 +1494,8 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
         }
     }
 
-    // nothing moved
-    if(!(primary_move||secondary_move)) return false;
+    // nothing moved, or only the motion channel axes
+    if(!(primary_move||secondary_move)) return channel_moved;
 
 
     // NIST RS274NGC Interpreter - Version 3, Section 2.1.2.5 applies feedrates as follows:
@@ -1317,7 +1540,7 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
                     if (deltas[i] != 0 && actuators[i]->is_extruder()) {
                         // one or more of the moved secondary axes are extruders - bail anyway to prevent blobs
     // as the last milestone won't be updated we do not actually lose any moves as they will be accounted for in the next move
-                        return false;
+                        return channel_moved;
                     }
                 }
             #endif
@@ -1333,7 +1556,7 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
         }
         else {
             // as the last milestone won't be updated we do not actually lose any moves as they will be accounted for in the next move
-            return false;
+            return channel_moved;
         }
     }
 
@@ -1404,7 +1627,7 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
     }
     if(auxilliary_move) {
         distance= sqrtf(sos); // distance in mm of the auxilliary move
-        if(distance < 0.00001F) return false;
+        if(distance < 0.00001F) return channel_moved;
     }
 #endif
 
@@ -1419,8 +1642,20 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
       unit_vec[i] = deltas[i] / spacial_distance;
     }
 
-    // use default acceleration to start with
+    // use default acceleration and jerk to start with
     float acceleration = default_acceleration;
+    float jerk = default_max_jerk;
+
+    // for independent axis moves each actuator gets its own rate and acceleration, the requested rate is a limit for each of them
+    float axis_rates[n_motors], axis_accelerations[n_motors];
+    if(independent_move) {
+        for (size_t actuator = 0; actuator < n_motors; actuator++) {
+            float ma = actuators[actuator]->get_acceleration(); // in mm/sec²
+            axis_accelerations[actuator] = isnan(ma) ? default_acceleration : ma;
+            axis_rates[actuator] = actuators[actuator]->get_max_rate();
+            if(!override_feedrate && axis_rates[actuator] > rate_mm_s) axis_rates[actuator] = rate_mm_s;
+        }
+    }
 
     // check per-actuator speed and acceleration limits
     for (size_t actuator = 0; actuator < n_motors; actuator++) {
@@ -1455,6 +1690,13 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
                 override_acceleration = false;
             }
         }
+
+        // adjust jerk to lowest found, a zero jerk means no limit so the first axis limit found replaces it
+        float mj = actuators[actuator]->get_max_jerk(); // in mm/sec³
+        if(!isnan(mj) && mj > 0) {
+            mj *= limit_factor;
+            if(jerk <= 0 || jerk > mj) jerk = mj;
+        }
     }
 
     // if we are in feed hold wait here until it is released, this means that even segemnted lines will pause
@@ -1464,10 +1706,19 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
         if(THEKERNEL->is_halted()) return false;
     }
 
+    // a move that carries straight on from the last one can be merged into its block, only XYZ moves on an arm where a
+    // straight line is straight for the actuators too, see planner_merge_angle
+    if(!independent_move && !secondary_move && straight_for_actuators() &&
+       THEKERNEL->planner->merge_block(actuator_pos, n_motors, rate_mm_s, distance, unit_vec, acceleration, jerk, s_value, is_g123)) {
+        memcpy(this->compensated_machine_position, transformed_target, n_motors*sizeof(float));
+        return true;
+    }
+
     // Append the block to the planner
     // NOTE that distance here should be either the distance travelled by the XYZ axis, or the E mm travel if a solo E move
     // NOTE this call will bock until there is room in the block queue, on_idle will continue to be called
-    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, unit_vec, acceleration, s_value, is_g123)) {
+    if(THEKERNEL->planner->append_block( actuator_pos, n_motors, rate_mm_s, distance, unit_vec, acceleration, jerk, s_value, is_g123,
+                                         independent_move ? axis_rates : nullptr, independent_move ? axis_accelerations : nullptr)) {
         // this is the new compensated machine position
         memcpy(this->compensated_machine_position, transformed_target, n_motors*sizeof(float));
         return true;
@@ -1541,7 +1792,7 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
     // The latter is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
     uint16_t segments;
 
-    if(this->disable_segmentation || (!segment_z_moves && !gcode->has_letter('X') && !gcode->has_letter('Y'))) {
+    if(this->disable_segmentation || this->independent_move || (!segment_z_moves && !gcode->has_letter('X') && !gcode->has_letter('Y'))) {
         segments= 1;
 
     } else if(this->delta_segments_per_second > 1.0F) {
@@ -1572,6 +1823,15 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
         for (int i = 0; i < n_motors; i++)
             segment_delta[i] = (target[i] - machine_position[i]) / segments;
 
+        // the motion channel axes are not segmented, they move to the target with the first segment as one channel move
+        for (auto mc : motion_channels) {
+            for (uint8_t i = 0; i < mc->get_num_motors(); i++) {
+                uint8_t a= mc->get_motor(i);
+                segment_delta[a]= 0;
+                segment_end[a]= target[a];
+            }
+        }
+
         // segment 0 is already done - it's the end point of the previous move so we start at segment 1
         // We always add another point after this loop so we stop at segments-1, ie i < segments
         for (int i = 1; i < segments; i++) {
@@ -1664,6 +1924,10 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
     uint16_t segments = floorf(millimeters_of_travel / arc_segment);
     bool moved= false;
 
+    if(this->arc_blocks && segments > 1 && append_arc_blocks(target, offset, radius, angular_travel, linear_travel, arc_segment, rate_mm_s, moved)) {
+        return moved;
+    }
+
     if(segments > 1) {
         float theta_per_segment = angular_travel / segments;
         float linear_per_segment = linear_travel / segments;
@@ -1745,6 +2009,183 @@ bool Robot::append_arc(Gcode * gcode, const float target[], const float offset[]
     return moved;
 }
 
+// Plan an arc as a few arc blocks that the step ticker follows the circle for, rather than as a block per segment. A motor can not
+// turn round within a block so the arc is split where any of the XYZ actuators does, and where any of XYZ does so the soft endstops
+// only need checking at the ends of the blocks. The arc still goes in segments of arc_segment, they are the step ticker's chords.
+// returns false, having queued nothing, if it has to be segmented, otherwise moved is set if any blocks were queued
+bool Robot::append_arc_blocks(const float target[], const float offset[], float radius, float angular_travel, float linear_travel, float arc_segment, float rate_mm_s, bool &moved)
+{
+    // the actuators have to be a linear function of XYZ and nothing else can move
+    if(!straight_for_actuators()) return false;
+    for (auto mc : motion_channels) {
+        for (uint8_t i = 0; i < mc->get_num_motors(); i++) {
+            if(mc->get_motor(i) <= Z_AXIS) return false;
+        }
+    }
+    for (size_t i = E_AXIS; i < n_motors; i++) {
+        if(target[i] != machine_position[i]) return false;
+    }
+
+    auto to_actuator= [this](const float *cartesian, ActuatorCoordinates &a) {
+        if(disable_arm_solution) {
+            for (size_t i = X_AXIS; i <= Z_AXIS; i++) a[i]= cartesian[i];
+        } else {
+            arm_solution->cartesian_to_actuator(cartesian, a);
+        }
+    };
+
+    // how far each actuator moves in mm for a mm along each of the plane axes
+    ActuatorCoordinates a0, a1;
+    float axis_move[3][3];
+    to_actuator(compensated_machine_position, a0);
+    const uint8_t axes[3]= {plane_axis_0, plane_axis_1, plane_axis_2};
+    for (int j = 0; j < 3; j++) {
+        float p[3]= {compensated_machine_position[X_AXIS], compensated_machine_position[Y_AXIS], compensated_machine_position[Z_AXIS]};
+        p[axes[j]] += 1.0F;
+        to_actuator(p, a1);
+        for (int m = 0; m < 3; m++) axis_move[j][m]= a1[m] - a0[m];
+    }
+
+    // the position at angle a from the start is the centre + r0*cos(a) + perpendicular(r0)*sin(a), and linear/a per radian along the
+    // linear axis. An axis or actuator turns round where b*cos(a) - c*sin(a) + d is 0, with c and b its parts of r0 and perpendicular(r0)
+    float r0[2]= {-offset[plane_axis_0], -offset[plane_axis_1]};
+    float linear_per_radian= linear_travel / fabsf(angular_travel);
+    float split[16];
+    int n= 0;
+    split[n++]= 0;
+    auto add_turns= [&](float c, float b, float d) {
+        float rho= hypotf(c, b);
+        if(rho < 0.0001F || fabsf(d) >= rho) return;
+        float phi= atan2f(c, b), turn= acosf(-d / rho);
+        for (int k = -2; k <= 2; k++) {
+            for (float a : {-phi + turn + k * 2 * PI, -phi - turn + k * 2 * PI}) {
+                float t= a / angular_travel;
+                if(t > 0.0001F && t < 0.9999F && n < 15) split[n++]= t;
+            }
+        }
+    };
+    for (int j = 0; j < 2; j++) {
+        add_turns(r0[j], j == 0 ? -r0[1] : r0[0], 0);
+    }
+    for (int m = 0; m < 3; m++) {
+        float c= r0[0] * axis_move[0][m] + r0[1] * axis_move[1][m];
+        float b= -r0[1] * axis_move[0][m] + r0[0] * axis_move[1][m];
+        add_turns(c, b, axis_move[2][m] * linear_travel / angular_travel);
+    }
+    for (int i = 2; i < n; i++) {
+        for (int j = i; j > 1 && split[j] < split[j - 1]; j--) std::swap(split[j], split[j - 1]);
+    }
+    // an axis and an actuator can turn round at the same place
+    int blocks= 0;
+    for (int i = 1; i < n; i++) {
+        if(split[i] - split[blocks] >= 0.0001F) split[++blocks]= split[i];
+    }
+    split[++blocks]= 1;
+
+    // the ends of the blocks, the soft endstop errors are left to the segments
+    float center[2]= {arc_milestone[plane_axis_0] + offset[plane_axis_0], arc_milestone[plane_axis_1] + offset[plane_axis_1]};
+    float ends[16][3];
+    for (int i = 0; i < blocks; i++) {
+        float *e= ends[i];
+        if(i == blocks - 1) {
+            memcpy(e, target, sizeof(ends[0]));
+        } else {
+            float a= split[i + 1] * angular_travel;
+            e[plane_axis_0]= center[0] + r0[0] * cosf(a) - r0[1] * sinf(a);
+            e[plane_axis_1]= center[1] + r0[0] * sinf(a) + r0[1] * cosf(a);
+            e[plane_axis_2]= arc_milestone[plane_axis_2] + linear_travel * split[i + 1];
+        }
+        if(soft_endstop_enabled) {
+            for (int j = 0; j <= Z_AXIS; ++j) {
+                if(is_homed(j) && ((!isnan(soft_endstop_min[j]) && e[j] < soft_endstop_min[j]) || (!isnan(soft_endstop_max[j]) && e[j] > soft_endstop_max[j]))) return false;
+            }
+        }
+    }
+
+    // a move is only dispatched with k_arcs_per_move arcs free, an arc split into more blocks than are free is segmented
+    // rather than waiting here which would hold up the main loop. Nothing else takes them so there are still enough
+    if(THEKERNEL->planner->free_arcs() < blocks) return false;
+
+    // the curvature radius, which for a helix is more than the radius
+    float curve_radius= radius + powf(linear_per_radian, 2) / radius;
+    float mm_per_radian= hypotf(radius, linear_per_radian);
+
+    for (int i = 0; i < blocks; i++) {
+        // the rest of the blocks are not queued, as for the segments
+        if(THEKERNEL->is_halted()) return true;
+
+        float angle= (split[i + 1] - split[i]) * angular_travel;
+        float a= split[i] * angular_travel;
+
+        // the radius vector at the start of this block and perpendicular to it in the direction of travel
+        float r[2]= {r0[0] * cosf(a) - r0[1] * sinf(a), r0[0] * sinf(a) + r0[1] * cosf(a)};
+        float linear= linear_travel * angle / angular_travel;
+        float distance= hypotf(angle * radius, linear);
+        uint32_t chords= std::max(1.0F, floorf(distance / arc_segment));
+
+        Block::arc_t arc;
+        arc.cos_theta= cosf(angle / chords);
+        arc.sin_theta= sinf(angle / chords);
+        arc.chords= chords;
+        for (int m = 0; m < 3; m++) {
+            arc.u[m]= r[0] * axis_move[0][m] + r[1] * axis_move[1][m];
+            arc.v[m]= -r[1] * axis_move[0][m] + r[0] * axis_move[1][m];
+            arc.w[m]= axis_move[2][m] * linear / chords;
+        }
+
+        // the directions it starts and ends in
+        float sign= angular_travel < 0 ? -1 : 1;
+        float b= a + angle;
+        float unit_vec[MAX_ROBOT_ACTUATORS]{}, exit_unit_vec[MAX_ROBOT_ACTUATORS]{};
+        unit_vec[plane_axis_0]= -r[1] * sign / mm_per_radian;
+        unit_vec[plane_axis_1]= r[0] * sign / mm_per_radian;
+        unit_vec[plane_axis_2]= linear_per_radian / mm_per_radian;
+        exit_unit_vec[plane_axis_0]= -(r0[0] * sinf(b) + r0[1] * cosf(b)) * sign / mm_per_radian;
+        exit_unit_vec[plane_axis_1]= (r0[0] * cosf(b) - r0[1] * sinf(b)) * sign / mm_per_radian;
+        exit_unit_vec[plane_axis_2]= unit_vec[plane_axis_2];
+
+        // the XYZ and actuator limits for the fastest each goes on the arc, and the acceleration towards the centre
+        float rate= rate_mm_s;
+        for (size_t j = X_AXIS; j <= Z_AXIS; j++) {
+            float f= (j == plane_axis_2 ? fabsf(linear_per_radian) : radius) / mm_per_radian;
+            if(max_speeds[j] > 0 && rate * f > max_speeds[j]) rate= max_speeds[j] / f;
+        }
+        if(this->max_speed > 0 && rate > this->max_speed) rate= this->max_speed;
+
+        float acceleration= default_acceleration;
+        float jerk= default_max_jerk;
+        for (size_t m = 0; m <= Z_AXIS; m++) {
+            float d= (hypotf(arc.u[m], arc.v[m]) + fabsf(axis_move[2][m] * linear_per_radian)) / mm_per_radian;
+            if(d < 0.000001F || !actuators[m]->is_selected()) continue;
+            float limit_factor= 1 / d;
+            rate= std::min(rate, limit_factor * actuators[m]->get_max_rate());
+            float ma= actuators[m]->get_acceleration();
+            if(!isnan(ma)) acceleration= std::min(acceleration, ma * limit_factor);
+            float mj= actuators[m]->get_max_jerk();
+            if(!isnan(mj) && mj > 0 && (jerk <= 0 || jerk > mj * limit_factor)) jerk= mj * limit_factor;
+        }
+        rate= std::min(rate, sqrtf(acceleration * curve_radius));
+
+        while(THEKERNEL->get_feed_hold()) {
+            THEKERNEL->call_event(ON_IDLE, this);
+            if(THEKERNEL->is_halted()) return true;
+        }
+
+        ActuatorCoordinates actuator_pos;
+        to_actuator(ends[i], actuator_pos);
+        for (size_t m = E_AXIS; m < n_motors; m++) {
+            actuator_pos[m]= actuators[m]->get_last_milestone();
+        }
+
+        if(THEKERNEL->planner->append_block(actuator_pos, n_motors, rate, distance, unit_vec, acceleration, jerk, s_value, is_g123, nullptr, nullptr, &arc, exit_unit_vec)) {
+            memcpy(compensated_machine_position, ends[i], sizeof(ends[0]));
+            moved= true;
+        }
+    }
+
+    return true;
+}
+
 // Do the math for an arc and add it to the queue
 bool Robot::compute_arc(Gcode * gcode, const float offset[], const float target[], enum MOTION_MODE_T motion_mode)
 {
@@ -1799,6 +2240,13 @@ float Robot::get_feed_rate() const
     return THEKERNEL->gcode_dispatch->get_modal_command() == 0 ? seek_rate : feed_rate;
 }
 
+// true if the actuators move in straight lines when XYZ do and nothing transforms the target, so a move can be planned
+// in actuator space without segmenting it (merged, independent axis and arc blocks)
+bool Robot::straight_for_actuators() const
+{
+    return !compensationTransform && (disable_arm_solution || arm_solution->is_linear());
+}
+
 bool Robot::is_homed(uint8_t i) const
 {
     if(i >= 3) return false; // safety
@@ -22,6 +22,7 @@ using std::string;
 class Gcode;
 class BaseSolution;
 class StepperMotor;
+class MotionChannel;
 
 // 9 WCS offsets
 #define MAX_WCS 9UL
@@ -59,6 +60,7 @@ class Robot : public Module {
         std::tuple<float, float, float, uint8_t> get_last_probe_position() const { return last_probe_position; }
         void set_last_probe_position(std::tuple<float, float, float, uint8_t> p) { last_probe_position = p; }
         bool delta_move(const float delta[], float rate_mm_s, uint8_t naxis);
+        bool append_frame_move(uint8_t mask, const float pos[], float rate_mm_min, bool linear);
         uint8_t register_motor(StepperMotor*);
         uint8_t get_number_registered_motors() const {return n_motors; }
 
@@ -86,11 +88,14 @@ class Robot : public Module {
             bool disable_segmentation:1;                      // set to disable segmentation
             bool disable_arm_solution:1;                      // set to disable the arm solution
             bool segment_z_moves:1;
+            bool independent_g0:1;                            // G0 moves each axis at its own max rate and acceleration
+            bool independent_move:1;                          // set while the current move is an independent axis G0
             bool save_g92:1;                                  // save g92 on M500 if set
             bool save_g54:1;                                  // save WCS on M500 if set
             bool is_g123:1;
             bool soft_endstop_enabled:1;
             bool soft_endstop_halt:1;
+            bool arc_blocks:1;                                // G2/G3 are planned as arc blocks rather than as a block per segment
             uint8_t plane_axis_0:2;                           // Current plane ( XY, XZ, YZ )
             uint8_t plane_axis_1:2;
             uint8_t plane_axis_2:2;
@@ -109,14 +114,18 @@ class Robot : public Module {
         bool append_milestone(const float target[], float rate_mm_s);
         bool append_line( Gcode* gcode, const float target[], float rate_mm_s, float delta_e);
         bool append_arc( Gcode* gcode, const float target[], const float offset[], float radius, bool is_clockwise );
+        bool append_arc_blocks(const float target[], const float offset[], float radius, float angular_travel, float linear_travel, float arc_segment, float rate_mm_s, bool &moved);
         bool compute_arc(Gcode* gcode, const float offset[], const float target[], enum MOTION_MODE_T motion_mode);
         void process_move(Gcode *gcode, enum MOTION_MODE_T);
         bool is_homed(uint8_t i) const;
+        bool straight_for_actuators() const;
 
         float theta(float x, float y);
         void select_plane(uint8_t axis_0, uint8_t axis_1, uint8_t axis_2);
         void clearToolOffset();
         int get_active_extruder() const;
+        MotionChannel *make_motion_channel(const char *name, const std::string& axes);
+        bool append_channel_move(MotionChannel *channel, const float target[], float rate_mm_s, bool rate_limited, bool after_blocks= true);
 
         std::array<wcs_t, MAX_WCS> wcs_offsets; // these are persistent once saved with M500
         uint8_t current_wcs{0}; // 0 means G54 is enabled this is persistent once saved with M500
@@ -138,6 +147,7 @@ class Robot : public Module {
         float delta_segments_per_second;                     // Setting : Used to split lines into segments for delta based on speed
         float seconds_per_minute;                            // for realtime speed change
         float default_acceleration;                          // the defualt accleration if not set for each axis
+        float default_max_jerk;                              // the default jerk limit for S-curve ramps, 0 is a plain trapezoid
         float s_value;                                       // modal S value
         float arc_milestone[3];                              // used as start of an arc command
 
@@ -152,6 +162,9 @@ class Robot : public Module {
 
         float soft_endstop_min[3], soft_endstop_max[3];
 
+        std::vector<MotionChannel*> motion_channels;         // axes that move on their own, not coordinated with the others
+        MotionChannel *feeder_channel{nullptr};              // the peeler axes, M430 moves them right away
+
         uint8_t n_motors;                                    //count of the motors/axis registered
 
         // Used by Planner
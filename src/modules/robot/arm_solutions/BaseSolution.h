@@ -17,6 +17,8 @@ class BaseSolution {
         typedef std::map<char, float> arm_options_t;
         virtual bool set_optional(const arm_options_t& options) { return false; };
         virtual bool get_optional(arm_options_t& options, bool force_all= false) const { return false; };
+        // true if a straight line in cartesian space is a straight line for the actuators too, so moves can be merged
+        virtual bool is_linear() const { return false; };
 };
 
 #endif
@@ -12,6 +12,7 @@ class CoreXZSolution : public BaseSolution {
         CoreXZSolution(Config*);
         void cartesian_to_actuator(const float[], ActuatorCoordinates & ) const override;
         void actuator_to_cartesian(const ActuatorCoordinates &, float[] ) const override;
+        bool is_linear() const override { return true; }
 
     private:
         float x_reduction;
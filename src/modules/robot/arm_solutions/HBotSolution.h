@@ -13,4 +13,5 @@ class HBotSolution : public BaseSolution {
         HBotSolution(Config*){};
         void cartesian_to_actuator(const float[], ActuatorCoordinates &) const override;
         void actuator_to_cartesian(const ActuatorCoordinates &, float[]) const override;
+        bool is_linear() const override { return true; }
 };
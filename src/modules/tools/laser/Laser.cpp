@@ -123,13 +123,14 @@ void Laser::on_console_line_received( void *argument )
     if(THEKERNEL->is_halted()) return; // if in halted state ignore any commands
 
     SerialMessage *msgp = static_cast<SerialMessage *>(argument);
-    string possible_command = msgp->message;
 
-    // ignore anything that is not lowercase or a letter
-    if(possible_command.empty() || !islower(possible_command[0]) || !isalpha(possible_command[0])) {
+    // ignore anything that is not lowercase or a letter, checked before the line is copied
+    if(msgp->message.empty() || !islower(msgp->message[0]) || !isalpha(msgp->message[0])) {
         return;
     }
 
+    string possible_command = msgp->message;
+
     string cmd = shift_parameter(possible_command);
 
     // Act depending on command
@@ -206,6 +207,9 @@ void Laser::on_gcode_received(void *argument)
 // calculates the current speed ratio from the currently executing block
 float Laser::current_speed_ratio(const Block *block) const
 {
+    // an arc block's motors change speed with the direction, the path's rate is the one on the trapezoid
+    if(block->arc != nullptr) return StepTicker::getInstance()->get_path_rate() / block->nominal_rate;
+
     // find the primary moving actuator (the one with the most steps)
     size_t pm = 0;
     uint32_t max_steps = 0;
@@ -219,7 +223,7 @@ float Laser::current_speed_ratio(const Block *block) const
 
     // figure out the ratio of its speed, from 0 to 1 based on where it is on the trapezoid,
     // this is based on the fraction it is of the requested rate (nominal rate)
-    float ratio = block->get_trapezoid_rate(pm) / block->nominal_rate;
+    float ratio = StepTicker::getInstance()->get_trapezoid_rate(pm) / block->nominal_rate;
 
     return ratio;
 }
@@ -12,6 +12,9 @@
 #include "Switch.h"
 #include "libs/Pin.h"
 #include "modules/robot/Conveyor.h"
+#include "Robot.h"
+#include "StepperMotor.h"
+#include "StepTicker.h"
 #include "PublicDataRequest.h"
 #include "SwitchPublicAccess.h"
 #include "SlowTicker.h"
@@ -246,53 +249,105 @@ void Switch::on_gcode_received(void *argument)
         return;
     }
 
-    // we need to sync this with the queue, so we need to wait for queue to empty, however due to certain slicers
-    // issuing redundant swicth on calls regularly we need to optimize by making sure the value is actually changing
-    // hence we need to do the wait for queue in each case rather than just once at the start
+    // we need to sync this with the queue, the change is queued so it happens when the moves before it have finished
+    // and the moves after it start, the queue does not have to empty so the look ahead is kept
+    // with an axis position eg M822 X120 P2 it happens during the moves after it instead, see queue_position_trigger()
     if(match_input_on_gcode(gcode)) {
+        float v;
         if (this->output_type == SIGMADELTA) {
             // SIGMADELTA output pin turn on (or off if S0)
             if(gcode->has_letter('S')) {
-                int v = roundf(gcode->get_value('S') * sigmadelta_pin->max_pwm() / 255.0F); // scale by max_pwm so input of 255 and max_pwm of 128 would set value to 128
-                if(v != this->sigmadelta_pin->get_pwm()){ // optimize... ignore if already set to the same pwm
-                    // drain queue
-                    THEKERNEL->conveyor->wait_for_idle();
-                    this->sigmadelta_pin->pwm(v);
-                    this->switch_state= (v > 0);
-                }
+                v = roundf(gcode->get_value('S') * sigmadelta_pin->max_pwm() / 255.0F); // scale by max_pwm so input of 255 and max_pwm of 128 would set value to 128
             } else {
-                // drain queue
-                THEKERNEL->conveyor->wait_for_idle();
-                this->sigmadelta_pin->pwm(this->switch_value);
-                this->switch_state= (this->switch_value > 0);
+                v = this->switch_value;
             }
 
         } else if (this->output_type == HWPWM) {
-            // drain queue
-            THEKERNEL->conveyor->wait_for_idle();
             // PWM output pin set duty cycle 0 - 100
             if(gcode->has_letter('S')) {
-                float v = gcode->get_value('S');
+                v = gcode->get_value('S');
                 if(v > 100) v= 100;
                 else if(v < 0) v= 0;
-                this->pwm_write(v/100.0F);
-                this->switch_state= (v != 0);
+                v /= 100.0F;
             } else {
-                this->pwm_write(this->switch_value);
-                this->switch_state= (this->switch_value != 0);
+                v = this->switch_value;
             }
 
         } else if (this->output_type == DIGITAL) {
-            // drain queue
-            THEKERNEL->conveyor->wait_for_idle();
             // logic pin turn on
-            this->digital_pin->set(true);
-            this->switch_state = true;
+            v = 1;
+
+        } else {
+            return;
+        }
+
+        if(!queue_position_trigger(gcode, v, -1)) {
+            THEKERNEL->conveyor->queue_output_event(&Switch::output_event, this, v);
         }
 
     } else if(match_input_off_gcode(gcode)) {
-        // drain queue
-        THEKERNEL->conveyor->wait_for_idle();
+        // a pulse turns it back on to the default value
+        if(!queue_position_trigger(gcode, -1, this->output_type == DIGITAL ? 1 : this->switch_value)) {
+            THEKERNEL->conveyor->queue_output_event(&Switch::output_event, this, -1);
+        }
+    }
+}
+
+// if the on or off command has an axis position, eg M822 X120 P2, the output is changed by the step ticker when that actuator reaches
+// the position (in actuator mm like M114.3) during the moves queued after it, P is an optional pulse in ms after which it is changed back
+// returns false if there is no axis position so the change is queued between the moves as usual
+bool Switch::queue_position_trigger(const Gcode *gcode, float value, float pulse_value)
+{
+    static const char axis_letters[]= "XYZABC";
+
+    int axis= -1;
+    for (int i = 0; axis_letters[i] != 0; i++) {
+        if(gcode->has_letter(axis_letters[i])) {
+            axis= i;
+            break;
+        }
+    }
+    if(axis < 0) return false;
+
+    if(axis >= THEROBOT->get_number_registered_motors()) {
+        gcode->stream->printf("Error: no %c actuator for the position trigger\n", axis_letters[axis]);
+        return true;
+    }
+
+    StepperMotor *actuator= THEROBOT->actuators[axis];
+    int32_t target= lroundf(gcode->get_value(axis_letters[axis]) * actuator->get_steps_per_mm());
+
+    uint32_t pulse_ticks= 0;
+    if(gcode->has_letter('P')) {
+        pulse_ticks= floorf(gcode->get_value('P') * StepTicker::getInstance()->get_frequency() / 1000.0F);
+        if(pulse_ticks == 0) pulse_ticks= 1;
+    }
+
+    // wait for a free trigger, the ones in use are freed as they fire or the moves they are for finish
+    StepTicker *st= StepTicker::getInstance();
+    while(!st->add_position_trigger(actuator->get_motor_id(), target, pulse_ticks, &Switch::output_event, this, value, pulse_value)) {
+        if(!st->position_trigger_can_free()) {
+            gcode->stream->printf("Error: all the position triggers are in use for the next moves\n");
+            return true;
+        }
+        if(THEKERNEL->is_halted()) return true;
+        THEKERNEL->call_event(ON_IDLE, this);
+    }
+    return true;
+}
+
+// called by the conveyor from the step ticker ISR when the moves before the change have finished, or right away if there are none,
+// or by the step ticker for a position trigger
+void Switch::output_event(void *sw, float value)
+{
+    static_cast<Switch *>(sw)->set_output(value);
+}
+
+// set the output for an M code, a value < 0 turns it off
+// otherwise it is the pwm value for SIGMADELTA, the duty cycle 0 - 1 for HWPWM and on for DIGITAL
+void Switch::set_output(float v)
+{
+    if(v < 0) {
         this->switch_state = false;
         if (this->output_type == SIGMADELTA) {
             // SIGMADELTA output pin
@@ -305,6 +360,20 @@ void Switch::on_gcode_received(void *argument)
             // logic pin turn off
             this->digital_pin->set(false);
         }
+        return;
+    }
+
+    if (this->output_type == SIGMADELTA) {
+        this->sigmadelta_pin->pwm(v);
+        this->switch_state= (v > 0);
+
+    } else if (this->output_type == HWPWM) {
+        this->pwm_write(v);
+        this->switch_state= (v != 0);
+
+    } else if (this->output_type == DIGITAL) {
+        this->digital_pin->set(true);
+        this->switch_state = true;
     }
 }
 
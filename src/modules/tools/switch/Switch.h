@@ -43,6 +43,9 @@ class Switch : public Module {
         bool match_input_on_gcode(const Gcode* gcode) const;
         bool match_input_off_gcode(const Gcode* gcode) const;
         void pwm_write(float v);
+        void set_output(float v);
+        bool queue_position_trigger(const Gcode *gcode, float value, float pulse_value);
+        static void output_event(void *sw, float value);
 
         Pin       input_pin;
         float     switch_value;
@@ -60,11 +63,11 @@ class Switch : public Module {
         uint16_t  input_off_command_code;
         char      input_on_command_letter;
         char      input_off_command_letter;
+        volatile bool switch_state;  // not in the bitfield as it is set from the step ticker ISR by queued output changes
         struct {
             uint8_t   subcode:4;
             bool      switch_changed:1;
             bool      input_pin_state:1;
-            bool      switch_state:1;
             bool      ignore_on_halt:1;
             uint8_t   failsafe:1;
             bool      inverting:1;
@@ -246,15 +246,15 @@ void Player::on_console_line_received( void *argument )
 {
     if(THEKERNEL->is_halted()) return; // if in halted state ignore any commands
 
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
+    SerialMessage& new_message = *static_cast<SerialMessage *>(argument);
 
-    string possible_command = new_message.message;
-
-    // ignore anything that is not lowercase or a letter
-    if(possible_command.empty() || !islower(possible_command[0]) || !isalpha(possible_command[0])) {
+    // ignore anything that is not lowercase or a letter, checked before the line is copied
+    if(new_message.message.empty() || !islower(new_message.message[0]) || !isalpha(new_message.message[0])) {
         return;
     }
 
+    string possible_command = new_message.message;
+
     string cmd = shift_parameter(possible_command);
 
     //new_message.stream->printf("Received %s\r\n", possible_command.c_str());
@@ -415,6 +415,11 @@ void Player::on_main_loop(void *argument)
             return;
         }
 
+        // the next line waits for room in the queue here rather than in the planner, so the main loop keeps going
+        if(THEKERNEL->conveyor->is_queue_full()) {
+            return;
+        }
+
         char buf[130]; // lines upto 128 characters are allowed, anything longer is discarded
         bool discard = false;
 
@@ -436,7 +441,7 @@ void Player::on_main_loop(void *argument)
                 message.message = buf;
                 message.stream = this->current_stream == nullptr ? &(StreamOutput::NullStream) : this->current_stream;
 
-                // waits for the queue to have enough room
+                // a line that makes several blocks can still wait in the planner for the later ones
                 THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
                 played_cnt += len;
                 return; // we feed one line per main loop
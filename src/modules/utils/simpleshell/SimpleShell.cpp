@@ -27,6 +27,7 @@
 #include "GcodeDispatch.h"
 #include "BaseSolution.h"
 #include "StepperMotor.h"
+#include "StepTicker.h"
 #include "Configurator.h"
 #include "Block.h"
 
@@ -203,14 +204,15 @@ bool SimpleShell::parse_command(const char *cmd, string args, StreamOutput *stre
 // When a new line is received, check if it is a command, and if it is, act upon it
 void SimpleShell::on_console_line_received( void *argument )
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
-    string possible_command = new_message.message;
+    SerialMessage& new_message = *static_cast<SerialMessage *>(argument);
 
-    // ignore anything that is not lowercase or a $ as it is not a command
-    if(possible_command.size() == 0 || (!islower(possible_command[0]) && possible_command[0] != '$')) {
+    // ignore anything that is not lowercase or a $ as it is not a command, checked before the line is copied
+    if(new_message.message.size() == 0 || (!islower(new_message.message[0]) && new_message.message[0] != '$')) {
         return;
     }
 
+    string possible_command = new_message.message;
+
     // it is a grbl compatible command
     if(possible_command[0] == '$' && possible_command.size() >= 2) {
         switch(possible_command[1]) {
@@ -589,13 +591,23 @@ void SimpleShell::mem_command( string parameters, StreamOutput *stream)
     uint32_t f = heapWalk(stream, verbose);
     stream->printf("Total Free RAM: %lu bytes\r\n", m + f);
 
-    stream->printf("Free AHB0: %lu, AHB1: %lu\r\n", AHB0.free(), AHB1.free());
+    stream->printf("Free AHB0: %lu, AHB1: %lu, CCM: %lu\r\n", AHB0.free(), AHB1.free(), CCM.free());
     if (verbose) {
         AHB0.debug(stream);
         AHB1.debug(stream);
+        CCM.debug(stream);
     }
 
     stream->printf("Block size: %u bytes, Tickinfo size: %u bytes\n", sizeof(Block), sizeof(Block::tickinfo_t) * Block::n_actuators);
+
+    // memory map of the hot motion data
+    extern uint8_t __CCM_block_start;
+    extern uint8_t __CCM_dyn_start;
+    stream->printf("CCM static: %u bytes\r\n", (unsigned int)(&__CCM_dyn_start - &__CCM_block_start));
+    stream->printf("StepTicker: %u bytes at %p in %s\r\n", sizeof(StepTicker), THEKERNEL->step_ticker, memory_region(THEKERNEL->step_ticker));
+    THECONVEYOR->dump_memory_map(stream);
+    uint32_t sp = __get_MSP();
+    stream->printf("Stack: %p in %s\r\n", (void *)sp, memory_region((void *)sp));
 }
 
 // get network config
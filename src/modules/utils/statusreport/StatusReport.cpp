@@ -0,0 +1,141 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StatusReport.h"
+#include "libs/Kernel.h"
+#include "Config.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+#include "Gcode.h"
+#include "Robot.h"
+#include "StepTicker.h"
+#include "Conveyor.h"
+#include "StepperMotor.h"
+#include "BaseSolution.h"
+#include "StreamOutputPool.h"
+#include "ActuatorCoordinates.h"
+#include "FixedFormat.h"
+
+#include "mbed.h" // for us_ticker_read()
+
+#include <string.h>
+
+#define auto_report_interval_checksum CHECKSUM("auto_report_interval")
+
+StatusReport::StatusReport()
+{
+    interval_us= 0;
+    last_report= 0;
+    last_state= nullptr;
+    last_finished= 0;
+    pending= false;
+}
+
+void StatusReport::on_module_loaded()
+{
+    float interval= THEKERNEL->config->value( auto_report_interval_checksum )->by_default(0)->as_number();
+    interval_us= interval > 0 ? interval * 1000000 : 0;
+
+    this->register_for_event(ON_IDLE);
+    this->register_for_event(ON_GCODE_RECEIVED);
+}
+
+void StatusReport::on_gcode_received(void *argument)
+{
+    Gcode *gcode = static_cast<Gcode*>(argument);
+    if (gcode->has_m && gcode->m == 154) {
+        if(gcode->has_letter('S')) {
+            float interval= gcode->get_value('S');
+            interval_us= interval > 0 ? interval * 1000000 : 0;
+            last_state= nullptr; // report the current state straight away
+        } else {
+            gcode->stream->printf("auto report interval %1.3f s\n", interval_us / 1000000.0F);
+        }
+    }
+}
+
+void StatusReport::on_idle(void *argument)
+{
+    if(interval_us == 0) return;
+
+    // the ISR takes the positions on its next tick, a later idle sends them
+    if(pending) {
+        if(THEKERNEL->step_ticker->is_snapshot_ready()) {
+            pending= false;
+            send_report();
+        }
+        return;
+    }
+
+    bool running;
+    const char *state= THEKERNEL->get_state(running);
+    uint32_t now= us_ticker_read();
+    // blocks that finished since the last report with nothing left to run means the queue drained, even when the
+    // moves started and finished between two idle passes so the state was never seen as Run
+    uint32_t finished= THECONVEYOR->get_blocks_finished();
+    bool drained= finished != last_finished && THECONVEYOR->is_idle();
+    if(state != last_state || drained || (running && now - last_report >= interval_us)) {
+        last_state= state;
+        last_finished= finished;
+        last_report= now;
+        THEKERNEL->step_ticker->request_snapshot();
+        pending= true;
+    }
+}
+
+// the same as the ? report but from one snapshot of the step positions
+void StatusReport::send_report()
+{
+    Robot *robot= THEKERNEL->robot;
+    const StepTicker::position_snapshot_t& snap= THEKERNEL->step_ticker->get_snapshot();
+    size_t n_motors= robot->get_number_registered_motors();
+
+    float actuator_pos[k_max_actuators];
+    for (size_t i = 0; i < n_motors; ++i) {
+        actuator_pos[i]= snap.steps[i] / robot->actuators[i]->get_steps_per_mm();
+    }
+
+    float mpos[3];
+    ActuatorCoordinates ac{actuator_pos[X_AXIS], actuator_pos[Y_AXIS], actuator_pos[Z_AXIS]};
+    robot->arm_solution->actuator_to_cartesian(ac, mpos);
+    // the actuator position includes the compensation transform so take it out
+    if(robot->compensationTransform) robot->compensationTransform(mpos, true);
+
+    // the state, 3 labels and up to 11 numbers
+    char buf[40 + (k_max_actuators + 4) * (fixed_format_max + 1)];
+    size_t n= 0;
+    buf[n++]= '<';
+    size_t l= strlen(last_state);
+    memcpy(buf + n, last_state, l);
+    n += l;
+
+    memcpy(buf + n, "|MPos:", 6);
+    n += 6;
+    for (size_t i = 0; i < n_motors; ++i) {
+        if(i > 0) buf[n++]= ',';
+        n += format_fixed(buf + n, robot->from_millimeters(i < 3 ? mpos[i] : actuator_pos[i]), 4);
+    }
+
+    Robot::wcs_t wpos= robot->mcs2wcs(mpos);
+    memcpy(buf + n, "|WPos:", 6);
+    n += 6;
+    n += format_fixed(buf + n, robot->from_millimeters(std::get<X_AXIS>(wpos)), 4);
+    buf[n++]= ',';
+    n += format_fixed(buf + n, robot->from_millimeters(std::get<Y_AXIS>(wpos)), 4);
+    buf[n++]= ',';
+    n += format_fixed(buf + n, robot->from_millimeters(std::get<Z_AXIS>(wpos)), 4);
+
+    // planned time left for the queued moves, so a host can tell when the job will be done
+    memcpy(buf + n, "|Time:", 6);
+    n += 6;
+    n += format_fixed(buf + n, THECONVEYOR->get_time_remaining(), 4);
+
+    buf[n++]= '>';
+    buf[n++]= '\n';
+    buf[n]= '\0';
+    THEKERNEL->streams->puts(buf);
+}
@@ -0,0 +1,35 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Module.h"
+
+#include <stdint.h>
+
+// Sends the grbl style <State|MPos:...|WPos:...|Time:...> report without being asked, so a host does not have to poll with ?
+// Time is the planned seconds left for the moves queued, which is also what M402 reports.
+// A report goes out whenever the state changes, once each time the queue drains (also for moves too short to be seen
+// running from on_idle) and every interval while moving.
+// Set the interval with auto_report_interval in config or M154 Snnn in seconds, 0 turns it off.
+class StatusReport : public Module {
+    public:
+        StatusReport();
+
+        void on_module_loaded();
+        void on_idle(void *argument);
+        void on_gcode_received(void *argument);
+
+    private:
+        void send_report();
+
+        uint32_t interval_us;
+        uint32_t last_report;
+        const char *last_state;
+        uint32_t last_finished;
+        bool pending;
+};
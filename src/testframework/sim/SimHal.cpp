@@ -0,0 +1,111 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SimHal.h"
+
+#include "stm32f407xx.h"
+#include "mbed.h"
+#include "MRI_Hooks.h"
+#include "platform_memory.h"
+#include "StepTicker.h"
+#include "PwmOut.h"
+#include "gpio.h"
+#include "port_api.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+GPIO_TypeDef sim_gpio[SIM_GPIO_PORTS];
+TIM_TypeDef sim_tim6, sim_tim7, sim_tim14;
+SCB_Type sim_scb;
+uint32_t SystemCoreClock= 168000000;
+
+uint32_t sim_main_loop_us= 100;
+std::function<void()> sim_tick_fnc;
+std::function<void(PinName, float)> sim_pwm_fnc;
+
+// the leds main.cpp has, the slow ticker flashes one
+GPIO leds[] = {
+    GPIO(PortE, 12),
+    GPIO(PortE, 13),
+};
+
+static uint64_t ticks= 0;
+
+// the same sizes as the firmware's pools
+static uint8_t ahb0_pool[16384], ahb1_pool[16384], ccm_pool[65535];
+
+extern "C" void TIM8_TRG_COM_TIM14_IRQHandler(void);
+extern "C" void TIM7_IRQHandler(void);
+extern "C" void PendSV_Handler(void);
+
+void sim_hal_init()
+{
+    _AHB0= new MemoryPool(ahb0_pool, sizeof(ahb0_pool));
+    _AHB1= new MemoryPool(ahb1_pool, sizeof(ahb1_pool));
+    _CCM= new MemoryPool(ccm_pool, sizeof(ccm_pool));
+}
+
+void sim_tick()
+{
+    if((TIM7->CR1 & TIM_CR1_CEN) && (TIM7->DIER & TIM_DIER_UIE)) {
+        TIM7->SR |= TIM_SR_UIF;
+        TIM7_IRQHandler();
+    }
+
+    // the unstep timer is one shot, it always runs out well before the next tick
+    if(TIM14->CR1 & TIM_CR1_CEN) {
+        TIM14->CR1 &= ~TIM_CR1_CEN;
+        TIM14->SR |= TIM_SR_UIF;
+        TIM8_TRG_COM_TIM14_IRQHandler();
+    }
+
+    if(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk) {
+        SCB->ICSR= 0;
+        PendSV_Handler();
+    }
+
+    ++ticks;
+    if(sim_tick_fnc) sim_tick_fnc();
+}
+
+void sim_run_for_us(uint32_t us)
+{
+    uint64_t n= llround(us * (double)StepTicker::getInstance()->get_frequency() / 1e6);
+    if(n == 0) n= 1;
+    while(n-- > 0) sim_tick();
+}
+
+uint64_t sim_get_ticks()
+{
+    return ticks;
+}
+
+double sim_get_seconds()
+{
+    return ticks / (double)StepTicker::getInstance()->get_frequency();
+}
+
+extern "C" uint32_t us_ticker_read(void)
+{
+    return (uint32_t)(ticks * 1000000ULL / (uint64_t)StepTicker::getInstance()->get_frequency());
+}
+
+extern "C" uint32_t Set_GPIO_Clock(uint32_t port_idx)
+{
+    return 0;
+}
+
+extern "C" void NVIC_SystemReset(void)
+{
+    printf("reset requested\n");
+    exit(1);
+}
+
+extern "C" void set_high_on_debug(int port, int pin) {}
+extern "C" void set_low_on_debug(int port, int pin) {}
@@ -0,0 +1,27 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+// The simulated clock counts step ticks, each tick runs the interrupts the timers would have raised in it:
+// TIM7 (step_tick), then TIM14 (unstep) if it was started, then PendSV (handle_finish) if it was set.
+// TIM6 (the slow ticker) is not run, nothing the simulator covers needs it.
+// The main loop does not use up any time itself, each ON_IDLE is taken to be one pass that lasts sim_main_loop_us.
+
+extern uint32_t sim_main_loop_us;
+
+// called after each tick, to record what the interrupts did
+extern std::function<void()> sim_tick_fnc;
+
+void sim_hal_init();
+void sim_tick();
+void sim_run_for_us(uint32_t us);
+uint64_t sim_get_ticks();
+double sim_get_seconds();
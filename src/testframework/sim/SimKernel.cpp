@@ -0,0 +1,174 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+This is the Kernel for the motion simulator, it sets up only the motion modules and the switches and runs the main loop on the simulated clock
+*/
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/StreamOutputPool.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+#include "libs/ConfigSources/FirmConfigSource.h"
+
+#include "libs/StepTicker.h"
+#include "modules/communication/GcodeDispatch.h"
+#include "modules/robot/Planner.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/tools/switch/SwitchPool.h"
+#include "libs/SlowTicker.h"
+#include "SimpleShell.h"
+#include "platform_memory.h"
+
+#include "SimHal.h"
+
+#include <string>
+
+#define base_stepping_frequency_checksum            CHECKSUM("base_stepping_frequency")
+#define microseconds_per_step_pulse_checksum        CHECKSUM("microseconds_per_step_pulse")
+#define grbl_mode_checksum                          CHECKSUM("grbl_mode")
+#define feed_hold_enable_checksum                   CHECKSUM("enable_feed_hold")
+#define ok_per_line_checksum                        CHECKSUM("ok_per_line")
+
+Kernel* Kernel::instance;
+
+// the config the kernel is made with, set by sim_kernel_set_config(), the built in config.default if it is not set
+static std::string sim_config;
+
+void sim_kernel_set_config(const std::string& text)
+{
+    sim_config= text;
+}
+
+// the same setup as the firmware's Kernel for the modules it has
+Kernel::Kernel()
+{
+    halted = false;
+    feed_hold = false;
+    use_leds = false;
+
+    instance = this;
+
+    if(sim_config.empty()) this->config = new Config(new FirmConfigSource("firm"));
+    else this->config = new Config(new FirmConfigSource("sim", sim_config.data(), sim_config.data() + sim_config.size()));
+    this->config->config_cache_load();
+
+    this->streams = new StreamOutputPool();
+    this->current_path = "/";
+
+    this->serial = nullptr;
+    this->adc = nullptr;
+    this->simpleshell = nullptr;
+    this->configurator = nullptr;
+
+#ifdef CNC
+    this->grbl_mode = this->config->value( grbl_mode_checksum )->by_default(true)->as_bool();
+#else
+    this->grbl_mode = this->config->value( grbl_mode_checksum )->by_default(false)->as_bool();
+#endif
+    this->enable_feed_hold = this->config->value( feed_hold_enable_checksum )->by_default(this->grbl_mode)->as_bool();
+    this->ok_per_line = this->config->value( ok_per_line_checksum )->by_default(true)->as_bool();
+
+    // the slow ticker's timer is not run, see SimHal.h
+    this->add_module( this->slow_ticker = new SlowTicker() );
+
+    this->step_ticker = new(CCM) StepTicker();
+
+    this->base_stepping_frequency = this->config->value(base_stepping_frequency_checksum)->by_default(100000)->as_number();
+    float microseconds_per_step_pulse = this->config->value(microseconds_per_step_pulse_checksum)->by_default(1)->as_number();
+    this->step_ticker->set_frequency( this->base_stepping_frequency );
+    this->step_ticker->set_unstep_time( microseconds_per_step_pulse );
+
+    this->add_module( this->conveyor       = new Conveyor()      );
+    this->add_module( this->gcode_dispatch = new GcodeDispatch() );
+    this->add_module( this->robot          = new Robot()         );
+
+    this->planner = new Planner();
+
+    // the switches are queued with the moves, so M codes between them can be checked for where they happen
+    SwitchPool *sp= new SwitchPool();
+    sp->load_tools();
+    delete sp;
+}
+
+// Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
+void Kernel::add_module(Module* module)
+{
+    module->on_module_loaded();
+}
+
+// Adds a hook for a given module and event
+void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    this->hooks[id_event].push_back(mod);
+}
+
+// Call a specific event with an argument, each ON_IDLE is one pass of the main loop so the clock runs on after it
+void Kernel::call_event(_EVENT_ENUM id_event, void * argument)
+{
+    bool was_idle = true;
+    if(id_event == ON_HALT) {
+        this->halted = (argument == nullptr);
+        if(!this->halted && this->feed_hold) this->feed_hold= false;
+        was_idle = conveyor->is_idle();
+    }
+
+    for (auto m : hooks[id_event]) {
+        (m->*kernel_callback_functions[id_event])(argument);
+    }
+
+    if(id_event == ON_HALT) {
+        if(!this->halted || !was_idle) {
+            this->robot->reset_position_from_current_actuator_position();
+        }
+    }
+
+    if(id_event == ON_IDLE) sim_run_for_us(sim_main_loop_us);
+}
+
+bool Kernel::kernel_has_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto m : hooks[id_event]) {
+        if(m == mod) return true;
+    }
+    return false;
+}
+
+void Kernel::unregister_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto i = hooks[id_event].begin(); i != hooks[id_event].end(); ++i) {
+        if(*i == mod) {
+            hooks[id_event].erase(i);
+            return;
+        }
+    }
+}
+
+const char *Kernel::get_state(bool& running)
+{
+    running = false;
+    if(halted) return "Alarm";
+    if(feed_hold) return "Hold";
+    if(this->conveyor->is_idle()) return "Idle";
+    running = true;
+    return "Run";
+}
+
+std::string Kernel::get_query_string()
+{
+    bool running;
+    return std::string("<") + get_state(running) + ">\n";
+}
+
+// there is no shell in the simulator
+bool SimpleShell::parse_command(const char *cmd, string args, StreamOutput *stream)
+{
+    return false;
+}
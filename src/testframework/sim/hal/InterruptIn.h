@@ -0,0 +1,10 @@
+#pragma once
+
+#include "PinNames.h"
+
+namespace mbed {
+    class InterruptIn {
+        public:
+            InterruptIn(PinName pin) { (void)pin; }
+    };
+}
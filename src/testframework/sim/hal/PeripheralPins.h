@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include "PinNames.h"
+
+// every pin has a hardware pwm, see PwmOut.h
+typedef struct {
+    PinName pin;
+    int peripheral;
+    int function;
+} PinMap;
+
+static const PinMap PinMap_PWM[] = { {NC, 0, 0} };
+
+static inline uint32_t pinmap_find_peripheral(PinName pin, const PinMap* map) { (void)map; return pin == NC ? (uint32_t)NC : 0; }
@@ -0,0 +1,10 @@
+#pragma once
+
+// the pins are only used by number in the config, the names are port << 4 | pin as in mbed
+
+typedef enum {
+    NC = (int)0xFFFFFFFF
+} PinName;
+
+#define STM_PORT(X) (((uint32_t)(X) >> 4) & 0xF)
+#define STM_PIN(X)  ((uint32_t)(X) & 0xF)
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "PinNames.h"
+
+#include <functional>
+
+// every pin has a hardware pwm, what is written to them is passed to sim_pwm_fnc if it is set
+extern std::function<void(PinName, float)> sim_pwm_fnc;
+
+namespace mbed {
+    class PwmOut {
+        public:
+            PwmOut(PinName pin) : pin(pin) {}
+            void write(float value) { if(sim_pwm_fnc) sim_pwm_fnc(pin, value); }
+            void period_us(int us) { (void)us; }
+
+        private:
+            PinName pin;
+    };
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// newlib only
+#include <math.h>
@@ -0,0 +1,21 @@
+#pragma once
+
+// the parts of mbed the motion code uses, us_ticker_read() is the simulated time
+
+#include "cmsis.h"
+#include "wait_api.h"
+
+#include <math.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint32_t us_ticker_read(void);
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+using namespace std;
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdlib.h>
+
+// there is no debug monitor, a break is a fatal error
+#define __debugbreak() abort()
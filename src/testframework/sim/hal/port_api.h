@@ -0,0 +1,9 @@
+#pragma once
+
+#include "PinNames.h"
+
+typedef enum {
+    PortA = 0, PortB, PortC, PortD, PortE, PortF, PortG, PortH, PortI
+} PortName;
+
+static inline PinName port_pin(PortName port, int pin_n) { return (PinName)((port << 4) | pin_n); }
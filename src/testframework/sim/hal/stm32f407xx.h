@@ -0,0 +1,102 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// The STM32F407 registers the motion code touches, as plain memory the simulator reads and writes.
+// The interrupts are run by the simulator, see SimHal.cpp.
+
+#include <stdint.h>
+
+#define __IO volatile
+
+typedef struct {
+    __IO uint32_t MODER;
+    __IO uint32_t OTYPER;
+    __IO uint32_t OSPEEDR;
+    __IO uint32_t PUPDR;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+    __IO uint32_t LCKR;
+    __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t SMCR;
+    __IO uint32_t DIER;
+    __IO uint32_t SR;
+    __IO uint32_t EGR;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+} TIM_TypeDef;
+
+typedef struct {
+    __IO uint32_t ICSR;
+} SCB_Type;
+
+typedef enum {
+    PendSV_IRQn = -2,
+    TIM8_TRG_COM_TIM14_IRQn = 45,
+    TIM6_DAC_IRQn = 54,
+    TIM7_IRQn = 55,
+} IRQn_Type;
+
+#define SIM_GPIO_PORTS 9
+
+extern GPIO_TypeDef sim_gpio[SIM_GPIO_PORTS];
+extern TIM_TypeDef sim_tim6, sim_tim7, sim_tim14;
+extern SCB_Type sim_scb;
+extern uint32_t SystemCoreClock;
+
+#define GPIOA (&sim_gpio[0])
+#define GPIOB (&sim_gpio[1])
+#define GPIOC (&sim_gpio[2])
+#define GPIOD (&sim_gpio[3])
+#define GPIOE (&sim_gpio[4])
+#define GPIOF (&sim_gpio[5])
+#define GPIOG (&sim_gpio[6])
+#define GPIOH (&sim_gpio[7])
+#define GPIOI (&sim_gpio[8])
+#define TIM6 (&sim_tim6)
+#define TIM7 (&sim_tim7)
+#define TIM14 (&sim_tim14)
+#define SCB (&sim_scb)
+
+#define TIM_CR1_CEN 0x0001U
+#define TIM_CR1_URS 0x0004U
+#define TIM_CR1_OPM 0x0008U
+#define TIM_DIER_UIE 0x0001U
+#define TIM_SR_UIF 0x0001U
+#define SCB_ICSR_PENDSVSET_Msk (1UL << 28)
+
+#define __TIM6_CLK_ENABLE() do {} while(0)
+#define __TIM7_CLK_ENABLE() do {} while(0)
+#define __TIM14_CLK_ENABLE() do {} while(0)
+
+// the handlers are called by name from the simulator, the vector is not evaluated as it is a 32 bit cast of a pointer
+#define NVIC_SetVector(irq, vector) ((void)(irq))
+#define NVIC_EnableIRQ(irq) ((void)(irq))
+#define NVIC_DisableIRQ(irq) ((void)(irq))
+#define NVIC_SetPendingIRQ(irq) ((void)(irq))
+#define NVIC_SetPriority(irq, priority) ((void)(irq))
+#define NVIC_SetPriorityGrouping(group) ((void)(group))
+
+// there is only the one thread, the interrupts run between main loop calls
+#define __disable_irq() do {} while(0)
+#define __enable_irq() do {} while(0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void NVIC_SystemReset(void);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+// busy waits take no simulated time, they are only used around enabling the drivers
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+static inline void wait(float s) { (void)s; }
+static inline void wait_ms(int ms) { (void)ms; }
+static inline void wait_us(int us) { (void)us; }
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+"""\
+Compares S-curve ramps at a few max_jerk settings with trapezoids (max_jerk 0), for how long the moves take and the peak
+acceleration and jerk along the path, as smoothiesim measures them. The ramps are lengthened so neither limit is passed,
+so the moves take longer the lower the jerk. As the jerk is limited the S-curves are also run with all the acceleration
+settings raised by a few factors, which is what a machine would be set to if S-curves let it take more, the times are
+compared with the trapezoids at the acceleration in the config. Runs the plannerbench.py jobs, or the gcode files given,
+through smoothiesim, build it first (make jerkbench does both).
+
+    jerkbench.py [max_jerk values...] [xfactor...] [file.gcode...]
+
+eg jerkbench.py 1000000 x1.5 x2 for max_jerk 1000000 at 1, 1.5 and 2 times the acceleration
+"""
+
+from __future__ import print_function
+import sys
+import os
+import re
+import subprocess
+import tempfile
+
+import plannerbench
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def raise_acceleration(config, factor):
+    """the config with acceleration, z_acceleration and the <axis>_acceleration settings times factor"""
+    def scale(m):
+        return m.group(1) + b'%g' % (float(m.group(2)) * factor)
+    return re.sub(br'(?m)^((?:[a-z]+_)?acceleration\s+)([\d.]+)', scale, config)
+
+def main():
+    jerks = [float(a) for a in sys.argv[1:] if not a.endswith('.gcode') and not a.startswith('x')] or [1000000, 300000]
+    factors = [float(a[1:]) for a in sys.argv[1:] if a.startswith('x')] or [1.5, 2]
+    files = [a for a in sys.argv[1:] if a.endswith('.gcode')]
+    sim = os.path.join(HERE, 'smoothiesim')
+    with open(os.path.join(HERE, '..', '..', 'config.default'), 'rb') as f:
+        config = f.read()
+
+    tmp = tempfile.mkdtemp()
+    jobs = [(os.path.splitext(os.path.basename(p))[0], p) for p in files]
+    if not jobs:
+        for name, fn in (('arcs', plannerbench.arcs), ('dense', plannerbench.dense), ('pnp', plannerbench.pnp)):
+            path = os.path.join(tmp, name + '.gcode')
+            with open(path, 'w') as f:
+                f.write('\n'.join(fn()) + '\n')
+            jobs.append((name, path))
+
+    print('%-8s %10s %6s %10s %8s %12s %12s' % ('job', 'max_jerk', 'accel', 'motion s', 'slower', 'peak accel', 'peak jerk'))
+    for name, path in jobs:
+        base = None
+        for jerk, factor in [(0, 1)] + [(j, f) for j in jerks for f in [1] + factors]:
+            cfg = os.path.join(tmp, 'config%d_%g' % (jerk, factor))
+            with open(cfg, 'wb') as f:
+                f.write(raise_acceleration(config, factor) + b'\nmax_jerk %d\n' % jerk)
+            out = subprocess.check_output([sim, '-c', cfg, path]).decode()
+            t = float(re.search(r'([\d.]+) s from the start of the first', out).group(1))
+            m = re.search(r'peak acceleration (\d+) mm/s\^2, peak jerk (\d+) mm/s\^3', out)
+            if base is None: base = t
+            print('%-8s %10d %5gx %10.3f %7.1f%% %12s %12s' % (name, jerk, factor, t, (t / base - 1) * 100, m.group(1), m.group(2)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+"""\
+Measures how much work the planner does for each block it plans, for the kinds of moves that make a lot of short
+blocks, at a few planner_queue_size settings, with planner_trapezoid_horizon_ms off and at 20. The step timeline hash
+is the same for both when the horizon works. Runs smoothiesim -p, build it first (make bench does both).
+
+    plannerbench.py [queue sizes...]
+
+arcs    G2 circles, split into mm_per_arc_segment segments by the firmware
+dense   a smooth curve sent as short G1 segments, the way CAM output is
+pnp     long G0 moves, for comparison
+"""
+
+from __future__ import print_function
+import sys
+import os
+import re
+import math
+import subprocess
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def arcs():
+    g = ['G21', 'G90', 'G28.3 X0 Y0 Z0']
+    for i in range(40):
+        r = 1 + i % 10
+        g.append('G0 X%d Y100 F60000' % (100 + r))
+        g.append('G2 X%d Y100 I%d J0 F%d' % (100 + r, -r, 6000 + (i % 4) * 6000))
+    return g
+
+def dense():
+    g = ['G21', 'G90', 'G28.3 X0 Y0 Z0', 'G0 X100 Y100 F60000']
+    t = 0.0
+    for i in range(6000):
+        # a Lissajous curve with segments of 0.05 to 0.3 mm
+        t += 0.0015 + 0.0035 * (i % 7) / 6.0
+        x = 100 + 40 * math.sin(3 * t)
+        y = 100 + 40 * math.sin(2 * t)
+        g.append('G1 X%.4f Y%.4f F%d' % (x, y, 30000 if i < 3000 else 60000))
+    return g
+
+def pnp():
+    g = ['G21', 'G90', 'G28.3 X0 Y0 Z0']
+    for i in range(300):
+        g.append('G0 X%d Y%d F60000' % (10 + (i * 37) % 300, 10 + (i * 53) % 200))
+        g.append('G0 Z-10')
+        g.append('G0 Z0')
+    return g
+
+def main():
+    sizes = [int(a) for a in sys.argv[1:]] or [32, 128, 256]
+    sim = os.path.join(HERE, 'smoothiesim')
+    with open(os.path.join(HERE, '..', '..', 'config.default'), 'rb') as f:
+        config = f.read()
+
+    tmp = tempfile.mkdtemp()
+    jobs = []
+    for name, fn in (('arcs', arcs), ('dense', dense), ('pnp', pnp)):
+        path = os.path.join(tmp, name + '.gcode')
+        with open(path, 'w') as f:
+            f.write('\n'.join(fn()) + '\n')
+        jobs.append((name, path))
+
+    print('%-6s %6s %8s %8s %10s %6s %8s %10s %10s %17s' % ('job', 'queue', 'horizon', 'blocks', 'walk back', 'most', 'forward', 'trapezoid', 'motion s', 'hash'))
+    for size in sizes:
+        for horizon in (0, 20):
+            cfg = os.path.join(tmp, 'config%d_%d' % (size, horizon))
+            with open(cfg, 'wb') as f:
+                c = re.sub(br'(?m)^planner_queue_size\s+\d+', b'planner_queue_size %d' % size, config)
+                f.write(c + b'\nplanner_trapezoid_horizon_ms %d\n' % horizon)
+            for name, path in jobs:
+                out = subprocess.check_output([sim, '-p', '-c', cfg, path]).decode()
+                m = re.search(r'planner (\d+) blocks, for each one walked back over ([\d.]+) \(at most (\d+)\), forward over ([\d.]+), ([\d.]+) trapezoids', out)
+                t = re.search(r'([\d.]+) s in all', out)
+                h = re.search(r'step timeline hash (\w+)', out)
+                print('%-6s %6d %8d %8s %10s %6s %8s %10s %10s %17s' % (name, size, horizon, m.group(1), m.group(2), m.group(3), m.group(4), m.group(5), t.group(1), h.group(1)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,349 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+Streams a gcode file through the motion code on the simulated clock and writes out every step it makes and the timing of
+every block, the same file and config always give the same output so changes to the planner can be compared run for run.
+
+    smoothiesim [-c config] [-s steps.csv] [-b blocks.csv] [-o outputs.csv] [-l main_loop_us] [-p] [-v] file.gcode
+
+without -c the config is the config.default built into it, as in the firmware
+steps.csv has a line per step, the tick it was made in, the motor and the direction (1 or -1)
+blocks.csv has a line per block, when it started, how many ticks it took and how many it was planned for, and its speeds
+outputs.csv has a line per hwpwm switch change, the tick it was made in, how many blocks had finished, the pin and the value,
+switchtest.py uses it to check M codes between moves happen in their place without stopping the moves
+-p reports how much work the planner did for each block, plannerbench.py runs it for a few kinds of job
+the peak acceleration and jerk are measured along the path within each block, jerkbench.py compares them for a few max_jerk
+*/
+
+#include "libs/Kernel.h"
+#include "libs/StreamOutput.h"
+#include "libs/StreamOutputPool.h"
+#include "libs/SerialMessage.h"
+#include "libs/StepTicker.h"
+#include "libs/StepperMotor.h"
+#include "libs/Config.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Block.h"
+#include "modules/robot/Planner.h"
+
+#include "SimHal.h"
+#include "PwmOut.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+void sim_kernel_set_config(const std::string& text);
+
+// the console the gcode is sent from, the oks are only shown with -v
+class SimConsole : public StreamOutput {
+    public:
+        SimConsole(bool verbose) : verbose(verbose) {}
+        int puts(const char *s)
+        {
+            if(verbose || strncmp(s, "ok", 2) != 0 || s[2] > ' ') fputs(s, stderr);
+            return strlen(s);
+        }
+
+    private:
+        bool verbose;
+};
+
+// records the steps and blocks after each tick, and the output changes as they are made
+class Recorder {
+    public:
+        Recorder(FILE *steps_fp, FILE *blocks_fp, FILE *outputs_fp) : steps_fp(steps_fp), blocks_fp(blocks_fp), outputs_fp(outputs_fp)
+        {
+            n_motors= THEROBOT->get_number_registered_motors();
+            for (uint8_t m = 0; m < n_motors; ++m) {
+                last_pos.push_back((int32_t)THEROBOT->actuators[m]->get_current_step());
+                step_counts.push_back(0);
+            }
+            last_finished= THECONVEYOR->get_blocks_finished();
+            window= THEKERNEL->step_ticker->get_frequency() / 2000; // 0.5 ms
+            speeds.resize(2 * window + 1);
+            if(steps_fp != nullptr) fprintf(steps_fp, "tick,motor,dir\n");
+            if(blocks_fp != nullptr) fprintf(blocks_fp, "block,start_s,ticks,planned_ticks,accel_ticks,decel_ticks,mm,entry,nominal,exit,acceleration\n");
+            if(outputs_fp != nullptr) fprintf(outputs_fp, "tick,block,pin,value\n");
+        }
+
+        // called when a pwm is written, from the step ticker when it is queued between blocks, in the tick it is made in
+        void output(PinName pin, float value)
+        {
+            ++n_outputs;
+            if(outputs_fp != nullptr) {
+                fprintf(outputs_fp, "%llu,%u,%u,%1.4f\n", (unsigned long long)sim_get_ticks(), (unsigned)THECONVEYOR->get_blocks_finished(),
+                        (unsigned)pin, value);
+            }
+        }
+
+        void tick()
+        {
+            // the tick that has just been run
+            uint64_t t= sim_get_ticks() - 1;
+
+            for (uint8_t m = 0; m < n_motors; ++m) {
+                int32_t pos= (int32_t)THEROBOT->actuators[m]->get_current_step();
+                int32_t d= pos - last_pos[m];
+                if(d == 0) continue;
+                last_pos[m]= pos;
+                step_counts[m] += abs(d);
+                hash_in(t);
+                hash_in(m);
+                hash_in(d);
+                if(steps_fp != nullptr) fprintf(steps_fp, "%llu,%c,%d\n", (unsigned long long)t, axis_name(m), (int)d);
+            }
+
+            // a block that finished in this tick ends with it, the next block started in it starts on the next tick
+            bool finished= false;
+            if(THECONVEYOR->get_blocks_finished() != last_finished) {
+                last_finished= THECONVEYOR->get_blocks_finished();
+                if(open) end_block(t + 1);
+                finished= true;
+            }
+
+            const Block *b= THEKERNEL->step_ticker->get_current_block();
+            if(b != nullptr && !open) start_block(b, finished ? t + 1 : t);
+
+            path_speed(b);
+        }
+
+        void summary(FILE *fp) const
+        {
+            double f= THEKERNEL->step_ticker->get_frequency();
+            fprintf(fp, "%u blocks, %1.4f s from the start of the first to the end of the last, %1.4f s in all\n", n_blocks, (last_end - first_start) / f, sim_get_seconds());
+            fprintf(fp, "steps");
+            for (uint8_t m = 0; m < n_motors; ++m) fprintf(fp, " %c:%u", axis_name(m), step_counts[m]);
+            fprintf(fp, "\n");
+            if(late_blocks > 0) fprintf(fp, "%u blocks took longer than planned\n", late_blocks);
+            if(n_outputs > 0) fprintf(fp, "%u output changes\n", n_outputs);
+            fprintf(fp, "peak acceleration %1.0f mm/s^2, peak jerk %1.0f mm/s^3, along the path over %u ticks, speed steps up to %1.2f mm/s between blocks\n",
+                    peak_acceleration, peak_jerk, window, peak_step);
+            fprintf(fp, "step timeline hash %016llx\n", (unsigned long long)hash);
+        }
+
+    private:
+        static char axis_name(uint8_t m) { return m < 3 ? 'X' + m : 'A' + m - 3; }
+
+        // FNV-1a
+        void hash_in(uint64_t v)
+        {
+            for (int i = 0; i < 8; ++i) {
+                hash ^= (v >> (i * 8)) & 0xFF;
+                hash *= 0x100000001B3ULL;
+            }
+        }
+
+        // the speed along the path after each tick from the step ticker's rate, the acceleration and jerk are its differences
+        // over a window within one block. Between blocks the speed steps a little as a block finishes on its last step,
+        // which the step ticker can reach before the end of its ramp, that is reported on its own
+        void path_speed(const Block *b)
+        {
+            if(b == nullptr || b->steps_event_count == 0) {
+                run= 0;
+                return;
+            }
+
+            float rate;
+            if(b->arc != nullptr) {
+                rate= THEKERNEL->step_ticker->get_path_rate();
+            } else {
+                uint8_t m= 0;
+                while(m < n_motors - 1 && b->steps[m] != b->steps_event_count) ++m;
+                rate= THEKERNEL->step_ticker->get_trapezoid_rate(m);
+            }
+            float v= rate * b->millimeters / b->steps_event_count;
+
+            if(new_block) {
+                new_block= false;
+                // not counted when it starts from rest, the one before has stopped
+                if(run > 0 && b->initial_rate > 0) peak_step= std::max(peak_step, fabsf(v - speeds[(run - 1) % speeds.size()]));
+                run= 0;
+            }
+
+            speeds[run++ % speeds.size()]= v;
+            if(run < speeds.size()) return;
+            float w= window / THEKERNEL->step_ticker->get_frequency();
+            float v1= speeds[(run - 1 - window) % speeds.size()];
+            float v2= speeds[(run - 1 - 2 * window) % speeds.size()];
+            peak_acceleration= std::max(peak_acceleration, fabsf(v - v1) / w);
+            peak_jerk= std::max(peak_jerk, fabsf(v - 2 * v1 + v2) / (w * w));
+        }
+
+        void start_block(const Block *b, uint64_t t)
+        {
+            open= true;
+            start= t;
+            if(n_blocks == 0) first_start= t;
+            planned= b->total_move_ticks;
+            accel_ticks= b->accelerate_until;
+            decel_ticks= b->total_move_ticks - b->decelerate_after;
+            mm= b->millimeters;
+            entry= b->entry_speed;
+            nominal= b->nominal_speed;
+            exit= b->exit_speed;
+            acceleration= b->acceleration;
+            new_block= true;
+        }
+
+        void end_block(uint64_t t)
+        {
+            open= false;
+            last_end= t;
+            uint64_t ticks= t - start;
+            // a block takes one tick more than its total_move_ticks as the last steps are made on the tick after it
+            if(ticks > planned + 1) ++late_blocks;
+            if(blocks_fp != nullptr) {
+                fprintf(blocks_fp, "%u,%1.6f,%llu,%u,%u,%u,%1.4f,%1.4f,%1.4f,%1.4f,%1.1f\n", n_blocks, start / THEKERNEL->step_ticker->get_frequency(),
+                        (unsigned long long)ticks, planned, accel_ticks, decel_ticks, mm, entry, nominal, exit, acceleration);
+            }
+            ++n_blocks;
+        }
+
+        FILE *steps_fp, *blocks_fp, *outputs_fp;
+        uint8_t n_motors;
+        std::vector<int32_t> last_pos;
+        std::vector<uint32_t> step_counts;
+        uint64_t hash{0xCBF29CE484222325ULL};
+
+        uint32_t last_finished;
+        uint32_t n_blocks{0};
+        uint32_t late_blocks{0};
+        uint32_t n_outputs{0};
+        uint64_t first_start{0}, last_end{0};
+
+        // the path speeds of the last two windows of ticks of the block running
+        uint32_t window;
+        std::vector<float> speeds;
+        uint32_t run{0};
+        bool new_block{false};
+        float peak_acceleration{0}, peak_jerk{0}, peak_step{0};
+
+        // the block running now
+        bool open{false};
+        uint64_t start;
+        uint32_t planned, accel_ticks, decel_ticks;
+        float mm, entry, nominal, exit, acceleration;
+};
+
+static bool read_file(const char *fn, std::string& text)
+{
+    FILE *fp= fopen(fn, "r");
+    if(fp == nullptr) return false;
+    char buf[4096];
+    size_t n;
+    while((n= fread(buf, 1, sizeof(buf), fp)) > 0) text.append(buf, n);
+    fclose(fp);
+    return true;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: smoothiesim [-c config] [-s steps.csv] [-b blocks.csv] [-o outputs.csv] [-l main_loop_us] [-p] [-v] file.gcode\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_fn= nullptr;
+    const char *steps_fn= nullptr, *blocks_fn= nullptr, *outputs_fn= nullptr;
+    bool verbose= false;
+    bool planner_stats= false;
+
+    int c;
+    while((c= getopt(argc, argv, "c:s:b:o:l:pv")) != -1) {
+        switch(c) {
+            case 'c': config_fn= optarg; break;
+            case 's': steps_fn= optarg; break;
+            case 'b': blocks_fn= optarg; break;
+            case 'o': outputs_fn= optarg; break;
+            case 'l': sim_main_loop_us= strtoul(optarg, nullptr, 10); break;
+            case 'p': planner_stats= true; break;
+            case 'v': verbose= true; break;
+            default: usage();
+        }
+    }
+    if(optind != argc - 1) usage();
+
+    std::string config;
+    if(config_fn != nullptr && !read_file(config_fn, config)) {
+        fprintf(stderr, "cannot read config %s\n", config_fn);
+        return 1;
+    }
+
+    FILE *gcode_fp= fopen(argv[optind], "r");
+    if(gcode_fp == nullptr) {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 1;
+    }
+    FILE *steps_fp= steps_fn != nullptr ? fopen(steps_fn, "w") : nullptr;
+    FILE *blocks_fp= blocks_fn != nullptr ? fopen(blocks_fn, "w") : nullptr;
+    FILE *outputs_fp= outputs_fn != nullptr ? fopen(outputs_fn, "w") : nullptr;
+
+    sim_hal_init();
+    sim_kernel_set_config(config);
+    Kernel *kernel= new Kernel();
+    SimConsole console(verbose);
+    kernel->streams->append_stream(&console);
+    kernel->config->config_cache_clear();
+
+    // as the end of the firmware's init()
+    THEKERNEL->conveyor->start(THEROBOT->get_number_registered_motors());
+    THEKERNEL->step_ticker->start();
+
+    Recorder recorder(steps_fp, blocks_fp, outputs_fp);
+    sim_tick_fnc= [&recorder]() { recorder.tick(); };
+    sim_pwm_fnc= [&recorder](PinName pin, float value) { recorder.output(pin, value); };
+
+    // a line is taken each main loop pass while there is room in the queue, as the console and the player do
+    char buf[256];
+    unsigned lines= 0;
+    while(fgets(buf, sizeof(buf), gcode_fp) != nullptr) {
+        std::string line(buf);
+        while(!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        if(line.empty()) continue;
+
+        while(THECONVEYOR->is_queue_full()) {
+            kernel->call_event(ON_MAIN_LOOP);
+            kernel->call_event(ON_IDLE);
+        }
+
+        struct SerialMessage message;
+        message.message= line;
+        message.stream= &console;
+        kernel->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        ++lines;
+
+        kernel->call_event(ON_MAIN_LOOP);
+        kernel->call_event(ON_IDLE);
+    }
+    fclose(gcode_fp);
+
+    THECONVEYOR->wait_for_idle();
+
+    printf("%u lines, ", lines);
+    recorder.summary(stdout);
+
+    if(planner_stats) {
+        const Planner::stats_t& s= THEKERNEL->planner->get_stats();
+        float n= s.appends > 0 ? s.appends : 1;
+        printf("planner %u blocks, for each one walked back over %1.1f (at most %u), forward over %1.1f, %1.1f trapezoids, %u merged, %u arcs\n",
+               s.appends, s.reverse / n, s.max_walk, s.forward / n, s.trapezoids / n, s.merges, s.arcs);
+    }
+
+    if(steps_fp != nullptr) fclose(steps_fp);
+    if(blocks_fp != nullptr) fclose(blocks_fp);
+    if(outputs_fp != nullptr) fclose(outputs_fp);
+    return 0;
+}
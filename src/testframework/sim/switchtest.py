@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+"""\
+Checks that the vacuum switch M codes of a pick and place job (M808 S100 and M809, a hwpwm switch in config.default)
+happen in their place between the moves without the moves stopping for them. The job is run through smoothiesim with
+and without the M codes and
+    every block has the same ticks and speeds, and starts at the same time after the first, so the junction speeds are kept
+    each output change happens in the order of the file, after the moves before it in the file and in the tick the last
+    of them finishes, so before the move after it starts
+    the pin goes on and off in turn
+Exits with 1 if any of them fail. Build smoothiesim first (make switchtest does both).
+
+    switchtest.py
+"""
+
+from __future__ import print_function
+import sys
+import os
+import re
+import subprocess
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+VAC_PIN = 0x45 # 4.5 as a PinName
+
+def job():
+    # picks and places at an angle to the moves between them so most junctions do not stop, and a few M codes between
+    # two XY moves
+    g = ['G21', 'G90', 'G28.3 X0 Y0 Z0']
+    for i in range(40):
+        g.append('G0 X%d Y%d F60000' % (10 + (i * 37) % 300, 10 + (i * 53) % 200))
+        g.append('G0 X%d Y%d' % (20 + (i * 37) % 300, 15 + (i * 53) % 200))
+        g.append('M808 S100' if i % 2 == 0 else 'M809')
+        g.append('G0 Z-5')
+        g.append('G0 Z0')
+        if i % 5 == 0:
+            g.append('G0 X%d Y%d' % (30 + (i * 37) % 300, 10 + (i * 53) % 200))
+            g.append('M809' if i % 2 == 0 else 'M808 S100')
+            g.append('G0 X%d Y%d' % (40 + (i * 37) % 300, 20 + (i * 53) % 200))
+            g.append('M808 S100' if i % 2 == 0 else 'M809')
+    return g
+
+def read_csv(path):
+    with open(path) as f:
+        lines = f.read().split('\n')
+    names = lines[0].split(',')
+    return [dict(zip(names, l.split(','))) for l in lines[1:] if l]
+
+def run(sim, path, tmp):
+    blocks = os.path.join(tmp, 'blocks.csv')
+    outputs = os.path.join(tmp, 'outputs.csv')
+    subprocess.check_call([sim, '-b', blocks, '-o', outputs, path], stdout=open(os.devnull, 'w'))
+    return read_csv(blocks), read_csv(outputs)
+
+def main():
+    sim = os.path.join(HERE, 'smoothiesim')
+    with open(os.path.join(HERE, '..', '..', 'config.default'), 'rb') as f:
+        freq = float(re.search(br'^base_stepping_frequency\s+(\d+)', f.read(), re.M).group(1))
+
+    tmp = tempfile.mkdtemp()
+    g = job()
+    moves = [l for l in g if not l.startswith('M')]
+    with open(os.path.join(tmp, 'switches.gcode'), 'w') as f:
+        f.write('\n'.join(g) + '\n')
+    with open(os.path.join(tmp, 'moves.gcode'), 'w') as f:
+        f.write('\n'.join(moves) + '\n')
+
+    blocks, outputs = run(sim, os.path.join(tmp, 'switches.gcode'), tmp)
+    plain, _ = run(sim, os.path.join(tmp, 'moves.gcode'), tmp)
+
+    errors = []
+    def check(ok, what):
+        if not ok: errors.append(what)
+
+    # the same moves as without the M codes, the first block may start a little later as the M code before it is read first
+    check(len(blocks) == len(plain), '%d blocks, %d without the M codes' % (len(blocks), len(plain)))
+    start = lambda b: int(round(float(b['start_s']) * freq))
+    for a, b in zip(blocks, plain):
+        same = all(a[k] == b[k] for k in ('ticks', 'planned_ticks', 'accel_ticks', 'decel_ticks', 'entry', 'nominal', 'exit'))
+        check(same and start(a) - start(blocks[0]) == start(b) - start(plain[0]), 'block %s is not the same without the M codes' % a['block'])
+
+    # in the file order, after the moves before it, G28.3 only sets the position
+    mcodes = []
+    n = 0
+    for l in g:
+        if l.startswith('G0'): n += 1
+        elif l.startswith('M'): mcodes.append((l, n))
+    check(len(outputs) == len(mcodes), '%d output changes for %d M codes' % (len(outputs), len(mcodes)))
+    on = None
+    junctions = 0
+    for (code, n), o in zip(mcodes, outputs):
+        tick, done = int(o['tick']), int(o['block'])
+        check(int(o['pin']) == VAC_PIN, '%s changed pin %s' % (code, o['pin']))
+        check(done == n, '%s after move %d was made after %d blocks' % (code, n, done))
+        if 0 < n < len(blocks):
+            # a block ends on the tick after the one it finished in
+            end = start(blocks[n - 1]) + int(blocks[n - 1]['ticks'])
+            check(tick == end - 1, '%s after move %d was made in tick %d, the move finished in tick %d' % (code, n, tick, end - 1))
+            if float(blocks[n]['entry']) > 0: junctions += 1
+        if on is None: on = o['value']
+        check((o['value'] == on) == code.startswith('M808'), '%s set the pin to %s' % (code, o['value']))
+
+    print('%d blocks, %d output changes, %d of them between moves that did not stop' % (len(blocks), len(outputs), junctions))
+    check(junctions > 0, 'the moves stopped at all the M codes')
+    for e in errors: print(e)
+    print('FAIL' if errors else 'OK')
+    return 1 if errors else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,141 @@
+#include "BinaryFrame.h"
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// recorded from smoothie-binary.py
+// G0 X123.4567 Y234.5678 Z-12.3456 A90.0000 F60000
+static const uint8_t move1[]= {0x02, 0x47, 0x16, 0x02, 0x0f, 0x00, 0x46, 0xc3, 0x23, 0x87, 0xd6, 0x12, 0x00, 0xce, 0xca, 0x23, 0x00, 0xc0, 0x1d, 0xfe, 0xff, 0xa0, 0xbb, 0x0d, 0x00, 0x05, 0xb5};
+// G1 X10 Y-5.25
+static const uint8_t move2[]= {0x02, 0x47, 0x0a, 0x01, 0x03, 0xa0, 0x86, 0x01, 0x00, 0xec, 0x32, 0xff, 0xff, 0x49, 0xa5};
+// M800 S0.5
+static const uint8_t output1[]= {0x02, 0x4f, 0x06, 0x20, 0x03, 0x88, 0x13, 0x00, 0x00, 0x1b, 0x26};
+// M114.2
+static const uint8_t query1[]= {0x02, 0x51, 0x03, 0x72, 0x00, 0x02, 0x99, 0xa3};
+
+TEST(BinaryFrameTest,decode_recorded)
+{
+    uint8_t type;
+    const uint8_t *payload;
+    size_t len;
+    BinaryFrame::move_t mv;
+
+    ASSERT_TRUE(BinaryFrame::check(move1, sizeof(move1), type, payload, len));
+    ASSERT_TRUE(type == BinaryFrame::MOVE);
+    ASSERT_TRUE(BinaryFrame::decode_move(payload, len, mv));
+    ASSERT_TRUE(!mv.linear);
+    ASSERT_TRUE(mv.has_feed);
+    ASSERT_TRUE(mv.mask == 0x0F);
+    ASSERT_EQUALS_DELTA_V(60000.0F, mv.feed, 0.0001F);
+    // the same floats the text would have given
+    ASSERT_TRUE(mv.pos[0] == 123.4567F);
+    ASSERT_TRUE(mv.pos[1] == 234.5678F);
+    ASSERT_TRUE(mv.pos[2] == -12.3456F);
+    ASSERT_TRUE(mv.pos[3] == 90.0F);
+
+    ASSERT_TRUE(BinaryFrame::check(move2, sizeof(move2), type, payload, len));
+    ASSERT_TRUE(BinaryFrame::decode_move(payload, len, mv));
+    ASSERT_TRUE(mv.linear);
+    ASSERT_TRUE(!mv.has_feed);
+    ASSERT_TRUE(mv.mask == 0x03);
+    ASSERT_TRUE(mv.pos[0] == 10.0F);
+    ASSERT_TRUE(mv.pos[1] == -5.25F);
+
+    ASSERT_TRUE(BinaryFrame::check(output1, sizeof(output1), type, payload, len));
+    ASSERT_TRUE(type == BinaryFrame::OUTPUT);
+    ASSERT_TRUE(len == 6);
+    ASSERT_TRUE((payload[0] | (payload[1] << 8)) == 800);
+
+    ASSERT_TRUE(BinaryFrame::check(query1, sizeof(query1), type, payload, len));
+    ASSERT_TRUE(type == BinaryFrame::QUERY);
+    ASSERT_TRUE((payload[0] | (payload[1] << 8)) == 114);
+    ASSERT_TRUE(payload[2] == 2);
+}
+
+TEST(BinaryFrameTest,bad_frames)
+{
+    uint8_t type;
+    const uint8_t *payload;
+    size_t len;
+    uint8_t f[sizeof(move1)];
+
+    // every single bit flip is caught
+    for (size_t i = 1; i < sizeof(move1); ++i) {
+        for (int b = 0; b < 8; ++b) {
+            memcpy(f, move1, sizeof(f));
+            f[i] ^= 1 << b;
+            ASSERT_TRUE(!BinaryFrame::check(f, sizeof(f), type, payload, len));
+        }
+    }
+
+    // short
+    ASSERT_TRUE(!BinaryFrame::check(move1, sizeof(move1) - 1, type, payload, len));
+
+    // the mask says more axes than there are
+    uint8_t p[]= {0x00, 0x07, 1, 0, 0, 0, 2, 0, 0, 0};
+    BinaryFrame::move_t mv;
+    ASSERT_TRUE(!BinaryFrame::decode_move(p, sizeof(p), mv));
+
+    // round trip
+    uint8_t out[BinaryFrame::max_size];
+    size_t n= BinaryFrame::encode(BinaryFrame::MOVE, move2 + 3, move2[2], out);
+    ASSERT_TRUE(n == sizeof(move2));
+    ASSERT_TRUE(memcmp(out, move2, n) == 0);
+}
+
+// frames and text lines mixed on the link, received a byte at a time the way the serial console does
+TEST(BinaryFrameTest,receive_mixed)
+{
+    std::vector<uint8_t> link;
+    auto add_text= [&link](const char *s) { link.insert(link.end(), s, s + strlen(s)); };
+    auto add_frame= [&link](const uint8_t *f, size_t n) { link.insert(link.end(), f, f + n); };
+
+    add_text("G28\n");
+    add_frame(move1, sizeof(move1));
+    add_frame(move2, sizeof(move2)); // has a 0x0a in it
+    add_text("M400\n");
+    add_frame(output1, sizeof(output1));
+    // a stray STX, the next char is not a frame type so it is all text
+    add_text("\x02M114\n");
+    add_frame(query1, sizeof(query1));
+
+    BinaryFrame rx;
+    std::vector<std::string> items;
+    std::string text;
+    for (uint8_t c : link) {
+        if(rx.active()) {
+            int r= rx.put(c);
+            if(r == 0) continue;
+            if(r > 0) {
+                items.push_back(std::string((const char *)rx.data(), rx.size()));
+                continue;
+            }
+        }
+        if(c == BINARY_FRAME_STX) {
+            rx.start();
+            continue;
+        }
+        if(c == '\n') {
+            items.push_back(text);
+            text.clear();
+        } else {
+            text += c;
+        }
+    }
+
+    ASSERT_EQUALS_V(7, (int)items.size());
+    ASSERT_TRUE(items[0] == "G28");
+    ASSERT_TRUE(items[1] == std::string((const char *)move1, sizeof(move1)));
+    ASSERT_TRUE(items[2] == std::string((const char *)move2, sizeof(move2)));
+    ASSERT_TRUE(items[3] == "M400");
+    ASSERT_TRUE(items[4] == std::string((const char *)output1, sizeof(output1)));
+    ASSERT_TRUE(items[5] == "M114");
+    ASSERT_TRUE(items[6] == std::string((const char *)query1, sizeof(query1)));
+
+    const char *line= "G0 X123.4567 Y234.5678 Z-12.3456 A90.0000 F60000\n";
+    printf("move as text %u bytes, as a frame %u bytes, %1.2f ms and %1.2f ms at 115200\n", (unsigned)strlen(line), (unsigned)sizeof(move1), strlen(line) * 10 / 115.2F, sizeof(move1) * 10 / 115.2F);
+}
@@ -0,0 +1,154 @@
+#include "DecimalParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "easyunit/test.h"
+
+// same bits, so -0 and 0 are different
+static bool same(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// formats whole + frac / 10^decimals without printf, as there are a lot of them
+static int format(char *buf, bool neg, uint32_t whole, uint32_t frac, int decimals)
+{
+    char tmp[16];
+    int n= 0, k= 0;
+    if(neg) buf[n++]= '-';
+    do { tmp[k++]= '0' + whole % 10; whole /= 10; } while(whole > 0);
+    while(k > 0) buf[n++]= tmp[--k];
+    if(decimals > 0) {
+        buf[n++]= '.';
+        for (int i = decimals - 1; i >= 0; --i) {
+            buf[n + i]= '0' + frac % 10;
+            frac /= 10;
+        }
+        n += decimals;
+    }
+    buf[n]= '\0';
+    return n;
+}
+
+static bool check(const char *buf, int n)
+{
+    char *e1, *e2;
+    float a= decimal_to_float(buf, &e1);
+    float b= strtof(buf, &e2);
+    if(!same(a, b) || e1 != e2 || e1 != buf + n) {
+        printf("mismatch %s: %1.9g %1.9g\n", buf, a, b);
+        return false;
+    }
+    return true;
+}
+
+TEST(DecimalParserTest,formats)
+{
+    char *e;
+    const char *s= " -12.5X";
+    ASSERT_TRUE(same(decimal_to_float(s, &e), -12.5F));
+    ASSERT_TRUE(*e == 'X');
+    ASSERT_TRUE(same(decimal_to_float("+.25", nullptr), 0.25F));
+    ASSERT_TRUE(same(decimal_to_float("7.", nullptr), 7.0F));
+    ASSERT_TRUE(same(decimal_to_float("-0", nullptr), -0.0F));
+
+    // no number, end is where it started
+    s= "-.X";
+    decimal_to_float(s, &e);
+    ASSERT_TRUE(e == s);
+    s= "";
+    decimal_to_float(s, &e);
+    ASSERT_TRUE(e == s);
+
+    // no exponent, so the E is left as the next word
+    s= "1E3";
+    ASSERT_TRUE(same(decimal_to_float(s, &e), 1.0F));
+    ASSERT_TRUE(*e == 'E');
+
+    // too long for the fast paths, these go to strtof
+    ASSERT_TRUE(check("123456789012345678901234.5", 26));
+    ASSERT_TRUE(check("0.00000000000000000000000001", 28));
+    ASSERT_TRUE(check("3.14159265358979323846", 22));
+    ASSERT_TRUE(check("16777217", 8));
+
+    ASSERT_EQUALS_V(-42, decimal_to_int(" -42.9", &e));
+    ASSERT_TRUE(*e == '.');
+    ASSERT_EQUALS_V(0, decimal_to_int("X", &e));
+    ASSERT_TRUE(*e == 'X');
+    ASSERT_TRUE((uint32_t)decimal_to_int("4294967295", nullptr) == 4294967295UL);
+}
+
+// on the board every value takes too long, so it checks a spread of them
+#ifdef __arm__
+static const uint32_t k_step= 97;
+#else
+static const uint32_t k_step= 1;
+#endif
+
+// every value with up to 4 decimals within +-2000mm, with and without the trailing zeros
+TEST(DecimalParserTest,exhaustive_positions)
+{
+    char buf[32];
+    uint32_t bad= 0, count= 0;
+    for (uint32_t whole = 0; whole < 2000; ++whole) {
+        for (uint32_t frac = 0; frac < 10000; frac += k_step) {
+            for (int neg = 0; neg < 2; ++neg) {
+                int n= format(buf, neg, whole, frac, 4);
+                if(!check(buf, n)) ++bad;
+                ++count;
+                // the same value as a host would send it
+                int d= 4;
+                uint32_t f= frac;
+                while(d > 0 && f % 10 == 0) { f /= 10; --d; }
+                if(d < 4) {
+                    n= format(buf, neg, whole, f, d);
+                    if(!check(buf, n)) ++bad;
+                    ++count;
+                }
+            }
+        }
+        if(bad > 10) break;
+    }
+    printf("checked %u position values\n", count);
+    ASSERT_TRUE(bad == 0);
+}
+
+// feed rates and other larger values
+TEST(DecimalParserTest,exhaustive_rates)
+{
+    char buf[32];
+    uint32_t bad= 0;
+    for (uint32_t whole = 0; whole <= 200000 && bad < 10; whole += k_step) {
+        if(!check(buf, format(buf, false, whole, 0, 0))) ++bad;
+        for (uint32_t frac = 0; frac < 100; ++frac) {
+            if(!check(buf, format(buf, false, whole, frac, 2))) ++bad;
+        }
+    }
+    ASSERT_TRUE(bad == 0);
+}
+
+TEST(DecimalParserTest,benchmark)
+{
+    static const char *words[]= {"244.6500", "112.3", "-90.0000", "50000", "-12.5", "0", "10.25", "180.3125", "1677.7216", "-0.0001"};
+    const int n= sizeof(words) / sizeof(words[0]);
+    const int reps= 200000;
+    float sum= 0;
+
+    clock_t start= clock();
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n; ++i) sum += decimal_to_float(words[i], nullptr);
+    }
+    clock_t t1= clock() - start;
+
+    start= clock();
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n; ++i) sum += strtof(words[i], nullptr);
+    }
+    clock_t t2= clock() - start;
+
+    ASSERT_TRUE(sum != 0);
+    printf("parsed %d numbers, decimal_to_float %1.3f s, strtof %1.3f s\n", n * reps, (float)t1 / CLOCKS_PER_SEC, (float)t2 / CLOCKS_PER_SEC);
+}
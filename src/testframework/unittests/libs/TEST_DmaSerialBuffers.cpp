@@ -0,0 +1,149 @@
+#include "DmaSerialBuffers.h"
+
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+#include "easyunit/test.h"
+
+// a stand in for the UART with its transmit DMA looped back to its receive DMA, time is counted in byte times on the wire
+struct Loopback {
+    DmaRxRing<128> rx;
+    DmaTxQueue<512> tx;
+    const char *chunk= nullptr; // the transmit transfer in progress
+    uint16_t chunk_len= 0, chunk_pos= 0;
+    uint16_t rx_pos= 0; // where the receive DMA writes next, size - NDTR
+    std::string received;
+
+    // one byte time, returns false if the line is idle
+    bool tick()
+    {
+        if(chunk_len == 0) {
+            chunk_len= tx.get_chunk(chunk);
+            chunk_pos= 0;
+            if(chunk_len == 0) {
+                rx_irq(); // idle line
+                return false;
+            }
+        }
+
+        rx.data()[rx_pos]= chunk[chunk_pos++];
+        rx_pos= (rx_pos + 1) % rx.size();
+        if(chunk_pos == chunk_len) {
+            // transfer complete
+            tx.advance(chunk_len);
+            chunk_len= 0;
+        }
+        // half and full transfer interrupts
+        if(rx_pos == 0 || rx_pos == rx.size() / 2) rx_irq();
+        return true;
+    }
+
+    void rx_irq()
+    {
+        rx.consume(rx_pos, [this](const char *p, size_t n) { received.append(p, n); });
+    }
+};
+
+TEST(DmaSerialBuffersTest,rx_ring_wraps)
+{
+    DmaRxRing<16> rx;
+    std::string in, out;
+    uint16_t pos= 0;
+    int c= 0;
+    // irregular bursts so the reads land all over the ring
+    for (int burst = 1; burst < 12; ++burst) {
+        for (int i = 0; i < burst; ++i) {
+            char ch= 'a' + (c++ % 26);
+            in += ch;
+            rx.data()[pos]= ch;
+            pos= (pos + 1) % rx.size();
+        }
+        rx.consume(pos, [&out](const char *p, size_t n) { out.append(p, n); });
+    }
+    ASSERT_TRUE(in == out);
+
+    // nothing new
+    ASSERT_TRUE(rx.consume(pos, [](const char *p, size_t n) {}) == 0);
+}
+
+TEST(DmaSerialBuffersTest,tx_queue_chunks)
+{
+    DmaTxQueue<8> tx;
+    const char *p;
+    ASSERT_TRUE(tx.is_empty());
+    ASSERT_TRUE(tx.get_chunk(p) == 0);
+    ASSERT_TRUE(tx.room() == 7);
+
+    ASSERT_TRUE(tx.put("abcdef", 6) == 6);
+    ASSERT_TRUE(tx.put("ghij", 4) == 1); // only room for one
+    ASSERT_TRUE(tx.room() == 0);
+
+    ASSERT_TRUE(tx.get_chunk(p) == 7);
+    ASSERT_TRUE(std::string(p, 7) == "abcdefg");
+    tx.advance(7);
+    ASSERT_TRUE(tx.is_empty());
+
+    // wraps so it goes in two transfers
+    ASSERT_TRUE(tx.put("hijkl", 5) == 5);
+    ASSERT_TRUE(tx.get_chunk(p) == 1);
+    ASSERT_TRUE(*p == 'h');
+    tx.advance(1);
+    ASSERT_TRUE(tx.get_chunk(p) == 4);
+    ASSERT_TRUE(std::string(p, 4) == "ijkl");
+    tx.advance(4);
+    ASSERT_TRUE(tx.is_empty());
+}
+
+// stream lines as fast as the queue takes them, the wire is the only limit
+TEST(DmaSerialBuffersTest,loopback_throughput)
+{
+    Loopback lb;
+    std::string sent;
+    char line[32];
+    int n= 0, lines= 500;
+    uint32_t byte_times= 0, waits= 0;
+    size_t pending= 0; // what is left of the current line
+
+    while(n < lines || !lb.tx.is_empty() || lb.chunk_len != 0) {
+        if(pending == 0 && n < lines) {
+            pending= snprintf(line, sizeof(line), "G1 X%d Y%d F6000\n", n, lines - n);
+            sent.append(line, pending);
+            ++n;
+        }
+        if(pending > 0) {
+            size_t len= strlen(line);
+            size_t k= lb.tx.put(line + len - pending, pending);
+            if(k == 0) ++waits;
+            pending -= k;
+        }
+        if(lb.tick()) ++byte_times;
+    }
+    lb.tick(); // idle line flushes the rest
+
+    ASSERT_TRUE(lb.received == sent);
+    // every byte time on the wire was used
+    ASSERT_TRUE(byte_times == sent.size());
+    printf("loopback: %u lines, %u bytes in %u byte times, main loop found the queue full %u times\n", lines, (unsigned)sent.size(), byte_times, waits);
+}
+
+// an ok per line received, the main loop never waits for the wire to send it
+TEST(DmaSerialBuffersTest,replies_do_not_stall)
+{
+    Loopback lb;
+    uint32_t waits= 0, blocking_stall= 0;
+    int replies= 1000;
+
+    for (int i = 0; i < replies; ++i) {
+        if(lb.tx.put("ok\r\n", 4) != 4) ++waits;
+        // a blocking write would hold the main loop for the whole reply
+        blocking_stall += 4;
+        // the next line takes about 20 byte times to arrive
+        for (int t = 0; t < 20; ++t) lb.tick();
+    }
+    lb.tick();
+
+    ASSERT_TRUE(waits == 0);
+    ASSERT_TRUE(lb.received.size() == (size_t)replies * 4);
+    printf("replies: %d, main loop stall %u byte times, blocking writes would have stalled %u byte times\n", replies, waits, blocking_stall);
+}
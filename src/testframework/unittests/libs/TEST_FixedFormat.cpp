@@ -0,0 +1,107 @@
+#include "FixedFormat.h"
+
+#include <string>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "easyunit/test.h"
+
+static bool same_as_printf(float v, int d)
+{
+    char a[fixed_format_max], b[64];
+    size_t n= format_fixed(a, v, d);
+    snprintf(b, sizeof(b), "%1.*f", d, v);
+    if(n != strlen(a) || strcmp(a, b) != 0) {
+        printf("%1.9g with %d decimals: %s, printf %s\n", v, d, a, b);
+        return false;
+    }
+    return true;
+}
+
+TEST(FixedFormatTest,same_as_printf)
+{
+    // the values that get reported, every 1/10000 mm over +-2000 mm
+#ifdef __arm__
+    const int k_step= 97;
+#else
+    const int k_step= 1;
+#endif
+    int bad= 0;
+    for (int i = -20000000; i <= 20000000; i += k_step) {
+        if(!same_as_printf(i / 10000.0F, 4)) ++bad;
+    }
+
+    // the exact halves and their neighbours
+    for (int i = -4000; i <= 4000; ++i) {
+        float v= i / 32768.0F;
+        if(!same_as_printf(v, 4)) ++bad;
+        if(!same_as_printf(nextafterf(v, 1e9F), 4)) ++bad;
+        if(!same_as_printf(nextafterf(v, -1e9F), 4)) ++bad;
+        if(!same_as_printf(i + 0.05F, 1)) ++bad;
+        if(!same_as_printf(i + 0.5F, 0)) ++bad;
+    }
+
+    // random bit patterns over the exponents in range and out of it, for every precision
+    srand(1);
+    for (int i = 0; i < 1000000; ++i) {
+        uint32_t bits= ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ ((uint32_t)rand() << 31);
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        if(fabsf(v) > 1e12F) continue; // printf would give hundreds of digits, nothing reports those
+        if(!same_as_printf(v, i % 7)) ++bad;
+    }
+    ASSERT_EQUALS_V(0, bad);
+
+    ASSERT_TRUE(same_as_printf(0.0F, 4));
+    ASSERT_TRUE(same_as_printf(-0.0F, 4));
+    ASSERT_TRUE(same_as_printf(-0.00004F, 4));
+    ASSERT_TRUE(same_as_printf(1e-45F, 6));
+    ASSERT_TRUE(same_as_printf(1073741823.0F, 4));
+    ASSERT_TRUE(same_as_printf(2e9F, 4));
+    ASSERT_TRUE(same_as_printf(INFINITY, 4));
+    ASSERT_TRUE(same_as_printf(-INFINITY, 1));
+
+    std::string s("X:");
+    append_fixed(s, 12.5F, 4).append(" Y:");
+    append_fixed(s, -3.25F, 1);
+    ASSERT_TRUE(s == "X:12.5000 Y:-3.2");
+}
+
+// a ? report has 7 positions and 3 feed rates
+TEST(FixedFormatTest,benchmark)
+{
+    const int k_reports= 20000;
+    float v[10];
+    for (int i = 0; i < 10; ++i) v[i]= 123.4567F * (i + 1) - 400;
+    char buf[256];
+    size_t total= 0;
+
+    auto t0= std::chrono::steady_clock::now();
+    for (int r = 0; r < k_reports; ++r) {
+        size_t n= 0;
+        for (int i = 0; i < 7; ++i) n += snprintf(buf + n, sizeof(buf) - n, ",%1.4f", v[i] + r * 0.0001F);
+        for (int i = 7; i < 10; ++i) n += snprintf(buf + n, sizeof(buf) - n, ",%1.1f", v[i]);
+        total += n;
+    }
+    auto t1= std::chrono::steady_clock::now();
+    for (int r = 0; r < k_reports; ++r) {
+        size_t n= 0;
+        for (int i = 0; i < 7; ++i) {
+            buf[n++]= ',';
+            n += format_fixed(buf + n, v[i] + r * 0.0001F, 4);
+        }
+        for (int i = 7; i < 10; ++i) {
+            buf[n++]= ',';
+            n += format_fixed(buf + n, v[i], 1);
+        }
+        total -= n;
+    }
+    auto t2= std::chrono::steady_clock::now();
+
+    ASSERT_TRUE(total == 0); // the same lengths
+    float s1= std::chrono::duration<float>(t1 - t0).count(), s2= std::chrono::duration<float>(t2 - t1).count();
+    printf("reports/s with snprintf %1.0f, with format_fixed %1.0f\n", k_reports / s1, k_reports / s2);
+}
@@ -0,0 +1,170 @@
+#include "LineSequence.h"
+
+#include <vector>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "easyunit/test.h"
+
+TEST(LineSequenceTest,single_resend)
+{
+    LineSequence seq;
+    seq.set(0); // M110 N0
+
+    ASSERT_TRUE(seq.check(1, true) == LineSequence::ACCEPT);
+    ASSERT_TRUE(seq.check(2, false) == LineSequence::RESEND);
+    ASSERT_EQUALS_V(2, (int)seq.expected());
+    // already in flight, dropped without asking again
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::DISCARD);
+    ASSERT_TRUE(seq.check(4, false) == LineSequence::DISCARD);
+    // the resent line fails again so it is asked for again
+    ASSERT_TRUE(seq.check(2, false) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(2, true) == LineSequence::ACCEPT);
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::ACCEPT);
+    // the host went back too far
+    ASSERT_TRUE(seq.check(2, true) == LineSequence::DUPLICATE);
+    ASSERT_TRUE(seq.check(4, true) == LineSequence::ACCEPT);
+    // a gap is out of order
+    ASSERT_TRUE(seq.check(6, true) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(5, true) == LineSequence::ACCEPT);
+}
+
+// a host keeping up to k_in_flight numbered lines in flight over a link that corrupts some of them
+TEST(LineSequenceTest,pipelined_with_errors)
+{
+    const int k_lines= 20000;
+    const int k_in_flight= 16;
+    srand(7);
+
+    LineSequence seq;
+    seq.set(0);
+
+    std::vector<int> run;                  // the lines the firmware ran
+    std::deque<std::pair<int, bool>> wire; // line number and if it got through intact
+    int next= 1, in_flight= 0, resends= 0, corrupted= 0, sent= 0;
+    int oldest_needed= 1;                  // the host keeps the lines from here on for resending
+
+    while(next <= k_lines || in_flight > 0) {
+        while(in_flight < k_in_flight && next <= k_lines) {
+            bool good= (rand() % 100) != 0;
+            if(!good) ++corrupted;
+            wire.push_back({next++, good});
+            ++in_flight;
+            ++sent;
+        }
+
+        // the firmware takes one line and replies, the host gets the reply
+        auto l= wire.front();
+        wire.pop_front();
+        LineSequence::RESULT r= seq.check(l.first, l.second);
+        --in_flight;
+        if(r == LineSequence::ACCEPT) {
+            run.push_back(l.first);
+            oldest_needed= l.first + 1;
+        } else if(r == LineSequence::RESEND) {
+            ++resends;
+            ASSERT_TRUE(seq.expected() >= oldest_needed);
+            // sometimes a host goes back a couple of lines further than asked
+            next= seq.expected() - ((rand() % 10) == 0 ? 2 : 0);
+            if(next < 1) next= 1;
+        }
+    }
+
+    // every line ran once and in order, and there is no more than one resend for each corrupted line
+    ASSERT_EQUALS_V(k_lines, (int)run.size());
+    bool in_order= true;
+    for (int i = 0; i < k_lines; ++i) {
+        if(run[i] != i + 1) in_order= false;
+    }
+    ASSERT_TRUE(in_order);
+    ASSERT_TRUE(resends <= corrupted);
+    printf("%d lines, %d corrupted, %d resends, %d lines sent\n", k_lines, corrupted, resends, sent);
+}
+
+// the resent line itself is lost or corrupted, it has to be asked for again rather than everything after it being dropped
+TEST(LineSequenceTest,lost_resend)
+{
+    LineSequence seq;
+    seq.set(0);
+
+    ASSERT_TRUE(seq.check(1, true) == LineSequence::ACCEPT);
+    ASSERT_TRUE(seq.check(2, false) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::DISCARD);
+    ASSERT_TRUE(seq.check(4, true) == LineSequence::DISCARD);
+    // the host goes back to 2 but it is lost, 3 is not the next one in flight so 2 is asked for again
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::RESEND);
+    ASSERT_EQUALS_V(2, (int)seq.expected());
+    ASSERT_TRUE(seq.check(4, true) == LineSequence::DISCARD);
+    ASSERT_TRUE(seq.check(2, true) == LineSequence::ACCEPT);
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::ACCEPT);
+
+    // the resent line comes back with its N corrupted
+    ASSERT_TRUE(seq.check(4, false) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(5, true) == LineSequence::DISCARD);
+    ASSERT_TRUE(seq.check(9999, false) == LineSequence::DISCARD);
+    ASSERT_TRUE(seq.check(5, true) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(4, true) == LineSequence::ACCEPT);
+
+    // after going back too far the host loses the resent line
+    ASSERT_TRUE(seq.check(6, true) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(3, true) == LineSequence::DUPLICATE);
+    ASSERT_TRUE(seq.check(6, true) == LineSequence::RESEND);
+    ASSERT_TRUE(seq.check(5, true) == LineSequence::ACCEPT);
+
+    // nothing else was in flight so the lines after a lost resend look like they were, it is asked for again in the end
+    ASSERT_TRUE(seq.check(6, false) == LineSequence::RESEND);
+    int n= 7;
+    while(seq.check(n, true) == LineSequence::DISCARD) ++n;
+    ASSERT_TRUE(n <= 7 + LineSequence::k_window);
+    ASSERT_TRUE(seq.check(6, true) == LineSequence::ACCEPT);
+}
+
+// as pipelined_with_errors but some lines never arrive and some arrive with their N corrupted, a host that is asked for
+// a resend goes back and the job still finishes with every line run once and in order
+TEST(LineSequenceTest,pipelined_with_losses)
+{
+    const int k_lines= 20000;
+    const int k_in_flight= 16;
+    srand(11);
+
+    LineSequence seq;
+    seq.set(0);
+
+    std::vector<int> run;
+    std::deque<std::pair<int, bool>> wire;
+    int next= 1, resends= 0, replies= 0;
+
+    while((int)run.size() < k_lines) {
+        while((int)wire.size() < k_in_flight && next <= k_lines) {
+            // nothing tells the firmware a line is missing if no lines come after it, a host times out for those
+            int r= next < k_lines - 100 ? rand() % 100 : 99;
+            if(r == 0) {
+                next++; // lost
+                continue;
+            }
+            wire.push_back({r == 1 ? rand() : next, r > 1});
+            next++;
+        }
+        if(wire.empty()) break; // stuck, every line sent has been answered and the host is not asked for any more
+
+        auto l= wire.front();
+        wire.pop_front();
+        ++replies;
+        LineSequence::RESULT r= seq.check(l.first, l.second);
+        if(r == LineSequence::ACCEPT) {
+            run.push_back(l.first);
+        } else if(r == LineSequence::RESEND) {
+            ++resends;
+            next= seq.expected();
+        }
+    }
+
+    ASSERT_EQUALS_V(k_lines, (int)run.size());
+    bool in_order= true;
+    for (int i = 0; i < k_lines; ++i) {
+        if(run[i] != i + 1) in_order= false;
+    }
+    ASSERT_TRUE(in_order);
+    printf("%d lines, %d resends, %d replies\n", k_lines, resends, replies);
+}
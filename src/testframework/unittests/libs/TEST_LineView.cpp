@@ -0,0 +1,169 @@
+#include "LineView.h"
+#include "Gcode.h"
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "easyunit/test.h"
+
+// the steps GcodeDispatch takes to pick a line apart, returns the commands on the line
+static std::vector<LineView> split_line(LineView line, int& cs)
+{
+    std::vector<LineView> cmds;
+    cs= 0;
+    if(line[0] == 'N') {
+        size_t chkpos = line.find_first_of("*");
+        if(chkpos != line.n) {
+            line.truncate(chkpos);
+            for (size_t i = 0; i < line.n; i++) cs = cs ^ line[i];
+        }
+        line.remove_prefix(line.find_first_not_of("N0123456789.,- "));
+    }
+    line.truncate(line.find_first_of(";("));
+    while(!line.empty()) {
+        cmds.push_back(line.take_front(line.find_first_of("GM", 2)));
+    }
+    return cmds;
+}
+
+// counts the allocations made while counting is on, so the benchmark can show the dispatch steps make none,
+// only new is replaced here as MemoryPool already replaces delete and that frees anything it does not own
+static bool count_allocs= false;
+static int allocs= 0;
+void *operator new(size_t n)
+{
+    if(count_allocs) ++allocs;
+    return malloc(n > 0 ? n : 1);
+}
+
+static bool inside(const void *p, const void *start, size_t n)
+{
+    return (const char *)p >= (const char *)start && (const char *)p < (const char *)start + n;
+}
+
+TEST(LineViewTest,find)
+{
+    const char *s= "G1 X10 ; move";
+    LineView v{s, strlen(s)};
+    ASSERT_TRUE(v.find_first_of(";(") == 7);
+    ASSERT_TRUE(v.find_first_of("Q") == v.n);
+    ASSERT_TRUE(v.find_first_not_of("G1 ") == 3);
+    ASSERT_TRUE(v.starts_with("G1"));
+    ASSERT_TRUE(!v.starts_with("G10"));
+
+    // the terminating null of the set is not a match
+    const char z[]= {'G', '\0', '1'};
+    LineView vz{z, 3};
+    ASSERT_TRUE(vz.find_first_of("XY") == 3);
+
+    v.truncate(6);
+    ASSERT_TRUE(v.str() == "G1 X10");
+    ASSERT_TRUE(v.str(3) == "X10");
+    ASSERT_TRUE(v.str(10) == "");
+    LineView f= v.take_front(2);
+    ASSERT_TRUE(f.str() == "G1");
+    ASSERT_TRUE(v.str() == " X10");
+    f= v.take_front(100);
+    ASSERT_TRUE(f.str() == " X10");
+    ASSERT_TRUE(v.empty());
+}
+
+TEST(LineViewTest,split)
+{
+    std::string line= "N12 G1 X1 Y2 M400 G0 Z3*97";
+    int cs;
+    std::vector<LineView> cmds= split_line(LineView{line.data(), line.size()}, cs);
+
+    int expect= 0;
+    for (char c : std::string("N12 G1 X1 Y2 M400 G0 Z3")) expect ^= c;
+    ASSERT_EQUALS_V(expect, cs);
+
+    ASSERT_EQUALS_V(3, (int)cmds.size());
+    ASSERT_TRUE(cmds[0].str() == "G1 X1 Y2 ");
+    ASSERT_TRUE(cmds[1].str() == "M400 ");
+    ASSERT_TRUE(cmds[2].str() == "G0 Z3");
+    // they are views of the line not copies
+    for (auto& c : cmds) {
+        ASSERT_TRUE(inside(c.p, line.data(), line.size()));
+    }
+
+    line= "G0 X1 (comment G1)";
+    cmds= split_line(LineView{line.data(), line.size()}, cs);
+    ASSERT_EQUALS_V(1, (int)cmds.size());
+    ASSERT_TRUE(cmds[0].str() == "G0 X1 ");
+
+    // all line number is a blank line
+    line= "N10";
+    cmds= split_line(LineView{line.data(), line.size()}, cs);
+    ASSERT_TRUE(cmds.empty());
+}
+
+TEST(LineViewTest,gcode_from_view)
+{
+    std::string line= "G1 X1.5 Y2M400";
+    LineView v{line.data(), line.size()};
+    LineView g1= v.take_front(v.find_first_of("GM", 2));
+
+    Gcode gc(g1.p, g1.n, nullptr);
+    ASSERT_TRUE(gc.has_g);
+    ASSERT_EQUALS_V(1, gc.g);
+    ASSERT_EQUALS_DELTA_V(1.5, gc.get_value('X'), 0.001);
+    ASSERT_EQUALS_DELTA_V(2, gc.get_value('Y'), 0.001);
+    ASSERT_TRUE(!gc.has_letter('M'));
+    ASSERT_TRUE(strstr(gc.get_command(), "X1.5 Y2") != nullptr);
+    // a short line is held in the Gcode itself
+    ASSERT_TRUE(inside(gc.get_command(), &gc, sizeof(gc)));
+}
+
+// lines from an OpenPnP job through the dispatch steps to a Gcode, none of it touches the heap
+TEST(LineViewTest,dispatch_benchmark)
+{
+    static const char *session[]= {
+        "N1 G21*18", "N2 G90*21", "G0 Z0 F30000", "G0 X244.6500 Y112.3000 F50000 ; pick",
+        "M808 M810", "G0 Z-12.5000 F5000", "N7 G0 X10.2500 Y205.7500 A-90.0000 F50000*80",
+        "M400", "M114", "G0 X180.3000 Y95.1250 F30000", "G0 Z-13.2000 (place)", "M809 M811 G0 Z0",
+    };
+    const int n= sizeof(session) / sizeof(session[0]);
+    std::string lines[n];
+    for (int i = 0; i < n; ++i) lines[i]= session[i];
+
+    const int reps= 20000;
+    int cmds= 0;
+    float sum= 0;
+    allocs= 0;
+    count_allocs= true;
+    clock_t start= clock();
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n; ++i) {
+            LineView line{lines[i].data(), lines[i].size()};
+            if(line[0] == 'N') {
+                line.truncate(line.find_first_of("*"));
+                line.remove_prefix(line.find_first_not_of("N0123456789.,- "));
+            }
+            line.truncate(line.find_first_of(";("));
+            while(!line.empty()) {
+                LineView single_command = line.take_front(line.find_first_of("GM", 2));
+                Gcode gc(single_command.p, single_command.n, nullptr);
+                if(!inside(gc.get_command(), &gc, sizeof(gc))) {
+                    count_allocs= false;
+                    FAIL_M("Gcode text was put on the heap");
+                    return;
+                }
+                if(gc.has_letter('X')) sum += gc.get_value('X');
+                ++cmds;
+            }
+        }
+    }
+    clock_t t= clock() - start;
+    count_allocs= false;
+
+    ASSERT_TRUE(sum > 0);
+    if(t > 0) {
+        printf("dispatched %d lines, %d commands in %1.3f s, %1.0f lines/s, %d allocations\n", n * reps, cmds, (float)t / CLOCKS_PER_SEC, (float)n * reps * CLOCKS_PER_SEC / t, allocs);
+    }
+    ASSERT_EQUALS_V(0, allocs);
+}
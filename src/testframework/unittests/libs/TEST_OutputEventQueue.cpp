@@ -0,0 +1,128 @@
+#include "OutputEventQueue.h"
+
+#include <vector>
+
+#include "easyunit/test.h"
+
+// records the order the outputs were changed in, as which output * 1000 + value
+static std::vector<float> fired;
+static uint32_t finished;
+
+static void record(void *arg, float value)
+{
+    fired.push_back(*(int *)arg * 1000 + value);
+}
+
+// G0 X10, M808, G0 X20, M809 with two blocks in the queue, the outputs must change between the blocks
+TEST(OutputEventQueueTest,runs_at_block_boundaries)
+{
+    OutputEventQueue q;
+    fired.clear();
+    finished= 0;
+    int on= 1, off= 2;
+
+    uint32_t queued= 0;
+    ++queued;                  // G0 X10
+    q.put(queued, record, &on, 0);
+    ++queued;                  // G0 X20
+    q.put(queued, record, &off, 0);
+    ASSERT_TRUE(!q.is_empty());
+
+    // nothing runs while the first block is still moving
+    ASSERT_TRUE(q.run(finished) == 0);
+    ASSERT_TRUE(fired.empty());
+
+    // first block finished, the on runs before the second block starts
+    ++finished;
+    ASSERT_TRUE(q.run(finished) == 1);
+    ASSERT_TRUE(fired.size() == 1);
+    ASSERT_TRUE(fired[0] == 1000);
+
+    // the off has to wait for the second block
+    ASSERT_TRUE(q.run(finished) == 0);
+    ++finished;
+    ASSERT_TRUE(q.run(finished) == 1);
+    ASSERT_TRUE(fired.size() == 2);
+    ASSERT_TRUE(fired[1] == 2000);
+    ASSERT_TRUE(q.is_empty());
+}
+
+// several changes between the same two blocks run together and in order
+TEST(OutputEventQueueTest,same_boundary_in_order)
+{
+    OutputEventQueue q;
+    fired.clear();
+    int a= 1, b= 2;
+
+    q.put(5, record, &a, 1);
+    q.put(5, record, &b, 2);
+    q.put(5, record, &a, 3);
+    q.put(6, record, &b, 4);
+
+    ASSERT_TRUE(q.run(4) == 0);
+    ASSERT_TRUE(q.run(5) == 3);
+    ASSERT_TRUE(fired.size() == 3);
+    ASSERT_TRUE(fired[0] == 1001);
+    ASSERT_TRUE(fired[1] == 2002);
+    ASSERT_TRUE(fired[2] == 1003);
+
+    // if the step ticker is late it catches up
+    ASSERT_TRUE(q.run(10) == 1);
+    ASSERT_TRUE(fired[3] == 2004);
+}
+
+TEST(OutputEventQueueTest,full_and_flush)
+{
+    OutputEventQueue q;
+    fired.clear();
+    int a= 1;
+
+    int n= 0;
+    while(q.put(1, record, &a, 0)) ++n;
+    ASSERT_TRUE(n == OutputEventQueue::queue_size - 1);
+    ASSERT_TRUE(q.is_full());
+
+    // a halt drops them without running them
+    q.flush();
+    ASSERT_TRUE(q.is_empty());
+    ASSERT_TRUE(q.run(100) == 0);
+    ASSERT_TRUE(fired.empty());
+}
+
+TEST(OutputEventQueueTest,counter_wraps)
+{
+    OutputEventQueue q;
+    fired.clear();
+    int a= 1;
+
+    uint32_t queued= 0xFFFFFFFFUL;
+    q.put(queued, record, &a, 0);
+    ++queued; // wraps to 0
+    q.put(queued, record, &a, 1);
+
+    ASSERT_TRUE(q.run(0xFFFFFFFEUL) == 0);
+    ASSERT_TRUE(q.run(0xFFFFFFFFUL) == 1);
+    ASSERT_TRUE(q.run(0) == 1);
+    ASSERT_TRUE(fired.size() == 2);
+}
+
+// M808 after a motion channel move (a nozzle rotation) waits for the channel as well as the blocks before it
+TEST(OutputEventQueueTest,waits_for_channels)
+{
+    OutputEventQueue q;
+    fired.clear();
+    int a= 1, b= 2;
+
+    q.put(3, record, &a, 1, true);
+    q.put(3, record, &b, 2);
+
+    // due but the channel is still moving, the one after it waits too
+    ASSERT_TRUE(q.run(3, true) == 0);
+    ASSERT_TRUE(q.is_waiting(3));
+    ASSERT_TRUE(!q.is_waiting(2));
+
+    ASSERT_TRUE(q.run(3, false) == 2);
+    ASSERT_TRUE(fired.size() == 2);
+    ASSERT_TRUE(fired[0] == 1001);
+    ASSERT_TRUE(!q.is_waiting(3));
+}
@@ -0,0 +1,149 @@
+#include "RingBuffer.h"
+
+#include <string>
+#include <deque>
+#include <stdio.h>
+
+#include "easyunit/test.h"
+
+// A stand in for a host streaming to the serial console at 115200 baud, time is in us.
+// The firmware end is the console's receive buffer, the main loop takes a line when it has a whole one and sends the ok
+// when it has been dispatched.
+struct SerialFlowSim {
+    static const uint32_t byte_us= 87;     // 10 bits at 115200
+    static const uint32_t dispatch_us= 200; // parse and plan a line
+    static const uint32_t host_us= 1000;    // host reacting to an ok, a USB serial adapter latency timer
+
+    RingBuffer<char, 256> buffer;
+    bool counting;
+    int window;                   // what SerialConsole::rx_window() offers in M115
+
+    // host
+    std::deque<std::string> to_send;
+    std::deque<size_t> in_flight; // lengths of the lines sent without an ok yet
+    int bytes_in_flight= 0;
+    std::string sending;          // the line going out on the wire
+    size_t sending_pos= 0;
+    uint32_t host_ready_at= 0;    // when the host reacts to the last ok
+    uint32_t next_tx_at= 0;
+
+    // firmware
+    std::string line;
+    std::deque<std::string> received;
+    uint32_t busy_until= 0;
+    int oks_pending= 0;           // oks queued for the wire back
+    uint32_t next_ok_at= 0;
+    uint32_t max_used= 0;
+    bool overflow= false;
+
+    SerialFlowSim(bool counting) : counting(counting), window(buffer.capacity() - 3) {}
+
+    void host(uint32_t t)
+    {
+        if(!sending.empty() || to_send.empty() || t < host_ready_at) return;
+        const std::string& next= to_send.front();
+        if(counting) {
+            if(bytes_in_flight + (int)next.size() > window) return;
+        } else {
+            if(!in_flight.empty()) return;
+        }
+        sending= next;
+        sending_pos= 0;
+        in_flight.push_back(next.size());
+        bytes_in_flight += next.size();
+        to_send.pop_front();
+    }
+
+    void wire_in(uint32_t t)
+    {
+        if(sending.empty() || t < next_tx_at) return;
+        if(buffer.size() >= buffer.capacity()) overflow= true;
+        else buffer.push_back(sending[sending_pos]);
+        if((uint32_t)buffer.size() > max_used) max_used= buffer.size();
+        next_tx_at= t + byte_us;
+        if(++sending_pos == sending.size()) sending.clear();
+    }
+
+    void main_loop(uint32_t t)
+    {
+        if(t < busy_until) return;
+        if(!line.empty()) {
+            // finished dispatching
+            received.push_back(line);
+            line.clear();
+            ++oks_pending;
+        }
+        // take a line when there is a whole one
+        bool whole= false;
+        for (int i = 0; i < buffer.size(); ++i) {
+            char c;
+            buffer.get(i, c);
+            if(c == '\n') { whole= true; break; }
+        }
+        if(!whole) return;
+        char c;
+        do {
+            buffer.pop_front(c);
+            line += c;
+        } while(c != '\n');
+        busy_until= t + dispatch_us;
+    }
+
+    void wire_out(uint32_t t)
+    {
+        if(oks_pending == 0 || t < next_ok_at) return;
+        // ok\n is three bytes
+        next_ok_at= t + 3 * byte_us;
+        --oks_pending;
+        bytes_in_flight -= in_flight.front();
+        in_flight.pop_front();
+        host_ready_at= next_ok_at + host_us;
+    }
+
+    // returns the time taken to send all the lines
+    uint32_t run(const std::deque<std::string>& lines)
+    {
+        to_send= lines;
+        uint32_t t= 0;
+        while(received.size() < lines.size() && t < 60000000) {
+            host(t);
+            wire_in(t);
+            main_loop(t);
+            wire_out(t);
+            ++t;
+        }
+        return t;
+    }
+};
+
+static std::deque<std::string> job_lines()
+{
+    std::deque<std::string> lines;
+    char buf[64];
+    for (int i = 0; i < 500; ++i) {
+        snprintf(buf, sizeof(buf), "G0 X%d.%04d Y%d.%02d F50000\n", 100 + i % 300, (i * 37) % 10000, 50 + i % 200, i % 100);
+        lines.push_back(buf);
+        if(i % 5 == 0) lines.push_back("M400\n");
+    }
+    return lines;
+}
+
+TEST(SerialFlowTest,char_counting)
+{
+    std::deque<std::string> lines= job_lines();
+
+    SerialFlowSim ping_pong(false);
+    uint32_t t1= ping_pong.run(lines);
+    SerialFlowSim counting(true);
+    uint32_t t2= counting.run(lines);
+
+    // every line arrived whole and in order and the buffer never overflowed
+    ASSERT_TRUE(counting.received == lines);
+    ASSERT_TRUE(!counting.overflow);
+    ASSERT_TRUE(counting.max_used <= (uint32_t)counting.window);
+    ASSERT_TRUE(ping_pong.received == lines);
+
+    float cps1= lines.size() * 1e6F / t1, cps2= lines.size() * 1e6F / t2;
+    printf("%u lines, wait for each ok %1.0f commands/s, counting characters in a %d byte window %1.0f commands/s\n", (unsigned)lines.size(), cps1, counting.window, cps2);
+    ASSERT_TRUE(cps2 > cps1 * 1.3F);
+}
@@ -0,0 +1,79 @@
+#include "StepPortGroups.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+// mock GPIO ports, the step groups only ever write BSRR so we can check the values written
+static GPIO_TypeDef mock_port1, mock_port2;
+
+TEST(StepPortGroupsTest,same_port_one_write)
+{
+    memset(&mock_port1, 0, sizeof(mock_port1));
+    StepPortGroups g;
+    // CHMT step pins 5.5, 5.4 and 5.13 all on the same port
+    g.add(0, &mock_port1, 5, false);
+    g.add(1, &mock_port1, 4, false);
+    g.add(2, &mock_port1, 13, false);
+    ASSERT_EQUALS_V(1, g.get_num_groups());
+
+    g.step(0);
+    g.step(2);
+    ASSERT_TRUE(mock_port1.BSRR == 0); // nothing written until flush
+    ASSERT_TRUE(g.flush());
+    ASSERT_TRUE(mock_port1.BSRR == ((1UL<<5) | (1UL<<13)));
+
+    g.unstep();
+    ASSERT_TRUE(mock_port1.BSRR == (((1UL<<5) | (1UL<<13)) << 16));
+
+    // nothing stepped so nothing written
+    mock_port1.BSRR= 0;
+    ASSERT_TRUE(!g.flush());
+    g.unstep();
+    ASSERT_TRUE(mock_port1.BSRR == 0);
+}
+
+TEST(StepPortGroupsTest,inverting_pins)
+{
+    memset(&mock_port1, 0, sizeof(mock_port1));
+    StepPortGroups g;
+    g.add(0, &mock_port1, 3, true);
+    g.add(1, &mock_port1, 4, false);
+
+    g.step(0);
+    g.step(1);
+    g.flush();
+    // inverting pin is stepped by pulling it low
+    ASSERT_TRUE(mock_port1.BSRR == (((1UL<<3) << 16) | (1UL<<4)));
+    g.unstep();
+    ASSERT_TRUE(mock_port1.BSRR == ((1UL<<3) | ((1UL<<4) << 16)));
+}
+
+TEST(StepPortGroupsTest,multiple_ports)
+{
+    memset(&mock_port1, 0, sizeof(mock_port1));
+    memset(&mock_port2, 0, sizeof(mock_port2));
+    StepPortGroups g;
+    g.add(0, &mock_port1, 1, false);
+    g.add(1, &mock_port2, 2, false);
+    g.add(2, &mock_port1, 3, false);
+    ASSERT_EQUALS_V(2, g.get_num_groups());
+
+    g.step(1);
+    g.flush();
+    ASSERT_TRUE(mock_port1.BSRR == 0);
+    ASSERT_TRUE(mock_port2.BSRR == (1UL<<2));
+
+    // a second tick before the unstep accumulates the pins to clear
+    g.step(0);
+    g.step(2);
+    g.flush();
+    ASSERT_TRUE(mock_port1.BSRR == ((1UL<<1) | (1UL<<3)));
+    g.unstep();
+    ASSERT_TRUE(mock_port1.BSRR == (((1UL<<1) | (1UL<<3)) << 16));
+    ASSERT_TRUE(mock_port2.BSRR == ((1UL<<2) << 16));
+
+    g.unstep_all();
+    ASSERT_TRUE(mock_port1.BSRR == (((1UL<<1) | (1UL<<3)) << 16));
+    ASSERT_TRUE(mock_port2.BSRR == ((1UL<<2) << 16));
+}
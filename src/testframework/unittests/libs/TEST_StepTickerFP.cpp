@@ -0,0 +1,271 @@
+#include "StepTicker.h"
+#include "Block.h"
+#include "Kernel.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#ifdef __arm__
+#include "cmsis.h"
+#endif
+
+#include "easyunit/test.h"
+
+// Block::prepare makes the 2.62 fixed point tick info in single precision. These run real blocks through
+// calculate_trapezoid and check the tick info against the same values worked out in double from the rates and ramp
+// ticks the block ended up with, as Block::prepare used to.
+
+static const int n_motors= 4;
+
+static float random_float(float min, float max) { return min + (max - min) * ((float)rand() / RAND_MAX); }
+
+static bool close_enough(int64_t a, int64_t b)
+{
+    // within a few float roundings of each other, or a few lsbs for tiny values
+    double d= fabs((double)a - (double)b);
+    return d <= 4 || d <= fabs((double)a) * 1e-6;
+}
+
+static void set_frequency(float f)
+{
+    if(THEKERNEL->step_ticker == nullptr) THEKERNEL->step_ticker= new StepTicker();
+    THEKERNEL->step_ticker->set_frequency(f);
+    Block::init(n_motors);
+}
+
+// a block of a few thousand steps on some of the motors, with speeds it can reach within its length
+static void random_block(Block& b, float jerk, float& entry_speed, float& exit_speed)
+{
+    b.clear();
+    b.steps_event_count= 0;
+    for (int m = 0; m < n_motors; ++m) {
+        b.steps[m]= (m > 0 && rand() % 3 == 0) ? 0 : 1 + rand() % 20000;
+        b.steps_event_count= std::max(b.steps_event_count, b.steps[m]);
+    }
+    b.millimeters= b.steps_event_count / random_float(80.0F, 400.0F);
+    b.nominal_speed= random_float(1.0F, 250.0F);
+    b.nominal_rate= b.steps_event_count * b.nominal_speed / b.millimeters;
+    b.acceleration= random_float(100.0F, 20000.0F);
+    b.jerk= jerk;
+
+    // kept a little inside what it can reach so rounding never leaves it short
+    entry_speed= random_float(0.0F, 0.99F * std::min(b.nominal_speed, b.max_allowable_speed(-b.acceleration, 0.0F, b.millimeters)));
+    exit_speed= random_float(0.0F, 0.99F * std::min(b.nominal_speed, b.max_allowable_speed(-b.acceleration, entry_speed, b.millimeters)));
+}
+
+// the change in rate per tick in 2.62 fixed point for a trapezoid ramp, or the change in acceleration per tick for an
+// S-curve one which ramps it over jerk_ticks at each end, in double
+static int64_t ramp_fp(double rate_change, uint32_t ticks, uint32_t jerk_ticks, bool s_curve, double aratio, double f)
+{
+    if(ticks == 0) return 0;
+    double per_tick= s_curve ? rate_change / ((double)jerk_ticks * (ticks - jerk_ticks) * f) : rate_change / (ticks * f);
+    return (int64_t)round(per_tick * STEPTICKER_FPSCALE * aratio);
+}
+
+static int64_t rate_fp(double rate, double aratio, double f) { return (int64_t)round(rate * aratio / f * STEPTICKER_FPSCALE); }
+
+// the block's ramp ticks fit together and its tick info is what it was in double
+static bool block_ok(const Block& b, const Block::tickinfo_t tick_info[], float exit_speed, float f)
+{
+    if(b.accelerate_until > b.decelerate_after || b.decelerate_after > b.total_move_ticks) return false;
+    if(b.accel_jerk_ticks * 2 > b.accelerate_until || b.decel_jerk_ticks * 2 > b.total_move_ticks - b.decelerate_after) return false;
+
+    // the rate the block ends at as calculate_trapezoid works it out
+    float final_rate= b.nominal_rate * (exit_speed / b.nominal_speed);
+    for (int m = 0; m < n_motors; ++m) {
+        const Block::tickinfo_t& ti= tick_info[m];
+        if(b.steps[m] == 0) {
+            if(ti.steps_per_tick != 0 || ti.accel != 0 || ti.decel != 0 || ti.plateau_rate != 0) return false;
+            continue;
+        }
+        double aratio= (double)b.steps[m] / b.steps_event_count;
+        if(!close_enough(rate_fp(b.initial_rate, aratio, f), ti.steps_per_tick)) return false;
+        if(!close_enough(rate_fp(b.maximum_rate, aratio, f), ti.plateau_rate)) return false;
+        if(!close_enough(ramp_fp((double)b.maximum_rate - b.initial_rate, b.accelerate_until, b.accel_jerk_ticks, b.is_s_curve, aratio, f), ti.accel)) return false;
+        if(!close_enough(ramp_fp((double)b.maximum_rate - final_rate, b.total_move_ticks - b.decelerate_after, b.decel_jerk_ticks, b.is_s_curve, aratio, f), ti.decel)) return false;
+    }
+    return true;
+}
+
+// runs 1000 random blocks at each step ticker frequency, returns how many were not right and counts the S-curves
+static int bad_blocks(float jerk, int& s_curves)
+{
+    Block::tickinfo_t tick_info[k_max_actuators];
+    Block b;
+    b.tick_info= tick_info;
+
+    srand(1234);
+    float old_f= THEKERNEL->step_ticker != nullptr ? THEKERNEL->step_ticker->get_frequency() : 100000.0F;
+    uint8_t old_n= Block::n_actuators;
+    const float freqs[]= {100000.0F, 200000.0F};
+    int bad= 0;
+    s_curves= 0;
+    for (float f : freqs) {
+        set_frequency(f);
+        for (int i = 0; i < 1000; ++i) {
+            float entry_speed, exit_speed;
+            random_block(b, jerk, entry_speed, exit_speed);
+            b.calculate_trapezoid(entry_speed, exit_speed);
+            if(b.is_s_curve) ++s_curves;
+            if(!block_ok(b, tick_info, exit_speed, f)) ++bad;
+        }
+    }
+    THEKERNEL->step_ticker->set_frequency(old_f);
+    Block::init(old_n);
+    b.tick_info= nullptr;
+    return bad;
+}
+
+// what Block::prepare needs of a trapezoid block, kept so the tick info can be made again outside of it
+struct prepared_t {
+    uint32_t steps[n_motors];
+    uint32_t steps_event_count;
+    float initial_rate, maximum_rate, acceleration_in_steps, deceleration_in_steps;
+};
+
+// the trapezoid tick info as Block::prepare makes it now in single precision, fp_scale is 1/f²
+static void tick_info_float(const prepared_t& p, float f, float fp_scale, Block::tickinfo_t ti[])
+{
+    float inv= 1.0F / p.steps_event_count;
+    float acceleration_per_tick= p.acceleration_in_steps * fp_scale;
+    float deceleration_per_tick= p.deceleration_in_steps * fp_scale;
+    float rate_scale= 1.0F / f;
+    for (int m = 0; m < n_motors; ++m) {
+        if(p.steps[m] == 0) continue;
+        float aratio= inv * p.steps[m];
+        ti[m].steps_per_tick= STEPTICKER_TOFP((p.initial_rate * aratio) * rate_scale);
+        ti[m].accel= STEPTICKER_TOFP(acceleration_per_tick * aratio);
+        ti[m].decel= STEPTICKER_TOFP(deceleration_per_tick * aratio);
+        ti[m].plateau_rate= STEPTICKER_TOFP((p.maximum_rate * aratio) * rate_scale);
+    }
+}
+
+// the same as Block::prepare used to make it in double, fp_scale is 2^62/f²
+static void tick_info_double(const prepared_t& p, double f, double fp_scale, Block::tickinfo_t ti[])
+{
+    float inv= 1.0F / p.steps_event_count;
+    double acceleration_per_tick= p.acceleration_in_steps * fp_scale;
+    double deceleration_per_tick= p.deceleration_in_steps * fp_scale;
+    for (int m = 0; m < n_motors; ++m) {
+        if(p.steps[m] == 0) continue;
+        float aratio= inv * p.steps[m];
+        ti[m].steps_per_tick= (int64_t)round((((double)p.initial_rate * aratio) / f) * STEPTICKER_FPSCALE);
+        ti[m].accel= (int64_t)round(acceleration_per_tick * aratio);
+        ti[m].decel= (int64_t)round(deceleration_per_tick * aratio);
+        ti[m].plateau_rate= (int64_t)round(((p.maximum_rate * aratio) / f) * STEPTICKER_FPSCALE);
+    }
+}
+
+// cycles from the DWT cycle counter on the target, there is none on the host so it is ns from the clock there
+static const char *count_units()
+{
+#ifdef __arm__
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+static uint32_t count_now()
+{
+#ifdef __arm__
+    return DWT->CYCCNT;
+#else
+    return (uint32_t)((uint64_t)clock() * 1000000000ULL / CLOCKS_PER_SEC);
+#endif
+}
+
+TEST(StepTickerFPTest,tofp)
+{
+    ASSERT_TRUE(STEPTICKER_TOFP(1.0F) == STEPTICKER_FPSCALE);
+    ASSERT_TRUE(STEPTICKER_TOFP(0.5F) == STEPTICKER_FPSCALE/2);
+    ASSERT_TRUE(STEPTICKER_TOFP(-0.25F) == -STEPTICKER_FPSCALE/4);
+    ASSERT_TRUE(STEPTICKER_TOFP(0.0F) == 0);
+    ASSERT_EQUALS_DELTA_V(0.125F, STEPTICKER_FROMFP(STEPTICKER_TOFP(0.125F)), 0.0000001F);
+}
+
+TEST(StepTickerFPTest,trapezoid_blocks)
+{
+    int s_curves;
+    ASSERT_EQUALS(0, bad_blocks(0.0F, s_curves));
+    ASSERT_EQUALS(0, s_curves);
+}
+
+TEST(StepTickerFPTest,s_curve_blocks)
+{
+    // most ramps are long enough to shape
+    int s_curves;
+    ASSERT_EQUALS(0, bad_blocks(1000000.0F, s_curves));
+    ASSERT_TRUE(s_curves > 1000);
+}
+
+// the cost of making the tick info in float against in double, on the target the double math is done in software
+TEST(StepTickerFPTest,cycles)
+{
+    static const int n_blocks= 100;
+    static prepared_t prepared[n_blocks];
+    static Block::tickinfo_t made[n_blocks][k_max_actuators];
+    static Block::tickinfo_t ti_float[n_blocks][n_motors], ti_double[n_blocks][n_motors];
+
+    Block b;
+    srand(4321);
+    float old_f= THEKERNEL->step_ticker != nullptr ? THEKERNEL->step_ticker->get_frequency() : 100000.0F;
+    uint8_t old_n= Block::n_actuators;
+    const float f= 100000.0F;
+    set_frequency(f);
+    for (int i = 0; i < n_blocks; ++i) {
+        float entry_speed, exit_speed;
+        b.tick_info= made[i];
+        random_block(b, 0.0F, entry_speed, exit_speed);
+        b.calculate_trapezoid(entry_speed, exit_speed);
+
+        // as calculate_trapezoid works them out from the ramp ticks
+        prepared_t& p= prepared[i];
+        for (int m = 0; m < n_motors; ++m) p.steps[m]= b.steps[m];
+        p.steps_event_count= b.steps_event_count;
+        p.initial_rate= b.initial_rate;
+        p.maximum_rate= b.maximum_rate;
+        float final_rate= b.nominal_rate * (exit_speed / b.nominal_speed);
+        float acceleration_time= b.accelerate_until / f;
+        float deceleration_time= (b.total_move_ticks - b.decelerate_after) / f;
+        p.acceleration_in_steps= acceleration_time > 0.0F ? (b.maximum_rate - b.initial_rate) / acceleration_time : 0;
+        p.deceleration_in_steps= deceleration_time > 0.0F ? (b.maximum_rate - final_rate) / deceleration_time : 0;
+    }
+    THEKERNEL->step_ticker->set_frequency(old_f);
+    Block::init(old_n);
+    b.tick_info= nullptr;
+
+    const char *units= count_units();
+    const int reps= 20;
+    float fp_scale_float= 1.0F / (f * f);
+    double fp_scale_double= (double)STEPTICKER_FPSCALE / pow((double)f, 2.0);
+    uint32_t start= count_now();
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n_blocks; ++i) tick_info_float(prepared[i], f, fp_scale_float, ti_float[i]);
+    }
+    uint32_t float_count= count_now() - start;
+    start= count_now();
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n_blocks; ++i) tick_info_double(prepared[i], f, fp_scale_double, ti_double[i]);
+    }
+    uint32_t double_count= count_now() - start;
+
+    // the float one is what the blocks got and the double one the same within the float rounding
+    for (int i = 0; i < n_blocks; ++i) {
+        for (int m = 0; m < n_motors; ++m) {
+            if(prepared[i].steps[m] == 0) continue;
+            ASSERT_TRUE(close_enough(made[i][m].steps_per_tick, ti_float[i][m].steps_per_tick) && close_enough(made[i][m].plateau_rate, ti_float[i][m].plateau_rate));
+            ASSERT_TRUE(close_enough(made[i][m].accel, ti_float[i][m].accel) && close_enough(made[i][m].decel, ti_float[i][m].decel));
+            ASSERT_TRUE(close_enough(ti_double[i][m].steps_per_tick, ti_float[i][m].steps_per_tick) && close_enough(ti_double[i][m].plateau_rate, ti_float[i][m].plateau_rate));
+            ASSERT_TRUE(close_enough(ti_double[i][m].accel, ti_float[i][m].accel) && close_enough(ti_double[i][m].decel, ti_float[i][m].decel));
+        }
+    }
+
+    printf("tick info for a block of %d motors: %lu %s in float, %lu in double\n", n_motors,
+           (unsigned long)(float_count / (reps * n_blocks)), units, (unsigned long)(double_count / (reps * n_blocks)));
+}
@@ -5,6 +5,8 @@
 #include <vector>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <map>
 
 #include "easyunit/test.h"
 
@@ -60,3 +62,103 @@ TEST(GCodeTest,subcode)
     ASSERT_EQUALS_DELTA_V(2.3, gc4.get_value('Y'), 0.001);
 
 }
+
+TEST(GCodeTest,letters)
+{
+    Gcode gc("M117 HELLO X1", nullptr);
+    ASSERT_TRUE(gc.has_m);
+    ASSERT_TRUE(!gc.has_g);
+    ASSERT_EQUALS_V(117, gc.m);
+    ASSERT_TRUE(strcmp(gc.get_command(), " HELLO X1") == 0);
+    // any upper case letter counts, with or without a value
+    ASSERT_TRUE(gc.has_letter('H'));
+    ASSERT_TRUE(gc.has_letter('L'));
+    ASSERT_TRUE(!gc.has_letter('M'));
+    ASSERT_TRUE(!gc.has_letter('Y'));
+    ASSERT_EQUALS_DELTA_V(0, gc.get_value('H'), 0.001);
+    ASSERT_EQUALS_DELTA_V(1, gc.get_value('X'), 0.001);
+    ASSERT_EQUALS_V(6, gc.get_num_args());
+
+    // the first of a letter that has a value is used
+    Gcode gc2("G1 X-1.75 X2 Y.5 E3 P12.9 T1", nullptr);
+    ASSERT_EQUALS_DELTA_V(-1.75, gc2.get_value('X'), 0.001);
+    ASSERT_EQUALS_DELTA_V(0.5, gc2.get_value('Y'), 0.001);
+    ASSERT_EQUALS_V(12, gc2.get_int('P'));
+    ASSERT_EQUALS_V(-1, gc2.get_int('X'));
+    ASSERT_TRUE(gc2.get_uint('E') == 3);
+    ASSERT_EQUALS_V(5, gc2.get_num_args()); // T is not an argument
+
+    std::map<char,float> args= gc2.get_args();
+    ASSERT_EQUALS_V(4, (int)args.size());
+    ASSERT_EQUALS_DELTA_V(3, args['E'], 0.001);
+
+    // not a letter so the line is searched
+    Gcode gc3("N10 G1 X1*93", nullptr, false);
+    ASSERT_EQUALS_DELTA_V(10, gc3.get_value('N'), 0.001);
+    ASSERT_EQUALS_V(93, (int)gc3.get_value('*'));
+    ASSERT_TRUE(gc3.has_letter('*'));
+}
+
+TEST(GCodeTest,long_line)
+{
+    std::string s("M118");
+    for (int i = 0; i < 20; ++i) s.append(" ABCDEFGHIJ");
+    s.append(" S5");
+    Gcode gc(s, nullptr);
+    ASSERT_EQUALS_V(118, gc.m);
+    ASSERT_TRUE(strlen(gc.get_command()) == s.size() - 4);
+    ASSERT_EQUALS_DELTA_V(5, gc.get_value('S'), 0.001);
+
+    Gcode gc2(gc);
+    ASSERT_TRUE(strcmp(gc.get_command(), gc2.get_command()) == 0);
+    ASSERT_EQUALS_DELTA_V(5, gc2.get_value('S'), 0.001);
+
+    Gcode gc3("G1 X1", nullptr);
+    gc3= gc;
+    ASSERT_TRUE(strcmp(gc.get_command(), gc3.get_command()) == 0);
+    gc3= gc2= Gcode("G0 X2", nullptr);
+    ASSERT_EQUALS_DELTA_V(2, gc3.get_value('X'), 0.001);
+}
+
+TEST(GCodeTest,strip_parameters)
+{
+    Gcode gc("G1 X1 Y2 Z3 F100 I1 S2", nullptr);
+    gc.strip_parameters();
+    ASSERT_TRUE(strcmp(gc.get_command(), "    F100  S2") == 0);
+    ASSERT_TRUE(!gc.has_letter('X'));
+    ASSERT_TRUE(gc.has_letter('F'));
+    ASSERT_EQUALS_DELTA_V(100, gc.get_value('F'), 0.001);
+    ASSERT_EQUALS_V(2, gc.get_num_args());
+}
+
+// lines from an OpenPnP job on a CHMT, the time to parse them is printed
+static const char *session[]= {
+    "G21", "G90", "M82", "M204 S20000", "G0 Z0 F30000", "G0 A0 B0",
+    "M400", "M114.2", "G0 X244.6500 Y112.3000 F50000", "G0 Z-12.5000 F5000",
+    "M808", "M810", "G0 Z0 F30000", "G0 X10.2500 Y205.7500 A-90.0000 F50000",
+    "M822", "M400", "M114", "M105", "G0 X180.3000 Y95.1250 F30000",
+    "G0 Z-13.2000", "M809", "M811", "G0 Z0", "M823", "G4 P50", "M401",
+    "M430 C4 F8000", "M800", "M801", "G1 X100.1234 Y-20.5 Z1.25 F12000"
+};
+
+TEST(GCodeTest,session_benchmark)
+{
+    const int n= sizeof(session) / sizeof(session[0]);
+    const int reps= 20000;
+    clock_t start= clock();
+    float sum= 0;
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < n; ++i) {
+            Gcode gc(session[i], nullptr);
+            if(gc.has_letter('X')) sum += gc.get_value('X');
+            if(gc.has_letter('Y')) sum += gc.get_value('Y');
+            if(gc.has_letter('F')) sum += gc.get_value('F');
+        }
+    }
+    clock_t t= clock() - start;
+
+    ASSERT_TRUE(sum > 0); // uses the values so the lookups are not optimized away
+    if(t > 0) {
+        printf("parsed %d lines in %1.3f s, %1.0f lines/s\n", n * reps, (float)t / CLOCKS_PER_SEC, (float)n * reps * CLOCKS_PER_SEC / t);
+    }
+}